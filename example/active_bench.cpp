@@ -0,0 +1,71 @@
+#include <ConcurrentQueue.h>
+#include <nonblock/Active.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Active as it was: std::function through a mutex and condvar queue, one task per pop
+class LegacyActive {
+public:
+    LegacyActive() {
+        worker_ = thread([this] {
+            while (!done_) queue_.pop()();
+        });
+    }
+
+    ~LegacyActive() {
+        queue_.push([this] { done_ = true; });
+        worker_.join();
+    }
+
+    void submit(function<void()> callback_) { queue_.push(callback_); }
+
+private:
+    frenzy::ConcurrentQueue<function<void()>> queue_;
+    thread worker_;
+    bool done_{false};
+};
+
+// messages per second from producers threads until the worker ran them all
+template <typename A, typename... Args>
+double measure(long n, int producers, Args&&... args) {
+    long count = 0;  // touched by the worker only
+    auto start = chrono::steady_clock::now();
+    {
+        A active(std::forward<Args>(args)...);
+        vector<thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&active, &count, n, producers] {
+                for (long i = 0; i < n / producers; ++i) active.submit([&count] { ++count; });
+            });
+        }
+        for (auto& t : threads) t.join();
+    }  // destructor drains the mailbox
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (count != n / producers * producers) printf("lost messages: %ld\n", count);
+    return count / seconds / 1e6;
+}
+
+int main(int argc, char** argv) {
+    long n = argc > 1 ? atol(argv[1]) : 2000 * 1000;
+    int cpu = argc > 2 ? atoi(argv[2]) : -1;  // pins the new Active's worker
+    frenzy::ActiveOptions options;
+    options.cpu = cpu;
+    printf("%-28s %12s %12s %12s   (M msgs/s)\n", "", "1 producer", "2 producers", "4 producers");
+    auto row = [&](const char* name, auto run) {
+        printf("%-28s %12.2f %12.2f %12.2f\n", name, run(1), run(2), run(4));
+    };
+    row("legacy Active", [&](int p) { return measure<LegacyActive>(n, p); });
+    row("Active<MpscMailbox>", [&](int p) { return measure<frenzy::BasicActive<frenzy::MpscMailbox>>(n, p, options); });
+    row("Active<BoundedMailbox>",
+        [&](int p) { return measure<frenzy::BasicActive<frenzy::BoundedMailbox>>(n, p, options); });
+    row("Active<LockedMailbox>",
+        [&](int p) { return measure<frenzy::BasicActive<frenzy::LockedMailbox>>(n, p, options); });
+    return 0;
+}
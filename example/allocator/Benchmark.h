@@ -1,7 +1,6 @@
 #ifndef CONCURRENT_BENCHMARK_H
 #define CONCURRENT_BENCHMARK_H
 
-#include <chrono>
 #include <forward_list>
 #include <iostream>
 #include <list>
@@ -10,20 +9,21 @@
 #include <set>
 #include <unordered_map>
 #include "allocator/FastPoolAllocator.h"
+#include "utils/TscClock.h"
 
 using namespace std;
 
 constexpr int numberOfIterations = 1024;
 
 class PerformanceTimer {
-    std::chrono::high_resolution_clock::time_point from, to;
+    uint64_t from{0}, to{0};  // tsc ticks
 
 public:
-    void start() { from = std::chrono::high_resolution_clock::now(); }
+    void start() { from = frenzy::TscClock::ticks(); }
 
-    void stop() { to = std::chrono::high_resolution_clock::now(); }
+    void stop() { to = frenzy::TscClock::ticks(); }
 
-    double toSeconds() const { return std::chrono::duration_cast<std::chrono::duration<double>>(to - from).count(); }
+    double toSeconds() const { return static_cast<double>(frenzy::TscClock::instance().ticks_to_ns(to - from)) / 1e9; }
 };
 
 template <typename Alloc>
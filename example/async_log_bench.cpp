@@ -0,0 +1,71 @@
+#include <ConcurrentWrapper.h>
+#include <log/AsyncLog.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// swallows the log output, so the numbers are of the queue and formatting, not of the terminal
+class NullBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type c_) override { return traits_type::not_eof(c_); }
+    std::streamsize xsputn(const char*, std::streamsize n_) override { return n_; }
+};
+
+// what ASYNC_LOG did before: ostringstream, std::string, std::function through a locked queue
+frenzy::ConcurrentWrapper<std::ostream&>& locked_log() {
+    static auto* wrapper = new frenzy::ConcurrentWrapper<std::ostream&>(std::cout);
+    return *wrapper;
+}
+
+#define LOCKED_LOG(content)                                                                           \
+    {                                                                                                 \
+        std::ostringstream oss;                                                                       \
+        oss << frenzy::time_string() << " " << __FILE__ << ":" << __LINE__ << " " << content << "\n"; \
+        std::string __result = oss.str();                                                             \
+        locked_log()([__result](std::ostream& c) { c << __result; });                                 \
+    }
+
+// calls per second over all threads, counted until the worker has written every line
+template <typename Log, typename Wait>
+double measure(int threads, int perThread, Log&& log, Wait&& wait) {
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < perThread; ++i) log(t, i);
+        });
+    }
+    for (auto& w : workers) w.join();
+    wait();
+    double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return threads * perThread / sec;
+}
+
+int main(int argc, char** argv) {
+    int perThread = argc > 1 ? atoi(argv[1]) : 200 * 1000;
+    NullBuffer null;
+    std::streambuf* saved = std::cout.rdbuf(&null);
+    string symbol = "IF2312";
+
+    vector<pair<int, pair<double, double>>> results;
+    for (int threads : {1, 2, 4, 8, 16}) {
+        double locked = measure(
+            threads, perThread / threads,
+            [&](int t, int i) { LOCKED_LOG("thread " << t << " order " << i << " " << symbol << " " << 4000.5 + i); },
+            [] { locked_log().submit([](std::ostream&) {}).get(); });
+        double lockFree = measure(
+            threads, perThread / threads,
+            [&](int t, int i) { ASYNC_LOG("thread " << t << " order " << i << " " << symbol << " " << 4000.5 + i); },
+            [] { frenzy::AsyncLog::instance().log.submit([](std::ostream&) {}).get(); });
+        results.push_back({threads, {locked, lockFree}});
+    }
+
+    std::cout.rdbuf(saved);
+    printf("%8s %22s %22s\n", "threads", "locked queue calls/s", "ASYNC_LOG calls/s");
+    for (auto& r : results) printf("%8d %22.0f %22.0f\n", r.first, r.second.first, r.second.second);
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <container/CircularBuffer.h>
+#include <container/FlatView.h>
+#include <media/SharedMemory.h>
+#include <thread>
+
+using namespace frenzy;
+
+// owning message used by the writer
+struct Quote {
+    int32_t id = 0;
+    std::string symbol;
+    std::vector<double> prices;
+    std::vector<int64_t> volumes;
+};
+
+// flat layout in the ring, reader accesses it without deserialization
+struct QuoteView {
+    int32_t id;
+    FlatString symbol;
+    FlatVector<double> prices;
+    FlatVector<int64_t> volumes;
+};
+
+struct QuoteSerializer {
+    using Builder = FlatBuilder<QuoteView>;
+    using View = QuoteView;
+
+    static uint32_t size(const Quote& q_) {
+        return Builder::fixed_size() + Builder::string_size(static_cast<uint32_t>(q_.symbol.size())) +
+               Builder::vector_size<double>(static_cast<uint32_t>(q_.prices.size())) +
+               Builder::vector_size<int64_t>(static_cast<uint32_t>(q_.volumes.size()));
+    }
+
+    Buffer serialize(const Quote& q_, uint8_t* space_) {
+        Builder builder{space_, size(q_)};
+        QuoteView* root = builder.root();
+        root->id = q_.id;
+        builder.set(root->symbol, q_.symbol);
+        builder.set(root->prices, q_.prices);
+        builder.set(root->volumes, q_.volumes);
+        return {space_, builder.finish()};
+    }
+
+    static std::pair<const QuoteView*, uint32_t> view(const uint8_t* buffer_, uint32_t length_) {
+        return flat_view<QuoteView>(buffer_, length_);
+    }
+
+    static uint32_t recordSize() { return 0; /* zero indicates variable record length. */ }
+};
+
+using QuoteTraits = ZeroCopyTraits<Quote, QuoteSerializer>;
+
+static int32_t N = 20;
+template <typename CircularBufferType>
+void rb_writer(CircularBufferType& rb_) {
+    for (int32_t c = 1; c <= N;) {
+        Quote q;
+        q.id = c;
+        q.symbol = "SYM" + std::to_string(c);
+        q.prices.assign(static_cast<size_t>(c % 5 + 1), 100.0 + c);
+        q.volumes.assign(static_cast<size_t>(c % 3 + 1), c * 10);
+        if (!rb_.write(q)) {
+            // queue full, wait reader. or, may spin as well.
+            std::this_thread::sleep_for(std::chrono::milliseconds(10 * (rand() % 3)));
+        } else {
+            c++;
+        }
+    }
+}
+
+template <typename CircularBufferType>
+void rb_reader(CircularBufferType& rb_) {
+    for (int32_t c = 1; c <= N;) {
+        bool r = rb_.read_view([](const QuoteView& v_) {
+            fprintf(stderr, "<< : Quote {%d, %s, prices %u, volumes %u, last volume %ld}\n", v_.id, v_.symbol.c_str(),
+                    v_.prices.size(), v_.volumes.size(), v_.volumes[v_.volumes.size() - 1]);
+        });
+        if (!r) {
+            // queue empty, wait writer. or, may spin as well.
+            std::this_thread::sleep_for(std::chrono::milliseconds(10 * (rand() % 3)));
+        } else {
+            c++;
+        }
+    }
+}
+
+void run_heap() {
+    uint32_t size = 256 * 1024;
+    HeapMemory space{size};
+    CircularBuffer<HeapMemory, uint8_t, QuoteTraits> rb{std::move(space), true};
+
+    std::thread tw{rb_writer<decltype(rb)>, std::ref(rb)};
+    std::thread tr{rb_reader<decltype(rb)>, std::ref(rb)};
+    tw.join();
+    tr.join();
+}
+
+void run_shm() {
+    uint32_t size = 256 * 1024;
+    SharedMemory shm_c = SharedMemory::create_shared_memory("example_shm_flat_view", size);
+    SharedMemory shm_a = SharedMemory::attach_shared_memory("example_shm_flat_view");
+    CircularBuffer<SharedMemory, uint8_t, SequencedTraits<QuoteTraits>> rb_w{std::move(shm_c), true};
+    CircularBuffer<SharedMemory, uint8_t, SequencedTraits<QuoteTraits>> rb_r{std::move(shm_a)};
+
+    std::thread tw{rb_writer<decltype(rb_w)>, std::ref(rb_w)};
+    std::thread tr{rb_reader<decltype(rb_r)>, std::ref(rb_r)};
+    tw.join();
+    tr.join();
+}
+
+int main() {
+    run_heap();  // queue on heap
+    run_shm();   // queue on shared memory, records with sequence header
+    return 0;
+}
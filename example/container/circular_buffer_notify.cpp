@@ -0,0 +1,91 @@
+#include <RawSocket.h>
+#include <container/CircularBuffer.h>
+#include <media/SharedMemory.h>
+#include <sys/epoll.h>
+#include <thread>
+
+using namespace frenzy;
+
+static uint32_t N = 10;
+
+template <typename CircularBufferType>
+void rb_writer(CircularBufferType& rb_) {
+    for (uint32_t c = 1; c <= N;) {
+        if (rb_.write(c)) {
+            c++;
+            // low rate control channel
+            std::this_thread::sleep_for(std::chrono::milliseconds(50 * (rand() % 5)));
+        }
+    }
+}
+
+// sleeps on the futex word in Meta, no core burned while the channel is idle
+template <typename CircularBufferType>
+void rb_futex_reader(CircularBufferType& rb_) {
+    for (uint32_t c = 1; c <= N;) {
+        if (!rb_.wait_for_data(1000L * 1000 * 1000)) continue;
+        uint32_t e = 0;
+        while (rb_.read(e)) {
+            fprintf(stderr, "futex << : %u\n", e);
+            c++;
+        }
+    }
+}
+
+// ring readiness multiplexed by epoll, next to other sockets/timers
+template <typename CircularBufferType>
+void rb_epoll_reader(CircularBufferType& rb_) {
+    int epollfd = epoll_create1(0);
+    int ringfd = rb_.event_fd();
+    ztool::epoll_add(epollfd, ringfd);
+
+    struct epoll_event events[16];
+    for (uint32_t c = 1; c <= N;) {
+        int n = epoll_wait(epollfd, events, 16, 1000);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd != ringfd) continue;
+            uint64_t counter = 0;
+            ssize_t len = read(ringfd, &counter, sizeof(counter));  // clear readiness, then drain
+            (void)len;
+            uint32_t e = 0;
+            while (rb_.read(e)) {
+                fprintf(stderr, "epoll << : %u\n", e);
+                c++;
+            }
+        }
+    }
+    close(epollfd);
+}
+
+void run_futex() {
+    uint32_t size = 64 * 1024;
+    SharedMemory shm_c = SharedMemory::create_shared_memory("example_shm_notify1", size);
+    SharedMemory shm_a = SharedMemory::attach_shared_memory("example_shm_notify1");
+    CircularBuffer<SharedMemory, uint8_t, FlatStructTraits<uint32_t>> rb_w{std::move(shm_c), true};
+    CircularBuffer<SharedMemory, uint8_t, FlatStructTraits<uint32_t>> rb_r{std::move(shm_a)};
+    rb_w.enable_notify();
+
+    std::thread tw{rb_writer<decltype(rb_w)>, std::ref(rb_w)};
+    std::thread tr{rb_futex_reader<decltype(rb_r)>, std::ref(rb_r)};
+    tw.join();
+    tr.join();
+}
+
+void run_epoll() {
+    uint32_t size = 64 * 1024;
+    SharedMemory shm_c = SharedMemory::create_shared_memory("example_shm_notify2", size);
+    SharedMemory shm_a = SharedMemory::attach_shared_memory("example_shm_notify2");
+    CircularBuffer<SharedMemory, uint8_t, FlatStructTraits<uint32_t>> rb_w{std::move(shm_c), true};
+    CircularBuffer<SharedMemory, uint8_t, FlatStructTraits<uint32_t>> rb_r{std::move(shm_a)};
+
+    std::thread tr{rb_epoll_reader<decltype(rb_r)>, std::ref(rb_r)};
+    std::thread tw{rb_writer<decltype(rb_w)>, std::ref(rb_w)};
+    tw.join();
+    tr.join();
+}
+
+int main() {
+    run_futex();
+    run_epoll();
+    return 0;
+}
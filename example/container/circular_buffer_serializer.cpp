@@ -56,6 +56,7 @@ struct Serializer {
         memcpy(dst + sizeof(uint64_t), v_.addr, v_.len);
         return {dst, static_cast<uint32_t>(v_.len + sizeof(uint64_t))};
     }
+    static uint32_t size(const CharArray& v_) { return static_cast<uint32_t>(v_.len + sizeof(uint64_t)); }
     static uint32_t recordSize() { return 0; /* zero indicates variable record length. */ }
 
     uint8_t space[SIZE];
@@ -97,7 +98,7 @@ void rb_reader(CircularBufferType& rb_) {
 void run_heap() {
     uint32_t size = 256 * 1024;
     HeapMemory space{size};
-    CircularBuffer<HeapMemory, uint8_t, NonFlatStructTraits<CharArray, Serializer>> rb{std::move(space), true};
+    CircularBuffer<HeapMemory, uint8_t, ZeroCopyTraits<CharArray, Serializer>> rb{std::move(space), true};
 
     std::thread tw{rb_writer<decltype(rb)>, std::ref(rb)};
     std::thread tr{rb_reader<decltype(rb)>, std::ref(rb)};
@@ -110,8 +111,8 @@ void run_shm() {
     // writer creates shared memory and reader attaches
     SharedMemory shm_c1 = SharedMemory::create_shared_memory("example_shm_rb1", size);
     SharedMemory shm_a1 = SharedMemory::attach_shared_memory("example_shm_rb1");
-    CircularBuffer<SharedMemory, uint8_t, NonFlatStructTraits<CharArray, Serializer>> rb_w1{std::move(shm_c1), true};
-    CircularBuffer<SharedMemory, uint8_t, NonFlatStructTraits<CharArray, Serializer>> rb_r1{std::move(shm_a1)};
+    CircularBuffer<SharedMemory, uint8_t, ZeroCopyTraits<CharArray, Serializer>> rb_w1{std::move(shm_c1), true};
+    CircularBuffer<SharedMemory, uint8_t, ZeroCopyTraits<CharArray, Serializer>> rb_r1{std::move(shm_a1)};
 
     std::thread tw1{rb_writer<decltype(rb_w1)>, std::ref(rb_w1)};
     std::thread tr1{rb_reader<decltype(rb_r1)>, std::ref(rb_r1)};
@@ -121,8 +122,8 @@ void run_shm() {
     // attacher of shared memory can act as writer as well.
     SharedMemory shm_c2 = SharedMemory::create_shared_memory("example_shm_rb2", size);
     SharedMemory shm_a2 = SharedMemory::attach_shared_memory("example_shm_rb2");
-    CircularBuffer<SharedMemory, uint8_t, NonFlatStructTraits<CharArray, Serializer>> rb_w2{std::move(shm_a2), true};
-    CircularBuffer<SharedMemory, uint8_t, NonFlatStructTraits<CharArray, Serializer>> rb_r2{std::move(shm_c2)};
+    CircularBuffer<SharedMemory, uint8_t, ZeroCopyTraits<CharArray, Serializer>> rb_w2{std::move(shm_a2), true};
+    CircularBuffer<SharedMemory, uint8_t, ZeroCopyTraits<CharArray, Serializer>> rb_r2{std::move(shm_c2)};
 
     std::thread tw2{rb_writer<decltype(rb_w2)>, std::ref(rb_w2)};
     std::thread tr2{rb_reader<decltype(rb_r2)>, std::ref(rb_r2)};
@@ -0,0 +1,108 @@
+#include <coro/EventLoop.h>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef FRENZY_HAS_COROUTINES
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+
+using namespace std;
+using namespace frenzy;
+
+// counts every global allocation, pooled coroutine frames do not show up once the pools are warm
+static atomic<long> allocations{0};
+
+void *operator new(size_t n) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(n)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+struct Measure {
+    template <typename Body>
+    Measure(const char *name, long n, Body &&body) {
+        long before = allocations.load();
+        auto start = chrono::steady_clock::now();
+        body();
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        printf("%-44s %10.1f ns %10.3f allocs\n", name, ns / n, double(allocations.load() - before) / n);
+    }
+};
+
+coro::Task<long> leaf(long i) { co_return i + 1; }
+
+coro::Task<long> chain(long n) {
+    long sum = 0;
+    for (long i = 0; i < n; ++i) sum += co_await leaf(i);
+    co_return sum;
+}
+
+// the callback style the gateway uses, each step hands a std::function to the next
+void leaf_cb(long i, const function<void(long)> &done) { done(i + 1); }
+
+coro::Task<void> ticker(coro::EventLoop &loop, long n, int64_t step, long &count) {
+    int64_t t = coro::EventLoop::now();
+    for (long i = 0; i < n; ++i) {
+        t = co_await loop.sleep_until(t + step);
+        ++count;
+    }
+}
+
+coro::Task<void> consumer(coro::EventLoop &loop, MpmcBoundedQueue<long> &queue, long n, long &sum) {
+    for (long i = 0; i < n; ++i) sum += co_await loop.pop(queue);
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 1000 * 1000;
+    printf("%-44s %13s %17s\n", "per await", "time", "allocations");
+
+    coro::sync_wait(chain(1000));  // warms the frame pools
+    long sum = 0;
+    Measure("co_await of a child coroutine", n, [&] { sum += coro::sync_wait(chain(n)); });
+    Measure("callback through std::function", n, [&] {
+        for (long i = 0; i < n; ++i) leaf_cb(i, [&sum, i](long v) { sum += v + i; });
+    });
+
+    coro::EventLoop loop;
+    long ticks = 0, m = n / 10;
+    coro::spawn(loop, ticker(loop, m, 0, ticks));  // due right away, one timer per round
+    Measure("sleep_until on the loop's timer wheel", m, [&] {
+        while (ticks < m) loop.run_once(0);
+    });
+    ticks = 0;
+    TimerWheel<> &wheel = loop.wheel();
+    function<void(int64_t)> rearm = [&](int64_t t) {
+        if (++ticks < m) wheel.register_timer(rearm, t);
+    };
+    wheel.register_timer(rearm, coro::EventLoop::now());
+    Measure("TimerWheel callback re-registering itself", m, [&] {
+        while (ticks < m) loop.run_once(0);
+    });
+
+    MpmcBoundedQueue<long> queue(1024);
+    long received = 0;
+    coro::spawn(loop, consumer(loop, queue, n, received));
+    Measure("pop of a lock free queue, one per round", n, [&] {
+        for (long i = 0; i < n; ++i) {
+            queue.push(i);
+            loop.run_once(0);
+        }
+    });
+    printf("checksums %ld %ld\n", sum, received);
+    return 0;
+}
+
+#else
+
+int main() {
+    printf("frenzy::coro needs C++20, configure with -DFRENZY_COROUTINES=ON\n");
+    return 0;
+}
+
+#endif
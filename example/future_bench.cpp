@@ -0,0 +1,89 @@
+#include <thread/SimpleThreadPool.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// tasks per second of body(i) for i in [0, n)
+template <typename Body>
+double measure(long n, Body&& body) {
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i) body(i);
+    return n / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// what enqueue did before: make_shared packaged_task, bind, std::function around it
+template <typename F>
+function<void()> legacy_task(F f, future<double>& res) {
+    auto task = make_shared<packaged_task<double()>>(bind(f));
+    res = task->get_future();
+    return [task]() { (*task)(); };
+}
+
+int main(int argc, char** argv) {
+    long n = argc > 1 ? atol(argv[1]) : 1000 * 1000;
+    auto empty = [] { return 0.0; };
+    double a = 1, b = 2, c = 3, d = 4;
+    auto small = [a, b, c, d] { return a * b + c * d; };
+
+    // create, run and get on one thread, the cost of the task and future objects themselves
+    printf("%-36s %14s %14s\n", "single thread", "empty task/s", "small task/s");
+    auto legacy = [&](auto f) {
+        return measure(n, [&](long) {
+            future<double> res;
+            legacy_task(f, res)();
+            res.get();
+        });
+    };
+    auto pooled = [&](auto f) {
+        return measure(n, [&](long) {
+            frenzy::Promise<double> promise;
+            frenzy::Future<double> res = promise.get_future();
+            frenzy::Task task([promise = std::move(promise), f]() mutable { promise.run(f); });
+            task();
+            res.get();
+        });
+    };
+    printf("%-36s %14.0f %14.0f\n", "packaged_task + std::function", legacy(empty), legacy(small));
+    printf("%-36s %14.0f %14.0f\n", "Task + Promise/Future", pooled(empty), pooled(small));
+
+    // through a one worker pool, submitted and then all waited for
+    printf("%-36s %14s %14s\n", "SimpleThreadPool(1)", "empty task/s", "small task/s");
+    frenzy::SimpleThreadPool pool(1);
+    pool.start();
+    auto viaLegacy = [&](auto f) {
+        vector<future<double>> results(n);
+        return measure(n, [&](long i) {
+            pool.post(legacy_task(f, results[i]));
+            if (i == n - 1) for (auto& r : results) r.get();
+        });
+    };
+    auto viaEnqueue = [&](auto f) {
+        vector<frenzy::Future<double>> results(n);
+        return measure(n, [&](long i) {
+            results[i] = pool.enqueue(f);
+            if (i == n - 1) for (auto& r : results) r.get();
+        });
+    };
+    auto viaPost = [&](auto f) {
+        atomic<long> done{0};
+        return measure(n, [&](long i) {
+            pool.post([f, &done] {
+                volatile double v = f();
+                (void)v;
+                done.fetch_add(1, memory_order_relaxed);
+            });
+            if (i == n - 1) while (done.load() < n) this_thread::yield();
+        });
+    };
+    printf("%-36s %14.0f %14.0f\n", "old enqueue", viaLegacy(empty), viaLegacy(small));
+    printf("%-36s %14.0f %14.0f\n", "enqueue", viaEnqueue(empty), viaEnqueue(small));
+    printf("%-36s %14.0f %14.0f\n", "post", viaPost(empty), viaPost(small));
+    return 0;
+}
@@ -0,0 +1,34 @@
+#include <log/ShmLog.h>
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+// calling thread cost of formatting on the call site vs only copying arguments into shm
+template <typename F>
+double measure(const char* name, int n, F&& f) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) f(i);
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / n;
+    fprintf(stderr, "%s: %.1f ns per log\n", name, ns);
+    return ns;
+}
+
+int main() {
+    frenzy::ShmLog::instance().initShm("", 256 * 1024 * 1024, 4);  // one writer thread, keep the burst in its region
+    frenzy::ShmLog::instance().open("/tmp/shm_log_deferred.log", frenzy::SLP_INFO, false);
+
+    const int N = 200 * 1000;
+    string symbol = "IF2312";
+    measure("vsnprintf", N, [&](int i) {
+        SHM_PERFORM_LOG(frenzy::SLP_INFO, __FILE__, __LINE__, "order %d %s price %.2f qty %ld", i, symbol.c_str(),
+                        4000.5 + i, 10L * i);
+    });
+    measure("deferred", N, [&](int i) {
+        SHM_PERFORM_DEFERRED_LOG(frenzy::SLP_INFO, __FILE__, __LINE__, "order %d %s price %.2f qty %ld", i, symbol,
+                                 4000.5 + i, 10L * i);
+    });
+
+    this_thread::sleep_for(chrono::seconds(2));  // let dump thread write both kinds of lines
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <thread/SimpleThreadPool.h>
+#include <thread/TaskScheduler.h>
+#include <thread/ThreadPool.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+static atomic<long> counter{0};
+
+class CountJob : public frenzy::PThreadPool::PThreadJob {
+public:
+    void Run(void*) override { counter.fetch_add(1, memory_order_relaxed); }
+};
+
+// tasks per second, counted until every task has run
+template <typename Submit>
+double measure(long tasks, Submit&& submit) {
+    counter.store(0);
+    auto start = chrono::steady_clock::now();
+    submit();
+    while (counter.load(memory_order_relaxed) < tasks) this_thread::yield();
+    return tasks / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    long tasks = argc > 1 ? atol(argv[1]) : 200 * 1000;
+    int depth = argc > 2 ? atoi(argv[2]) : 16;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    auto inc = [] { counter.fetch_add(1, memory_order_relaxed); };
+
+    // tiny tasks submitted one by one from main
+    double pthreadPool = 0;
+    {
+        frenzy::PThreadPool pool(threads);
+        pthreadPool = measure(tasks, [&] {
+            for (long i = 0; i < tasks; ++i) pool.Run(new CountJob, nullptr, true);
+        });
+        pool.SyncAll();
+    }
+    double simplePool = 0;
+    {
+        frenzy::SimpleThreadPool pool(threads);
+        pool.start();
+        simplePool = measure(tasks, [&] {
+            for (long i = 0; i < tasks; ++i) pool.enqueue(inc);
+        });
+    }
+    double scheduler = 0;
+    {
+        frenzy::TaskScheduler pool(threads);
+        scheduler = measure(tasks, [&] {
+            for (long i = 0; i < tasks; ++i) pool.submit(inc);
+        });
+    }
+
+    // binary tree of tasks spawned from inside tasks, PThreadPool blocks in Run once every thread is busy
+    long leaves = 1L << depth;
+    double simpleTree = 0;
+    {
+        frenzy::SimpleThreadPool pool(threads);
+        pool.start();
+        function<void(int)> spawn = [&](int d) {
+            if (d == 0) return inc();
+            pool.enqueue(spawn, d - 1);
+            pool.enqueue(spawn, d - 1);
+        };
+        simpleTree = measure(leaves, [&] { pool.enqueue(spawn, depth); });
+    }
+    double schedulerTree = 0;
+    {
+        function<void(int)> spawn;
+        frenzy::TaskScheduler pool(threads);
+        spawn = [&](int d) {
+            if (d == 0) return inc();
+            pool.submit([&spawn, d] { spawn(d - 1); });
+            pool.submit([&spawn, d] { spawn(d - 1); });
+        };
+        schedulerTree = measure(leaves, [&] { pool.submit([&spawn, depth] { spawn(depth); }); });
+    }
+
+    printf("%u threads, %ld external submits, spawn tree of %ld leaves\n", threads, tasks, leaves);
+    printf("%-28s %16s %16s\n", "", "external task/s", "spawn leaf/s");
+    printf("%-28s %16.0f %16s\n", "PThreadPool::Run", pthreadPool, "-");
+    printf("%-28s %16.0f %16.0f\n", "SimpleThreadPool::enqueue", simplePool, simpleTree);
+    printf("%-28s %16.0f %16.0f\n", "TaskScheduler::submit", scheduler, schedulerTree);
+    return 0;
+}
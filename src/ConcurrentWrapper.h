@@ -1,6 +1,7 @@
 #ifndef CONCURRENT_CONCURRENT_WRAPPER_H
 #define CONCURRENT_CONCURRENT_WRAPPER_H
 
+#include <functional>
 #include <future>
 #include <thread>
 #include "ConcurrentQueue.h"
@@ -20,10 +21,15 @@ void promise_set_value(std::promise<void>& prom, Future& f, T& t) {
 }
 }
 
-template <typename T>
+/**
+ * all access to resource is serialized on one worker thread
+ * @tparam Queue task queue policy, push(task) from any thread and blocking pop() on the worker,
+ * e.g. MpscTaskQueue for a lock free queue of small buffer optimized tasks
+ */
+template <typename T, typename Queue = ConcurrentQueue<std::function<void()>>>
 class ConcurrentWrapper {
 private:
-    mutable ConcurrentQueue<std::function<void()>> queue_;
+    mutable Queue queue_;
     T resource_;
     std::thread worker_;
     bool done_;
@@ -0,0 +1,90 @@
+#ifndef CONCURRENT_SLAB_POOL_H
+#define CONCURRENT_SLAB_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "utils/CpuTopology.h"
+
+namespace frenzy {
+
+/**
+ * thread safe pool of fixed size blocks, for small objects allocated on one thread and freed on another.
+ * each thread keeps a cache of free blocks, it trades BatchSize blocks with a locked global list when it runs
+ * empty or gets too full, so the mutex is taken once per BatchSize calls. slabs are never given back to the system.
+ * there is one global list per numa node, a thread trades with the list of the node it runs on, so blocks freed
+ * on a node are handed out again on that node. a block freed on another node than it came from joins that node.
+ */
+template <std::size_t BlockSize, std::size_t BatchSize = 64>
+class SlabPool {
+    static_assert(BlockSize % alignof(std::max_align_t) == 0, "blocks keep max alignment");
+
+public:
+    static constexpr std::size_t SlabBlocks = 16 * BatchSize;
+    static constexpr int MaxNodes = 16;  // nodes beyond share lists
+
+    static void *allocate() {
+        Cache &c = cache();
+        if (c.count == 0) refill(c);
+        return c.blocks[--c.count];
+    }
+
+    static void deallocate(void *p_) {
+        Cache &c = cache();
+        if (c.count == 2 * BatchSize) spill(c);
+        c.blocks[c.count++] = p_;
+    }
+
+private:
+    struct Cache {
+        ~Cache() {
+            while (count > 0) spill(*this);
+        }
+
+        void *blocks[2 * BatchSize];
+        std::size_t count{0};
+    };
+
+    struct Global {
+        std::mutex mutex;
+        std::vector<void *> free;
+        std::vector<std::unique_ptr<char[]>> slabs;
+    };
+
+    static Cache &cache() {
+        thread_local Cache c;
+        return c;
+    }
+
+    // list of the node the calling thread runs on, looked up once per batch
+    static Global &global() {
+        static Global *g = new Global[MaxNodes];  // outlives the thread local caches spilling into it at exit
+        return g[current_node() % MaxNodes];
+    }
+
+    static void refill(Cache &c_) {
+        Global &g = global();
+        std::lock_guard<std::mutex> lock(g.mutex);
+        if (g.free.size() < BatchSize) {
+            g.slabs.emplace_back(new char[BlockSize * SlabBlocks]);
+            char *slab = g.slabs.back().get();
+            for (std::size_t i = 0; i < SlabBlocks; ++i) g.free.push_back(slab + i * BlockSize);
+        }
+        for (std::size_t i = 0; i < BatchSize; ++i) {
+            c_.blocks[c_.count++] = g.free.back();
+            g.free.pop_back();
+        }
+    }
+
+    static void spill(Cache &c_) {
+        Global &g = global();
+        std::size_t n = c_.count < BatchSize ? c_.count : BatchSize;
+        std::lock_guard<std::mutex> lock(g.mutex);
+        for (std::size_t i = 0; i < n; ++i) g.free.push_back(c_.blocks[--c_.count]);
+    }
+};
+}  // namespace frenzy
+
+#endif
@@ -1,14 +1,22 @@
 #ifndef CONCURRENT_CIRCULAR_BUFFER_H
 #define CONCURRENT_CIRCULAR_BUFFER_H
 
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <ctime>
+#include <functional>
 #include <limits>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
+#include "container/RecordJournal.h"
 #include "media/HeapMemory.h"
 #include "utils/FrenzyException.h"
+#include "utils/Futex.h"
 
 namespace frenzy {
 struct Buffer {
@@ -39,6 +47,8 @@ struct NullSerializer {
 template <typename T, typename S = NullSerializer<T>>
 struct FlatStructTraits {
     const static bool isFlat = true;
+    const static bool isSequenced = false;
+    const static bool isZeroCopy = false;
     using Serializer = S;
     using Type = T;
 };
@@ -46,17 +56,116 @@ struct FlatStructTraits {
 template <typename T, typename S>
 struct NonFlatStructTraits {
     const static bool isFlat = false;
+    const static bool isSequenced = false;
+    const static bool isZeroCopy = false;
     using Serializer = S;
     using Type = T;  // Element Type given to CircularBuffer must be uint8_t
 };
 
+/**
+ * Serializer writes straight into the span returned by get_write_pointer, no temporary Buffer.
+ * S must provide:
+ *   static uint32_t size(const T &)                   exact record size of the value
+ *   Buffer serialize(const T &, uint8_t *dst)          serialize in place
+ * and optionally, for read_view:
+ *   using View = ...;
+ *   static std::pair<const View *, uint32_t> view(const uint8_t *, uint32_t)   typed view, record size
+ */
+template <typename T, typename S>
+struct ZeroCopyTraits {
+    const static bool isFlat = false;
+    const static bool isSequenced = false;
+    const static bool isZeroCopy = true;
+    using Serializer = S;
+    using Type = T;  // Element Type given to CircularBuffer must be uint8_t
+};
+
+/**
+ * records written by write() are prefixed with a RecordHeader (seq + timestamp),
+ * so reader could detect gaps, seek(seq) and replay from journal.
+ * raw get_write_pointer/commit_write users should not mix with it.
+ */
+template <typename BaseTraits>
+struct SequencedTraits : BaseTraits {
+    const static bool isSequenced = true;
+};
+
+/**
+ * turns writer commits into eventfd readiness, so a ring could sit in an epoll loop next to sockets.
+ * a background thread sleeps on the futex word of the ring on behalf of the reader, like wait_for_data only once
+ * the reader drained the ring. while records are pending it polls every PendingPollNs without readerWaiting set,
+ * so a writer running ahead of the reader makes no FUTEX_WAKE syscall.
+ */
+class RingEventBridge {
+public:
+    static constexpr int64_t PendingPollNs = 100 * 1000;
+
+    RingEventBridge(std::atomic<uint32_t> *commitCount_, std::atomic<uint32_t> *readerWaiting_,
+                    std::function<bool()> empty_)
+        : commitCount{commitCount_}, readerWaiting{readerWaiting_}, empty{std::move(empty_)} {
+        fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0) THROW_FRENZY_EXCEPTION("RingEventBridge eventfd: " << strerror(errno));
+        worker = std::thread([this] { run(); });
+    }
+
+    ~RingEventBridge() {
+        stop.store(true, std::memory_order_release);
+        futex_wake(commitCount);
+        worker.join();
+        close(fd);
+    }
+
+    RingEventBridge(const RingEventBridge &) = delete;
+    RingEventBridge &operator=(const RingEventBridge &) = delete;
+
+    int event_fd() const { return fd; }
+
+private:
+    void run() {
+        uint32_t last = commitCount->load(std::memory_order_acquire);
+        signal();  // data may be there before the bridge starts
+        while (!stop.load(std::memory_order_acquire)) {
+            uint32_t count = commitCount->load(std::memory_order_acquire);
+            if (count != last) {
+                last = count;
+                signal();
+            }
+            if (!empty()) {  // the reader has work, nobody needs waking until it catches up
+                futex_wait(commitCount, count, PendingPollNs);
+                continue;
+            }
+            readerWaiting->store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (commitCount->load(std::memory_order_acquire) == count && empty()) {
+                futex_wait(commitCount, count, CheckStopNs);
+            }
+            readerWaiting->store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void signal() {
+        uint64_t one = 1;
+        ssize_t n = write(fd, &one, sizeof(one));
+        (void)n;
+    }
+
+    static constexpr int64_t CheckStopNs = 100 * 1000 * 1000;
+
+    std::atomic<uint32_t> *commitCount{nullptr};
+    std::atomic<uint32_t> *readerWaiting{nullptr};
+    std::function<bool()> empty;  // true once the reader consumed every commit
+    std::atomic<bool> stop{false};
+    int fd{-1};
+    std::thread worker;
+};
+
 /**
  * for single writer single reader
  */
 template <typename MemorySpace = HeapMemory, typename Element = uint8_t, typename Traits = FlatStructTraits<Element>>
 class CircularBuffer {
 private:
-    static constexpr uint32_t CbMagic = 0x00108023;
+    static constexpr uint32_t CbMagic = 0x00108024;  // bumped whenever Meta changes
     struct alignas(64) Meta {
         uint32_t magic{CbMagic};
         uint32_t metaSize{sizeof(Meta)};
@@ -64,11 +173,14 @@ private:
         uint32_t elementSize{sizeof(Element)};
         uint32_t dataOffset{0};
         uint32_t recordSize{0};               // 0 indicates variable length
+        uint32_t sequenced{0};                // 1 if every record has a RecordHeader
+        std::atomic<uint32_t> notifyEnabled;  // 1 if writer should wake sleeping reader, see enable_notify
         std::atomic<uint32_t> isInitialized;  // set the value to 1 after all other fields set.
         // writer acquires it before writing to the buffer, reader releases it after committing the read.
         alignas(64) std::atomic<uint32_t> readerPos;
         // reader acquires it before reading the buffer, writer releases it after committing the write.
         alignas(64) std::atomic<uint32_t> writerPos;
+        std::atomic<uint64_t> writerSeq;  // seq of last committed record, sequenced mode only
         /**
          * when writer starts over from the begin, wrap keeps where the writer stops.
          * writer only updates wrap when writerPos > readerPos
@@ -76,14 +188,25 @@ private:
          * there is no simultaneous access.
          */
         uint32_t wrap = 0;
+        // futex word, writer bumps it on every commit when notifyEnabled
+        alignas(64) std::atomic<uint32_t> commitCount;
+        // set by the reader before it sleeps on commitCount, writer only issues FUTEX_WAKE when set
+        std::atomic<uint32_t> readerWaiting;
     };
 
     MemorySpace space;
     Meta *meta;
+    uint64_t lastSeq{0};                                    // reader side, seq of last consumed record
+    std::function<void(uint64_t, uint64_t)> gapHandler;     // reader side, see on_gap
+    std::unique_ptr<RecordJournal> journal;                 // optional, see enable_journal
+    std::vector<uint8_t> replay;                            // framed records loaded from journal by seek
+    size_t replayPos{0};
+    std::unique_ptr<RingEventBridge> eventBridge;           // reader side, see event_fd
 
 public:
     using ElementType = Element;
     using Serializer = typename Traits::Serializer;
+    using GapHandler = std::function<void(uint64_t from_, uint64_t to_)>;
 
     CircularBuffer(MemorySpace &&space_, bool init_ = false) : space{std::move(space_)} {
         if (space.capacity() <= offset()) THROW_FRENZY_EXCEPTION("CircularBuffer: Insufficient space.");
@@ -94,16 +217,24 @@ public:
             meta->capacity = cap;
             meta->dataOffset = offset();
             meta->recordSize = Serializer::recordSize();
+            meta->sequenced = Traits::isSequenced ? 1 : 0;
             meta->readerPos.store(0, std::memory_order_release);
             meta->writerPos.store(0, std::memory_order_release);
+            meta->writerSeq.store(0, std::memory_order_release);
+            meta->notifyEnabled.store(0, std::memory_order_release);
+            meta->commitCount.store(0, std::memory_order_release);
+            meta->readerWaiting.store(0, std::memory_order_release);
             meta->isInitialized.store(1, std::memory_order_release);
         } else {
             meta = reinterpret_cast<Meta *>(space.buffer);
             if (meta->isInitialized.load(std::memory_order_acquire) != 1)
                 THROW_FRENZY_EXCEPTION("CircularBuffer: Peer initialization not finished.");
             if (meta->magic != CbMagic) THROW_FRENZY_EXCEPTION("CircularBuffer: Magic number mismatch.");
+            if (meta->metaSize != sizeof(Meta)) THROW_FRENZY_EXCEPTION("CircularBuffer: Meta layout mismatch.");
             if (meta->elementSize != sizeof(ElementType))
                 THROW_FRENZY_EXCEPTION("CircularBuffer: sizeof ElementType mismatch.");
+            if (meta->sequenced != (Traits::isSequenced ? 1u : 0u))
+                THROW_FRENZY_EXCEPTION("CircularBuffer: sequenced mode mismatch.");
         }
     }
 
@@ -258,7 +389,10 @@ public:
      * Commit write
      * @param size_ how many bytes to commit
      */
-    void commit_write(uint32_t size_) { meta->writerPos.fetch_add(size_, std::memory_order_release); }
+    void commit_write(uint32_t size_) {
+        meta->writerPos.fetch_add(size_, std::memory_order_release);
+        if (meta->notifyEnabled.load(std::memory_order_relaxed)) wake_reader();
+    }
 
     /**
      * Request write to the CircularBuffer
@@ -278,34 +412,50 @@ public:
 public:
     /**
      * Write Elem to the CircularBuffer, serialized data is copied into CircularBuffer.
+     * With ZeroCopyTraits the Serializer writes in place instead.
+     * @return false if the ring is full or the journal write failed, nothing is written then
      */
     template <typename Elem>
     bool write(const Elem &value_) {
-        Serializer s;
-        auto p = s.serialize(value_);
-        uint8_t *dst = nullptr;
-        if (get_write_pointer(dst, p.length) != p.length) {
-            return false;
+        if constexpr (Traits::isZeroCopy) {
+            return write(value_, Serializer::size(value_));
         } else {
-            memcpy(dst, p.address, p.length);
-            commit_write(p.length);
+            Serializer s;
+            auto p = s.serialize(value_);
+            if (Traits::isSequenced) return write_record(p.address, p.length);
+            uint8_t *dst = nullptr;
+            if (get_write_pointer(dst, p.length) != p.length) {
+                return false;
+            } else {
+                memcpy(dst, p.address, p.length);
+                commit_write(p.length);
+            }
+            return true;
         }
-        return true;
     }
 
     /**
      * Write Elem to the CircularBuffer, with length_ if we know the output size ahead.
      * Request space from CircularBuffer before serialize.
      * Serializer then could serialize in place, to avoid one copy.
+     * @return false if the ring is full or the Serializer returns an empty Buffer, e.g. FlatBuilder::finish()
+     *         ran out of space, the slot is abandoned and nothing is committed then
      */
     template <typename Elem>
     bool write(const Elem &value_, uint32_t length_) {
         uint8_t *dst = nullptr;
-        if (get_write_pointer(dst, length_) != length_) {
+        const uint32_t total = Traits::isSequenced ? length_ + HeaderSize : length_;
+        if (get_write_pointer(dst, total) != total) {
             return false;
+        } else if (Traits::isSequenced) {
+            Serializer s;
+            Buffer b = s.serialize(value_, dst + HeaderSize);
+            if (b.address == nullptr || b.length == 0) return false;
+            return publish_record(dst, length_);
         } else {
             Serializer s;
-            auto p = s.serialize(value_, dst);
+            Buffer b = s.serialize(value_, dst);
+            if (b.address == nullptr || b.length == 0) return false;
             commit_write(length_);
         }
         return true;
@@ -313,6 +463,14 @@ public:
 
     template <typename Elem>
     bool read(Elem &e_) {
+        if (Traits::isSequenced) {
+            const uint8_t *record = next_record();
+            if (record == nullptr) return false;
+            const RecordHeader *header = reinterpret_cast<const RecordHeader *>(record);
+            auto p = Serializer::deserialize(record + HeaderSize, header->length, e_);
+            consume_record(*header);
+            return p.first;
+        }
         uint8_t *dst = nullptr;
         uint32_t length = get_read_pointer(dst);
         if (length == 0) {
@@ -323,11 +481,56 @@ public:
         return p.first;
     }
 
+    /**
+     * Zero copy read, f_ is called with a typed read only view over the record bytes in the ring.
+     * The view is only valid inside f_, record is committed after f_ returns.
+     * A record the Serializer can not view is consumed without calling f_, like a failed read().
+     * Without sequencing its end is unknown, the readable span up to the writer or the wrap is skipped then.
+     * @return false if there is no record or it was skipped
+     */
+    template <typename F>
+    bool read_view(F &&f_) {
+        static_assert(Traits::isZeroCopy, "read_view requires ZeroCopyTraits");
+        if constexpr (Traits::isSequenced) {
+            const uint8_t *record = next_record();
+            if (record == nullptr) return false;
+            const RecordHeader *header = reinterpret_cast<const RecordHeader *>(record);
+            auto p = Serializer::view(record + HeaderSize, header->length);
+            if (p.first != nullptr) f_(*p.first);
+            consume_record(*header);
+            return p.first != nullptr;
+        } else {
+            uint8_t *dst = nullptr;
+            uint32_t length = get_read_pointer(dst);
+            if (length == 0) return false;
+            auto p = Serializer::view(dst, length);
+            if (p.first == nullptr) {
+                commit_read(length);
+                return false;
+            }
+            f_(*p.first);
+            commit_read(p.second);
+        }
+        return true;
+    }
+
     /**
      * Read n Elements from the CircularBuffer.
      */
     template <typename Elem>
     uint32_t read(std::vector<Elem> &vec_, size_t n_) {
+        if (Traits::isSequenced) {
+            uint32_t cnt = 0;
+            const uint8_t *record = nullptr;
+            while (cnt < n_ && (record = next_record()) != nullptr) {
+                const RecordHeader *header = reinterpret_cast<const RecordHeader *>(record);
+                auto p = Serializer::deserialize(record + HeaderSize, header->length);
+                consume_record(*header);
+                vec_.push_back(std::move(p.first));
+                cnt++;
+            }
+            return cnt;
+        }
         uint8_t *dst = nullptr;
         uint32_t length = get_read_pointer(dst);
         if (length == 0) {
@@ -346,7 +549,184 @@ public:
         return cnt;
     }
 
+public:
+    /**
+     * Let the writer wake up sleeping readers, either side may call it.
+     * Costs the writer one fence per commit afterwards, FUTEX_WAKE syscall only when a reader is asleep.
+     */
+    void enable_notify() { meta->notifyEnabled.store(1, std::memory_order_release); }
+
+    bool empty() const { return writer_pos(std::memory_order_acquire) == reader_pos(std::memory_order_relaxed); }
+
+    /**
+     * Block the reader until the writer commits something, instead of spinning on get_read_pointer
+     * only one thread per ring should wait, either this or the eventfd bridge
+     * @param timeoutNs_ negative means wait forever
+     * @return false if still nothing to read, e.g. timeout
+     */
+    bool wait_for_data(int64_t timeoutNs_ = -1) {
+        if (!empty()) return true;
+        enable_notify();
+        uint32_t count = meta->commitCount.load(std::memory_order_acquire);
+        meta->readerWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (empty()) futex_wait(&meta->commitCount, count, timeoutNs_);
+        meta->readerWaiting.store(0, std::memory_order_relaxed);
+        return !empty();
+    }
+
+    /**
+     * eventfd which becomes readable after writer commits, for epoll loops (see ztool::epoll_add in RawSocket.h)
+     * reader reads the eventfd to clear it then drains the ring until empty.
+     * the fd belongs to this CircularBuffer, do not close it.
+     */
+    int event_fd() {
+        if (!eventBridge) {
+            enable_notify();
+            eventBridge.reset(
+                new RingEventBridge(&meta->commitCount, &meta->readerWaiting, [this] { return empty(); }));
+        }
+        return eventBridge->event_fd();
+    }
+
+    /**
+     * seq of the last record consumed by this reader, 0 if nothing consumed yet
+     */
+    uint64_t last_seq() const { return lastSeq; }
+
+    /**
+     * seq of the last record committed by the writer
+     */
+    uint64_t writer_seq() const { return meta->writerSeq.load(std::memory_order_acquire); }
+
+    /**
+     * handler_(from, to) is called when reader finds records [from, to] are missing,
+     * e.g. reader attaches late or restarts. call seek(from) inside handler to replay them.
+     */
+    void on_gap(GapHandler handler_) { gapHandler = std::move(handler_); }
+
+    /**
+     * writer side: append every record to the journal file as well
+     * reader side: fetch records from the journal when they are gone from the ring
+     */
+    void enable_journal(const std::string &path_, bool writer_) {
+        journal.reset(new RecordJournal(path_, writer_));
+    }
+
+    /**
+     * Position the reader so that the next read returns record seq_
+     * unread records before seq_ are dropped, records no longer in the ring are loaded from journal
+     * @return false if seq_ is neither in the ring nor in the journal
+     */
+    bool seek(uint64_t seq_) {
+        static_assert(Traits::isSequenced, "seek requires SequencedTraits");
+        replay.clear();
+        replayPos = 0;
+
+        uint64_t firstUnread = 0;
+        uint8_t *buf = nullptr;
+        while (get_read_pointer(buf) != 0) {
+            const RecordHeader *header = reinterpret_cast<const RecordHeader *>(buf);
+            if (header->seq >= seq_) {
+                firstUnread = header->seq;
+                break;
+            }
+            commit_read(HeaderSize + header->length);
+        }
+
+        uint64_t missingTo = 0;
+        if (firstUnread == 0) {  // ring drained
+            uint64_t wSeq = writer_seq();
+            if (seq_ > wSeq + 1) return false;
+            missingTo = wSeq;
+        } else {
+            missingTo = firstUnread - 1;
+        }
+
+        if (seq_ <= missingTo) {
+            if (!journal || journal->is_writer()) return false;
+            uint32_t n = journal->fetch(seq_, missingTo, replay);
+            if (n == 0 || reinterpret_cast<const RecordHeader *>(replay.data())->seq != seq_) {
+                replay.clear();
+                return false;
+            }
+        }
+        lastSeq = seq_ - 1;
+        return true;
+    }
+
 private:
+    static constexpr uint32_t HeaderSize = sizeof(RecordHeader);
+
+    // Dekker style handshake with wait_for_data, fence orders commitCount store before readerWaiting load
+    void wake_reader() {
+        meta->commitCount.fetch_add(1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (meta->readerWaiting.load(std::memory_order_relaxed)) futex_wake(&meta->commitCount);
+    }
+
+    bool write_record(const uint8_t *payload_, uint32_t length_) {
+        uint8_t *dst = nullptr;
+        const uint32_t total = length_ + HeaderSize;
+        if (get_write_pointer(dst, total) != total) return false;
+        memcpy(dst + HeaderSize, payload_, length_);
+        return publish_record(dst, length_);
+    }
+
+    /**
+     * payload already in place after the header, fill header, journal it and commit.
+     * @return false if the journal write failed, the record is not committed then, so the ring and the journal
+     *         never disagree and seek() finds no hole
+     */
+    bool publish_record(uint8_t *dst_, uint32_t length_) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        RecordHeader *header = reinterpret_cast<RecordHeader *>(dst_);
+        header->seq = meta->writerSeq.load(std::memory_order_relaxed) + 1;
+        header->timestamp = ts.tv_sec * 1000000000L + ts.tv_nsec;
+        header->length = length_;
+        header->reserved = 0;
+        if (journal && !journal->append(*header, dst_ + HeaderSize)) return false;
+        commit_write(length_ + HeaderSize);
+        meta->writerSeq.store(header->seq, std::memory_order_release);
+        return true;
+    }
+
+    // next framed record, replayed journal records come first, nullptr if nothing to read
+    const uint8_t *next_record() {
+        const uint8_t *record = peek_record();
+        if (record == nullptr || !gapHandler) return record;
+        const uint64_t seq = reinterpret_cast<const RecordHeader *>(record)->seq;
+        if (seq > lastSeq + 1) {
+            gapHandler(lastSeq + 1, seq - 1);  // handler may seek, peek again
+            record = peek_record();
+        }
+        return record;
+    }
+
+    const uint8_t *peek_record() {
+        if (replayPos < replay.size()) {
+            return replay.data() + replayPos;
+        }
+        uint8_t *buf = nullptr;
+        if (get_read_pointer(buf) == 0) return nullptr;
+        return buf;
+    }
+
+    void consume_record(const RecordHeader &header_) {
+        lastSeq = header_.seq;
+        const uint32_t frameSize = HeaderSize + header_.length;
+        if (replayPos < replay.size()) {
+            replayPos += frameSize;
+            if (replayPos >= replay.size()) {
+                replay.clear();
+                replayPos = 0;
+            }
+        } else {
+            commit_read(frameSize);
+        }
+    }
+
     constexpr uint32_t offset() const { return std::max<uint32_t>(sizeof(Meta), sizeof(Element)); }
     uint8_t *get_payload() const { return reinterpret_cast<uint8_t *>(meta) + offset(); }
     uint32_t writer_pos(std::memory_order order_) const { return meta->writerPos.load(order_); }
@@ -0,0 +1,148 @@
+#ifndef CONCURRENT_FLAT_VIEW_H
+#define CONCURRENT_FLAT_VIEW_H
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace frenzy {
+
+/**
+ * flat-buffer style variable length fields, offset is relative to the field itself,
+ * so a view over the record bytes is usable wherever the bytes are mapped, no fix up needed.
+ */
+template <typename T>
+struct FlatVector {
+    static_assert(std::is_trivially_copyable<T>::value, "FlatVector element must be trivially copyable");
+
+    uint32_t offset{0};
+    uint32_t count{0};
+
+    const T *data() const { return reinterpret_cast<const T *>(reinterpret_cast<const uint8_t *>(this) + offset); }
+    uint32_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T *begin() const { return data(); }
+    const T *end() const { return data() + count; }
+    const T &operator[](uint32_t i_) const { return data()[i_]; }
+};
+
+struct FlatString {
+    uint32_t offset{0};
+    uint32_t length{0};  // '\0' excluded
+
+    const char *data() const { return reinterpret_cast<const char *>(this) + offset; }
+    const char *c_str() const { return data(); }
+    uint32_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    std::string_view view() const { return {data(), length}; }
+};
+
+/**
+ * record layout: | uint32_t size | uint32_t pad | Root | tail of strings and vectors |
+ * Root is a trivially copyable struct which may contain FlatString and FlatVector fields
+ */
+template <typename Root>
+class FlatBuilder {
+public:
+    static_assert(std::is_trivially_copyable<Root>::value, "Root must be trivially copyable");
+
+    static constexpr uint32_t Alignment = 8;
+    static constexpr uint32_t RootOffset = Alignment;
+
+    static constexpr uint32_t align(uint32_t x_) { return (x_ + Alignment - 1) & ~(Alignment - 1); }
+    static constexpr uint32_t fixed_size() { return align(RootOffset + sizeof(Root)); }
+    static constexpr uint32_t string_size(uint32_t length_) { return align(length_ + 1); }
+    template <typename T>
+    static constexpr uint32_t vector_size(uint32_t count_) {
+        return align(static_cast<uint32_t>(count_ * sizeof(T)));
+    }
+
+    FlatBuilder(uint8_t *dst_, uint32_t capacity_) : dst{dst_}, capacity{capacity_}, pos{fixed_size()} {
+        if (capacity < fixed_size()) {
+            good = false;
+        } else {
+            new (dst + RootOffset) Root{};
+        }
+    }
+
+    Root *root() { return good ? reinterpret_cast<Root *>(dst + RootOffset) : nullptr; }
+
+    bool set(FlatString &field_, const char *str_, uint32_t length_) {
+        uint8_t *p = reserve(string_size(length_));
+        if (p == nullptr) return false;
+        memcpy(p, str_, length_);
+        p[length_] = '\0';
+        field_.offset = relative(&field_, p);
+        field_.length = length_;
+        return true;
+    }
+
+    bool set(FlatString &field_, const std::string &str_) {
+        return set(field_, str_.data(), static_cast<uint32_t>(str_.size()));
+    }
+
+    template <typename T>
+    bool set(FlatVector<T> &field_, const T *values_, uint32_t count_) {
+        uint8_t *p = reserve(vector_size<T>(count_));
+        if (p == nullptr) return false;
+        memcpy(p, values_, count_ * sizeof(T));
+        field_.offset = relative(&field_, p);
+        field_.count = count_;
+        return true;
+    }
+
+    template <typename T>
+    bool set(FlatVector<T> &field_, const std::vector<T> &values_) {
+        return set(field_, values_.data(), static_cast<uint32_t>(values_.size()));
+    }
+
+    /**
+     * @return total bytes of the record, 0 if capacity exceeded
+     */
+    uint32_t finish() {
+        if (!good) return 0;
+        memcpy(dst, &pos, sizeof(uint32_t));
+        return pos;
+    }
+
+private:
+    uint8_t *reserve(uint32_t size_) {
+        if (!good || pos + size_ > capacity) {
+            good = false;
+            return nullptr;
+        }
+        uint8_t *p = dst + pos;
+        pos += size_;
+        return p;
+    }
+
+    static uint32_t relative(const void *field_, const uint8_t *target_) {
+        return static_cast<uint32_t>(target_ - reinterpret_cast<const uint8_t *>(field_));
+    }
+
+    uint8_t *dst{nullptr};
+    uint32_t capacity{0};
+    uint32_t pos{0};
+    bool good{true};
+};
+
+/**
+ * typed read only view over a record built by FlatBuilder
+ * @return {root, record size}, {nullptr, 0} if length_ is not enough for a complete record
+ */
+template <typename Root>
+std::pair<const Root *, uint32_t> flat_view(const uint8_t *buffer_, uint32_t length_) {
+    uint32_t size = 0;
+    if (length_ < FlatBuilder<Root>::fixed_size()) return {nullptr, 0};
+    memcpy(&size, buffer_, sizeof(uint32_t));
+    if (size > length_) return {nullptr, 0};
+    return {reinterpret_cast<const Root *>(buffer_ + FlatBuilder<Root>::RootOffset), size};
+}
+}  // namespace frenzy
+
+#endif
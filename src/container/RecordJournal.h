@@ -0,0 +1,124 @@
+#ifndef CONCURRENT_RECORD_JOURNAL_H
+#define CONCURRENT_RECORD_JOURNAL_H
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "utils/FrenzyException.h"
+
+namespace frenzy {
+
+/**
+ * header put in front of every record of a sequenced CircularBuffer, also the framing of the journal file
+ */
+struct RecordHeader {
+    uint64_t seq{0};        // monotonic, starts from 1
+    int64_t timestamp{0};   // nanoseconds since epoch when the record is written
+    uint32_t length{0};     // payload length, header excluded
+    uint32_t reserved{0};
+};
+
+/**
+ * append only file of framed records, writer appends every record it puts into the ring,
+ * reader fetches ranges which are no longer available in the ring.
+ */
+class RecordJournal {
+public:
+    RecordJournal(const std::string &path_, bool writer_) : path{path_}, isWriter{writer_} {
+        int flags = writer_ ? (O_CREAT | O_WRONLY | O_APPEND) : O_RDONLY;
+        fd = ::open(path_.c_str(), flags, 0666);
+        if (fd < 0) THROW_FRENZY_EXCEPTION("RecordJournal open: " << strerror(errno) << " : " << path_);
+        if (writer_) end = ::lseek(fd, 0, SEEK_END);
+    }
+
+    ~RecordJournal() {
+        if (fd != -1) ::close(fd);
+    }
+
+    RecordJournal(const RecordJournal &) = delete;
+    RecordJournal &operator=(const RecordJournal &) = delete;
+
+    /**
+     * one writev per record, O_APPEND keeps the file consistent for concurrent readers
+     * @return false if the record could not be written whole, a partial frame is cut off again
+     */
+    bool append(const RecordHeader &header_, const uint8_t *payload_) {
+        struct iovec iov[2];
+        iov[0].iov_base = const_cast<RecordHeader *>(&header_);
+        iov[0].iov_len = sizeof(RecordHeader);
+        iov[1].iov_base = const_cast<uint8_t *>(payload_);
+        iov[1].iov_len = header_.length;
+        ssize_t expected = static_cast<ssize_t>(sizeof(RecordHeader) + header_.length);
+        ssize_t n = ::writev(fd, iov, 2);
+        if (n == expected) {
+            end += n;
+            return true;
+        }
+        if (n > 0 && ::ftruncate(fd, end) != 0) end += n;  // can not cut it, later frames stay misaligned
+        return false;
+    }
+
+    /**
+     * Append framed records whose seq in [from_, to_] to out_
+     * @return number of records fetched
+     */
+    uint32_t fetch(uint64_t from_, uint64_t to_, std::vector<uint8_t> &out_) {
+        uint32_t count = 0;
+        off_t pos = seek_hint(from_);
+        RecordHeader header;
+        while (true) {
+            if (::pread(fd, &header, sizeof(RecordHeader), pos) != sizeof(RecordHeader)) break;
+            if (header.seq % SparseIndexStep == 0 && (sparse.empty() || sparse.back().first < header.seq)) {
+                sparse.emplace_back(header.seq, pos);
+            }
+            if (header.seq > to_) break;
+
+            size_t frameSize = sizeof(RecordHeader) + header.length;
+            if (header.seq >= from_) {
+                size_t old = out_.size();
+                out_.resize(old + frameSize);
+                memcpy(out_.data() + old, &header, sizeof(RecordHeader));
+                ssize_t n = ::pread(fd, out_.data() + old + sizeof(RecordHeader), header.length,
+                                    pos + static_cast<off_t>(sizeof(RecordHeader)));
+                if (n != static_cast<ssize_t>(header.length)) {  // torn tail, writer still appending
+                    out_.resize(old);
+                    break;
+                }
+                ++count;
+            }
+            pos += static_cast<off_t>(frameSize);
+        }
+        return count;
+    }
+
+    const std::string &file_path() const { return path; }
+    bool is_writer() const { return isWriter; }
+
+private:
+    // file offset of the closest indexed record before seq_
+    off_t seek_hint(uint64_t seq_) const {
+        off_t pos = 0;
+        for (const auto &item : sparse) {
+            if (item.first > seq_) break;
+            pos = item.second;
+        }
+        return pos;
+    }
+
+    static constexpr uint64_t SparseIndexStep = 1024;
+
+    std::string path;
+    bool isWriter{false};
+    int fd{-1};
+    off_t end{0};  // writer side, size of the whole frames written so far
+    std::vector<std::pair<uint64_t, off_t>> sparse;  // (seq, offset) every SparseIndexStep records
+};
+}  // namespace frenzy
+
+#endif
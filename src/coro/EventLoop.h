@@ -0,0 +1,232 @@
+#ifndef CONCURRENT_CORO_EVENT_LOOP_H
+#define CONCURRENT_CORO_EVENT_LOOP_H
+
+#include "coro/Task.h"
+
+#ifdef FRENZY_HAS_COROUTINES
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "coro/Timer.h"
+#include "lockfree/MpmcBoundedQueue.h"
+
+namespace frenzy {
+namespace coro {
+
+namespace detail {
+// element type of a queue from its bool try_pop(T &)
+template <typename M>
+struct PopArg;
+template <typename Q, typename T>
+struct PopArg<bool (Q::*)(T &)> {
+    using type = T;
+};
+template <typename Q, typename T>
+struct PopArg<bool (Q::*)(T &) noexcept> {
+    using type = T;
+};
+}  // namespace detail
+
+/**
+ * single threaded loop for gateway style code: epoll fd readiness, a TimerWheel in CLOCK_REALTIME ns and polled
+ * lock free queues, each resuming the coroutines waiting on them. the thread calling run() or run_once() owns it,
+ * fd, timer and queue awaits are made from coroutines running on it.
+ * other threads hand coroutines over with post(), co_await loop.schedule() comes back from an Executor.
+ * while a coroutine waits on a queue the loop does not block in epoll, it polls like the callback code did.
+ */
+class EventLoop {
+public:
+    static constexpr size_t InboxCapacity = 4096;  // posting threads spin while it is full
+    static constexpr int MaxEvents = 64;
+
+    explicit EventLoop(int64_t resolutionNs_ = 1000) : timers{resolutionNs_}, inbox{InboxCapacity} {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollfd < 0 || wakefd < 0) throw std::runtime_error("EventLoop: epoll or eventfd failed");
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;  // the wake up eventfd, every other fd points to its IoAwaiter
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, wakefd, &ev);
+    }
+
+    ~EventLoop() {
+        close(wakefd);
+        close(epollfd);
+    }
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    static int64_t now() {
+        timespec ts{};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec * 1000000000L + ts.tv_nsec;
+    }
+
+    TimerWheel<> &wheel() { return timers; }
+
+    // any thread, h_ resumes on the loop thread
+    void post(std::coroutine_handle<> h_) {
+        inbox.push(h_);
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the fence in run_once
+        if (sleeping.load(std::memory_order_relaxed) != 0) {
+            uint64_t one = 1;
+            ssize_t rc = write(wakefd, &one, sizeof(one));
+            (void)rc;
+        }
+    }
+
+    auto schedule() noexcept {
+        struct Awaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h_) { loop->post(h_); }
+            void await_resume() noexcept {}
+
+            EventLoop *loop;
+        };
+        return Awaiter{this};
+    }
+
+    // resumes with the time the timer was due
+    auto sleep_until(int64_t ns_) { return coro::sleep_until(timers, ns_); }
+
+    struct IoAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h_) {
+            handle = h_;
+            epoll_event ev{};
+            ev.events = events | EPOLLONESHOT;
+            ev.data.ptr = this;
+            if (epoll_ctl(loop->epollfd, EPOLL_CTL_MOD, fd, &ev) != 0 &&
+                (errno != ENOENT || epoll_ctl(loop->epollfd, EPOLL_CTL_ADD, fd, &ev) != 0)) {
+                throw std::runtime_error("EventLoop: can not watch fd " + std::to_string(fd));
+            }
+        }
+
+        // the epoll events that fired, EPOLLERR and EPOLLHUP included
+        uint32_t await_resume() noexcept { return events; }
+
+        EventLoop *loop;
+        int fd;
+        uint32_t events;
+        std::coroutine_handle<> handle;
+    };
+
+    // one coroutine waits on an fd at a time, the fd stays registered until forget() or close()
+    IoAwaiter readable(int fd_) { return IoAwaiter{this, fd_, EPOLLIN, {}}; }
+    IoAwaiter writable(int fd_) { return IoAwaiter{this, fd_, EPOLLOUT, {}}; }
+
+    void forget(int fd_) { epoll_ctl(epollfd, EPOLL_CTL_DEL, fd_, nullptr); }
+
+    // co_await loop.pop(queue) for any queue with bool try_pop(T &), e.g. MpmcBoundedQueue or MpscTaskQueue
+    template <typename Queue, typename T = typename detail::PopArg<decltype(&Queue::try_pop)>::type>
+    auto pop(Queue &queue_) {
+        struct Awaiter : Poller {
+            Awaiter(EventLoop *loop_, Queue *queue_) : Poller{&poll, {}}, loop{loop_}, queue{queue_} {}
+
+            static bool poll(Poller *p_) {
+                Awaiter *self = static_cast<Awaiter *>(p_);
+                return self->queue->try_pop(self->value);
+            }
+
+            bool await_ready() { return queue->try_pop(value); }
+            void await_suspend(std::coroutine_handle<> h_) { handle = h_, loop->pollers.push_back(this); }
+            T await_resume() { return std::move(value); }
+
+            EventLoop *loop;
+            Queue *queue;
+            T value{};
+        };
+        return Awaiter{this, &queue_};
+    }
+
+    /**
+     * one round: fd events, posted coroutines, due timers, queues. waits up to timeoutMs_ for an fd or a post
+     * when no coroutine waits on a queue. only the owner thread may call it.
+     * @return number of coroutines resumed
+     */
+    size_t run_once(int timeoutMs_) {
+        size_t resumed = 0;
+        std::coroutine_handle<> h;
+        if (!pollers.empty()) timeoutMs_ = 0;
+        if (timeoutMs_ != 0) {
+            sleeping.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (inbox.try_pop(h)) timeoutMs_ = 0;  // a post after this check writes the eventfd
+        }
+        epoll_event events[MaxEvents];
+        int n = epoll_wait(epollfd, events, MaxEvents, timeoutMs_);
+        sleeping.store(0, std::memory_order_relaxed);
+        if (h) h.resume(), ++resumed;
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                uint64_t count;
+                ssize_t rc = read(wakefd, &count, sizeof(count));
+                (void)rc;
+                continue;
+            }
+            IoAwaiter *io = static_cast<IoAwaiter *>(events[i].data.ptr);
+            io->events = events[i].events;
+            io->handle.resume(), ++resumed;
+        }
+        while (inbox.try_pop(h)) h.resume(), ++resumed;
+        resumed += timers.advance(now());
+
+        // a resumed coroutine may wait on a queue again, only the pollers there before are checked
+        woken.clear();
+        for (size_t i = 0; i < pollers.size();) {
+            if (pollers[i]->ready(pollers[i])) {
+                woken.push_back(pollers[i]->handle);
+                pollers[i] = pollers.back();
+                pollers.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        for (size_t i = 0; i < woken.size(); ++i) woken[i].resume(), ++resumed;
+        return resumed;
+    }
+
+    // until stop(), timers are late by up to timeoutMs_ while nothing else happens
+    void run(int timeoutMs_ = 1) {
+        while (!stopping.load(std::memory_order_acquire)) run_once(timeoutMs_);
+    }
+
+    // any thread
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        ssize_t rc = write(wakefd, &one, sizeof(one));
+        (void)rc;
+    }
+
+private:
+    struct Poller {
+        bool (*ready)(Poller *);
+        std::coroutine_handle<> handle;
+    };
+
+    int epollfd{-1};
+    int wakefd{-1};
+    TimerWheel<> timers;
+    std::vector<Poller *> pollers;
+    std::vector<std::coroutine_handle<>> woken;
+    MpmcBoundedQueue<std::coroutine_handle<>> inbox;
+    std::atomic<uint32_t> sleeping{0};
+    std::atomic<bool> stopping{false};
+};
+}  // namespace coro
+}  // namespace frenzy
+
+#endif  // FRENZY_HAS_COROUTINES
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef CONCURRENT_CORO_EXECUTOR_H
+#define CONCURRENT_CORO_EXECUTOR_H
+
+#include "coro/Task.h"
+
+#ifdef FRENZY_HAS_COROUTINES
+
+#include "thread/SimpleThreadPool.h"
+#include "thread/TaskScheduler.h"
+
+namespace frenzy {
+namespace coro {
+
+/**
+ * resumes coroutines on a TaskScheduler or a SimpleThreadPool, co_await executor.schedule() moves the rest of a
+ * coroutine onto the pool. a resumption is a Task holding the coroutine handle, stored inline, no allocation.
+ * on a TaskScheduler worker it goes to the worker's own deque.
+ */
+class Executor {
+public:
+    explicit Executor(TaskScheduler &scheduler_ = TaskScheduler::instance())
+        : pool{&scheduler_}, submit{[](void *p_, ::frenzy::Task t_) {
+              static_cast<TaskScheduler *>(p_)->submit(std::move(t_));
+          }} {}
+
+    explicit Executor(SimpleThreadPool &pool_)
+        : pool{&pool_}, submit{[](void *p_, ::frenzy::Task t_) {
+              static_cast<SimpleThreadPool *>(p_)->post(std::move(t_));
+          }} {}
+
+    void post(std::coroutine_handle<> h_) { submit(pool, ::frenzy::Task([h_] { h_.resume(); })); }
+
+    auto schedule() noexcept {
+        struct Awaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h_) { executor->post(h_); }
+            void await_resume() noexcept {}
+
+            Executor *executor;
+        };
+        return Awaiter{this};
+    }
+
+private:
+    void *pool;
+    void (*submit)(void *, ::frenzy::Task);
+};
+}  // namespace coro
+}  // namespace frenzy
+
+#endif  // FRENZY_HAS_COROUTINES
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef CONCURRENT_CORO_TASK_H
+#define CONCURRENT_CORO_TASK_H
+
+// the coro layer needs C++20, with older standards these headers are empty
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define FRENZY_HAS_COROUTINES 1
+#endif
+
+#ifdef FRENZY_HAS_COROUTINES
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "allocator/SlabPool.h"
+#include "thread/Future.h"
+
+namespace frenzy {
+namespace coro {
+
+/**
+ * coroutine frames come from SlabPools of 128 to 2048 bytes, so calling a coroutine does not malloc.
+ * a frame may be freed on another thread than the one that created it.
+ */
+struct FramePool {
+    static void *allocate(std::size_t n_) {
+        if (n_ <= 128) return SlabPool<128>::allocate();
+        if (n_ <= 256) return SlabPool<256>::allocate();
+        if (n_ <= 512) return SlabPool<512>::allocate();
+        if (n_ <= 1024) return SlabPool<1024>::allocate();
+        if (n_ <= 2048) return SlabPool<2048, 16>::allocate();
+        return ::operator new(n_);
+    }
+
+    static void deallocate(void *p_, std::size_t n_) {
+        if (n_ <= 128) return SlabPool<128>::deallocate(p_);
+        if (n_ <= 256) return SlabPool<256>::deallocate(p_);
+        if (n_ <= 512) return SlabPool<512>::deallocate(p_);
+        if (n_ <= 1024) return SlabPool<1024>::deallocate(p_);
+        if (n_ <= 2048) return SlabPool<2048, 16>::deallocate(p_);
+        ::operator delete(p_);
+    }
+};
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+struct PromiseBase {
+    static void *operator new(std::size_t n_) { return FramePool::allocate(n_); }
+    static void operator delete(void *p_, std::size_t n_) { FramePool::deallocate(p_, n_); }
+
+    // resumes the awaiting coroutine directly, no stack growth however deep the chain of co_awaits
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h_) noexcept {
+            std::coroutine_handle<> next = h_.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    Task<T> get_return_object() noexcept;
+
+    template <typename V>
+    void return_value(V &&v_) {
+        new (&storage) T(std::forward<V>(v_));
+        has_value = true;
+    }
+
+    T take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*reinterpret_cast<T *>(&storage));
+    }
+
+    ~Promise() {
+        if (has_value) reinterpret_cast<T *>(&storage)->~T();
+    }
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    bool has_value{false};
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+}  // namespace detail
+
+/**
+ * lazy coroutine returning T, it starts when awaited and resumes its awaiter when done, on whatever thread
+ * it finished. an exception propagates to the awaiter. move only, the frame lives as long as the Task.
+ */
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    Task() noexcept = default;
+    explicit Task(std::coroutine_handle<promise_type> h_) noexcept : handle{h_} {}
+    Task(Task &&other_) noexcept : handle{std::exchange(other_.handle, nullptr)} {}
+
+    Task &operator=(Task &&other_) noexcept {
+        if (this != &other_) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other_.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    bool valid() const noexcept { return static_cast<bool>(handle); }
+    bool done() const noexcept { return handle && handle.done(); }
+
+    auto operator co_await() const noexcept {
+        struct Awaiter {
+            bool await_ready() noexcept { return handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting_) noexcept {
+                handle.promise().continuation = awaiting_;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().take(); }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+        return Awaiter{handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+template <typename T>
+inline Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>{std::coroutine_handle<Promise<T>>::from_promise(*this)};
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>{std::coroutine_handle<Promise<void>>::from_promise(*this)};
+}
+
+// runs eagerly and frees itself when it finishes
+struct Detached {
+    struct promise_type {
+        static void *operator new(std::size_t n_) { return FramePool::allocate(n_); }
+        static void operator delete(void *p_, std::size_t n_) { FramePool::deallocate(p_, n_); }
+
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            try {
+                throw;
+            } catch (const std::exception &e) {
+                fprintf(stderr, "frenzy::coro::spawn exception: %s\n", e.what());
+            } catch (...) {
+                fprintf(stderr, "frenzy::coro::spawn exception\n");
+            }
+        }
+    };
+};
+
+template <typename Scheduler>
+Detached launch(Scheduler &scheduler_, Task<void> task_) {
+    co_await scheduler_.schedule();
+    co_await task_;
+}
+
+template <typename T>
+Detached complete(Task<T> task_, frenzy::Promise<T> result_) {
+    try {
+        if constexpr (std::is_void<T>::value) {
+            co_await task_;
+            result_.set_value();
+        } else {
+            result_.set_value(co_await task_);
+        }
+    } catch (...) {
+        result_.set_exception(std::current_exception());
+    }
+}
+}  // namespace detail
+
+/**
+ * fire and forget, task_ starts on scheduler_ (an Executor or an EventLoop), an exception it throws is
+ * printed to stderr
+ */
+template <typename Scheduler>
+void spawn(Scheduler &scheduler_, Task<void> task_) {
+    detail::launch(scheduler_, std::move(task_));
+}
+
+// starts task_ on the calling thread and blocks until it finishes, for main() and tests
+template <typename T>
+T sync_wait(Task<T> task_) {
+    frenzy::Promise<T> promise;
+    Future<T> result = promise.get_future();
+    detail::complete(std::move(task_), std::move(promise));
+    return result.get();
+}
+}  // namespace coro
+}  // namespace frenzy
+
+#endif  // FRENZY_HAS_COROUTINES
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef CONCURRENT_CORO_TIMER_H
+#define CONCURRENT_CORO_TIMER_H
+
+#include "coro/Task.h"
+
+#ifdef FRENZY_HAS_COROUTINES
+
+#include "thread/TimerWheel.h"
+
+namespace frenzy {
+namespace coro {
+
+/**
+ * co_await sleep_until(wheel, time) resumes the coroutine from wheel.advance() on the wheel's thread, with the
+ * time the timer was due. the timer's callable is one pointer, kept in the wheel's 64 byte node.
+ */
+template <typename TTime>
+auto sleep_until(TimerWheel<TTime> &wheel_, TTime time_) {
+    struct Awaiter {
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h_) {
+            handle = h_;
+            // may fire on the wheel's thread before register_timer returns, this must not be touched after it
+            wheel->register_timer([this](TTime fired_) { time = fired_, handle.resume(); }, time);
+        }
+
+        TTime await_resume() noexcept { return time; }
+
+        TimerWheel<TTime> *wheel;
+        TTime time;
+        std::coroutine_handle<> handle;
+    };
+    return Awaiter{&wheel_, time_, {}};
+}
+}  // namespace coro
+}  // namespace frenzy
+
+#endif  // FRENZY_HAS_COROUTINES
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef CONCURRENT_MPSC_TASK_QUEUE_H
+#define CONCURRENT_MPSC_TASK_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include "lockfree/MpmcBoundedQueue.h"
+#include "thread/Task.h"
+#include "utils/Futex.h"
+
+namespace frenzy {
+
+/**
+ * queue policy of ConcurrentWrapper, lock free alternative of ConcurrentQueue<std::function<void()>>.
+ * bounded ring of Task, producers never lock or allocate for small tasks and spin only when the ring is full.
+ * the single consumer spins a while on empty, then parks on a futex, producers wake it only if it is parked.
+ */
+class MpscTaskQueue {
+public:
+    using value_type = Task;
+
+    static constexpr size_t DefaultCapacity = 64 * 1024;
+    static constexpr int SpinCount = 256;
+
+    explicit MpscTaskQueue(size_t capacity_ = DefaultCapacity) : ring{capacity_} {}
+
+    MpscTaskQueue(const MpscTaskQueue &) = delete;
+    MpscTaskQueue &operator=(const MpscTaskQueue &) = delete;
+
+    void push(Task task_) {
+        ring.push(std::move(task_));
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the fence in pop
+        if (sleeping.load(std::memory_order_relaxed) != 0) {
+            epoch.fetch_add(1, std::memory_order_release);
+            futex_wake(&epoch, 1, false);
+        }
+    }
+
+    bool try_pop(Task &task_) { return ring.try_pop(task_); }
+
+    // single consumer only
+    Task pop() {
+        Task task;
+        while (true) {
+            for (int i = 0; i < SpinCount; ++i) {
+                if (ring.try_pop(task)) return task;
+                asm volatile("pause" ::: "memory");
+            }
+            uint32_t seen = epoch.load(std::memory_order_acquire);
+            sleeping.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ring.try_pop(task)) {
+                sleeping.store(0, std::memory_order_relaxed);
+                return task;
+            }
+            futex_wait(&epoch, seen, -1, false);  // a push after the check bumps epoch first
+            sleeping.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    MpmcBoundedQueue<Task> ring;
+    alignas(64) std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> sleeping{0};
+};
+}  // namespace frenzy
+
+#endif
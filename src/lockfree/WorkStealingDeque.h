@@ -0,0 +1,110 @@
+#ifndef CONCURRENT_WORK_STEALING_DEQUE_H
+#define CONCURRENT_WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace frenzy {
+
+/**
+ * Chase-Lev deque, "Correct and Efficient Work-Stealing for Weak Memory Models" by Le, Pop, Cohen, Nardelli.
+ * the owner thread pushes and pops at the bottom, LIFO, other threads steal from the top, FIFO.
+ * the ring grows when full, old rings are kept until destruction since a thief may still read them.
+ * T is copied with atomic loads and stores, usually a pointer.
+ */
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable<T>::value, "T is read and written atomically");
+
+public:
+    explicit WorkStealingDeque(int64_t capacity_ = 1024) {
+        int64_t capacity = 1;
+        while (capacity < capacity_) capacity <<= 1;
+        rings.emplace_back(new Ring(capacity));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    // owner only
+    void push(T item_) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring *r = ring.load(std::memory_order_relaxed);
+        if (b - t > r->mask) r = grow(r, t, b);
+        r->put(b, item_);
+        bottom.store(b + 1, std::memory_order_release);  // the paper's release fence, visible to tsan this way
+    }
+
+    // owner only, the most recently pushed item
+    bool pop(T &item_) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring *r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {  // empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item_ = r->get(b);
+        if (t == b) {  // last item, race against thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // any thread, the oldest item. false if empty or another thief won it
+    bool steal(T &item_) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        Ring *r = ring.load(std::memory_order_acquire);
+        item_ = r->get(t);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // a hint, exact only on the owner thread
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+    int64_t size() const {
+        int64_t n = bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed);
+        return n > 0 ? n : 0;
+    }
+
+private:
+    struct Ring {
+        explicit Ring(int64_t capacity_) : mask{capacity_ - 1}, items{new std::atomic<T>[capacity_]} {}
+
+        void put(int64_t i_, T item_) { items[i_ & mask].store(item_, std::memory_order_relaxed); }
+        T get(int64_t i_) const { return items[i_ & mask].load(std::memory_order_relaxed); }
+
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+    };
+
+    Ring *grow(Ring *old_, int64_t t_, int64_t b_) {
+        rings.emplace_back(new Ring((old_->mask + 1) * 2));
+        Ring *r = rings.back().get();
+        for (int64_t i = t_; i < b_; ++i) r->put(i, old_->get(i));
+        ring.store(r, std::memory_order_release);
+        return r;
+    }
+
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<Ring *> ring{nullptr};
+    std::vector<std::unique_ptr<Ring>> rings;  // owner only
+};
+}  // namespace frenzy
+
+#endif
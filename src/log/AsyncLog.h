@@ -1,9 +1,15 @@
 #ifndef CONCURRENT_ASYNC_LOG_H
 #define CONCURRENT_ASYNC_LOG_H
 
+#include <atomic>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include "ConcurrentWrapper.h"
+#include "lockfree/MpscTaskQueue.h"
+#include "utils/TimestampFormatter.h"
+#include "utils/TscClock.h"
 #include "utils/Utils.h"
 
 namespace frenzy {
@@ -28,15 +34,91 @@ private:
     ~AsyncLog() {}
 
 public:
-    ConcurrentWrapper<std::ostream &> log;
+    ConcurrentWrapper<std::ostream &, MpscTaskQueue> log;
 };
 
-#define PERFORM_LOG(file, line, content)                                                      \
-    {                                                                                         \
-        std::ostringstream oss;                                                               \
-        oss << frenzy::time_string() << " " << file << ":" << line << " " << content << "\n"; \
-        std::string __result = oss.str();                                                     \
-        frenzy::AsyncLog::instance().log([__result](ostream &c) { c << __result; });          \
+/**
+ * line formatting of one thread, nothing is allocated per line.
+ * a line is formatted into a fixed buffer, copied into this thread's byte ring, and the log worker gets a small
+ * task pointing at it. the worker writes it out and releases the bytes. writer waits if the ring is full.
+ */
+class AsyncLogBuffer : private std::streambuf {
+public:
+    static constexpr uint32_t RingBytes = 256 * 1024;
+    static constexpr uint32_t MaxLineLength = 4096;  // longer lines are truncated
+
+    static AsyncLogBuffer &local() {
+        thread_local Holder holder;
+        return *holder.buffer;
+    }
+
+    std::ostream &start(const char *file_, int line_) {
+        setp(line, line + MaxLineLength - 1);  // room for the newline
+        os.clear();
+        char stamp[TimestampFormatter::MaxLength];
+        write(stamp, static_cast<std::streamsize>(formatter.format(TscClock::instance().now_ns(), stamp)));
+        os << ' ' << file_ << ':' << line_ << ' ';
+        return os;
+    }
+
+    void commit() {
+        *pptr() = '\n';
+        pbump(1);
+        uint32_t length = static_cast<uint32_t>(pptr() - pbase());
+
+        uint64_t offset = writePos % RingBytes;
+        if (offset + length > RingBytes) writePos += RingBytes - offset;  // no wrap inside a line, skip the tail
+        uint64_t pos = writePos;
+        uint64_t end = pos + length;
+        while (end - readPos.load(std::memory_order_acquire) > RingBytes) std::this_thread::yield();
+        memcpy(ring + pos % RingBytes, line, length);
+        writePos = end;
+
+        AsyncLogBuffer *self = this;
+        AsyncLog::instance().log([self, pos, length, end](std::ostream &os_) {
+            os_.write(self->ring + pos % RingBytes, length);
+            self->readPos.store(end, std::memory_order_release);
+        });
+    }
+
+private:
+    // the worker may still hold lines of an exited thread. the worker runs tasks in order, so the buffer is
+    // deleted by a last task queued after them, the thread exits without waiting
+    struct Holder {
+        AsyncLogBuffer *buffer{new AsyncLogBuffer};
+        ~Holder() {
+            AsyncLogBuffer *retired = buffer;
+            AsyncLog::instance().log([retired](std::ostream &) { delete retired; });
+        }
+    };
+
+    AsyncLogBuffer() : os{this} {}
+
+    int_type overflow(int_type c_) override { return traits_type::not_eof(c_); }  // line full, drop
+
+    std::streamsize xsputn(const char *s_, std::streamsize n_) override {
+        std::streamsize room = epptr() - pptr();
+        std::streamsize n = n_ < room ? n_ : room;
+        memcpy(pptr(), s_, static_cast<size_t>(n));
+        pbump(static_cast<int>(n));
+        return n_;  // truncated silently, the stream stays good
+    }
+
+    void write(const char *s_, std::streamsize n_) { xsputn(s_, n_); }
+
+    std::ostream os;
+    TimestampFormatter formatter{6};
+    char line[MaxLineLength];
+    uint64_t writePos{0};
+    alignas(64) std::atomic<uint64_t> readPos{0};
+    alignas(64) char ring[RingBytes];
+};
+
+#define PERFORM_LOG(file, line, content)                                    \
+    {                                                                       \
+        frenzy::AsyncLogBuffer &__buffer = frenzy::AsyncLogBuffer::local(); \
+        __buffer.start(file, line) << content;                              \
+        __buffer.commit();                                                  \
     }
 
 #define ASYNC_LOG(str) PERFORM_LOG(__FILE__, __LINE__, str)
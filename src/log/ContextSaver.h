@@ -1,194 +1,532 @@
-#ifndef CONTEXT_LOG_H
-#define CONTEXT_LOG_H
-
-#include <cstdint>
-#include <cstring>
-#include <exception>
-#include <sstream>
-#include <stdexcept>
-#include <vector>
-#include "media/ShmUtils.h"
-#include "utils/Traits.h"
-
-namespace frenzy {
-
-struct ContextItem {
-    TypeIndex typeIndex;
-    void* address;
-    size_t length;
-};
-
-struct ContextMeta {
-    uint64_t magic{0x1234FFFF};
-    uint64_t metaSize{sizeof(ContextMeta)};
-    uint64_t dataSize{0};
-    uint64_t used{0};
-};
-
-class ContextSaver {
-public:
-    ContextSaver(std::string fileName_, size_t len) : fileName(fileName_) {
-        size_t shmSize = sizeof(ContextMeta) + len;
-        start = (uint8_t*)create_mmap(fileName_, shmSize);
-        if (start != nullptr) {
-            initMemoryLayout(len);
-        } else {
-            std::abort();
-        }
-    }
-
-    ContextSaver(size_t len = 1024 * 1024) {
-        start = new uint8_t[sizeof(ContextMeta) + len];
-        initMemoryLayout(len);
-    }
-
-    ~ContextSaver() {
-        if (fileName.empty()) {
-            delete[] start;
-        }
-    }
-
-    ContextSaver& schedule(char& value) { return _schedule(value, TypeIndex::char_type); }
-    ContextSaver& schedule(int& value) { return _schedule(value, TypeIndex::int_type); }
-    ContextSaver& schedule(long& value) { return _schedule(value, TypeIndex::int64_type); }
-    ContextSaver& schedule(float& value) { return _schedule(value, TypeIndex::float_type); }
-    ContextSaver& schedule(double& value) { return _schedule(value, TypeIndex::double_type); }
-    ContextSaver& schedule(std::string& value) { return _schedule(value, TypeIndex::string_type); }
-
-    // size 0 means saver will evaluate by std::strlen every time, otherwise it will directly use size
-    ContextSaver& schedule(char* value, size_t size = 0) {
-        userDefinedContext.push_back(ContextItem{TypeIndex::char_array_type, static_cast<void*>(value), size});
-        return *this;
-    }
-
-    ContextSaver& save() {
-        for (const auto& var : userDefinedContext) {
-            if (var.typeIndex == TypeIndex::string_type) {
-                std::string* pStr = (std::string*)var.address;
-                save(pStr->c_str(), pStr->size());
-            } else if (var.typeIndex == TypeIndex::char_array_type) {
-                save((char*)var.address, var.length);
-            } else {
-                *writePos++ = var.typeIndex;
-                memcpy(writePos, var.address, var.length);
-                writePos += var.length;
-            }
-        }
-        return *this;
-    }
-
-    ContextSaver& save(char value) { return _save(value, TypeIndex::char_type); }
-    ContextSaver& save(int value) { return _save(value, TypeIndex::int_type); }
-    ContextSaver& save(long value) { return _save(value, TypeIndex::int64_type); }
-    ContextSaver& save(float value) { return _save(value, TypeIndex::float_type); }
-    ContextSaver& save(double value) { return _save(value, TypeIndex::double_type); }
-
-    ContextSaver& save(const char* value, size_t len = 0) {
-        *writePos++ = TypeIndex::string_type;
-        if (value != nullptr && len == 0) {
-            len = std::strlen(value);
-        }
-        memcpy(writePos, &len, sizeof(size_t));
-        writePos += sizeof(size_t);
-        if (value != nullptr) {
-            memcpy(writePos, value, len);
-            writePos += len;
-        }
-        return *this;
-    }
-
-    ContextSaver& load(char& value) { return _load(value, TypeIndex::char_type); }
-    ContextSaver& load(int& value) { return _load(value, TypeIndex::int_type); }
-    ContextSaver& load(long& value) { return _load(value, TypeIndex::int64_type); }
-    ContextSaver& load(float& value) { return _load(value, TypeIndex::float_type); }
-    ContextSaver& load(double& value) { return _load(value, TypeIndex::double_type); }
-
-    ContextSaver& load(char* value) {
-        if ((checkTypeNoThrow(TypeIndex::string_type) || checkTypeNoThrow(TypeIndex::char_array_type)) &&
-            value != nullptr) {
-            ++readPos;
-            size_t len = 0;
-            memcpy(&len, readPos, sizeof(size_t));
-            readPos += sizeof(size_t);
-            if (len > 0) {
-                memcpy(value, readPos, len);
-                value[len] = '\0';
-                readPos += len;
-            }
-        }
-        return *this;
-    }
-
-    ContextSaver& load(std::string& value) {
-        if (checkTypeNoThrow(TypeIndex::string_type) || checkTypeNoThrow(TypeIndex::char_array_type)) {
-            ++readPos;
-            size_t len = 0;
-            memcpy(&len, readPos, sizeof(size_t));
-            readPos += sizeof(size_t);
-            if (len > 0) {
-                value.resize(len + 1);
-                memcpy(value.data(), readPos, len);
-                value[len] = '\0';
-                readPos += len;
-            } else {
-                value = "";
-            }
-        }
-        return *this;
-    }
-
-private:
-    void initMemoryLayout(size_t len) {
-        contextMeta = reinterpret_cast<ContextMeta*>(start);
-        readPos = writePos = start + sizeof(ContextMeta);
-        ContextMeta dummy;
-        dummy.dataSize = len;
-        *contextMeta = dummy;
-    }
-
-    template <typename T>
-    ContextSaver& _schedule(T& value, TypeIndex typeIndex) {
-        userDefinedContext.push_back({typeIndex, &value, sizeof(T)});
-        return *this;
-    }
-
-    template <typename T>
-    ContextSaver& _save(const T& value, TypeIndex typeIndex) {
-        *writePos++ = typeIndex;
-        memcpy(writePos, &value, sizeof(T));
-        writePos += sizeof(T);
-        return *this;
-    }
-
-    template <typename T>
-    ContextSaver& _load(T& value, TypeIndex typeIndex) {
-        if (checkType(typeIndex)) {
-            ++readPos;
-            memcpy(&value, readPos, sizeof(T));
-            readPos += sizeof(T);
-        }
-        return *this;
-    }
-
-    bool checkType(TypeIndex typeIndex) {
-        if (*readPos != typeIndex) {
-            std::ostringstream oss;
-            oss << "type not match " << typeIndex << " <--> " << *readPos << std::endl;
-            return false;
-        }
-        return true;
-    }
-
-    bool checkTypeNoThrow(TypeIndex typeIndex) { return *readPos == typeIndex; }
-
-private:
-    std::string fileName;
-    ContextMeta* contextMeta{nullptr};
-    uint8_t* start{nullptr};
-    uint8_t* writePos{nullptr};
-    uint8_t* readPos{nullptr};
-    std::vector<ContextItem> userDefinedContext;
-};
-
-}  // namespace frenzy
-#endif
+#ifndef CONTEXT_LOG_H
+#define CONTEXT_LOG_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "media/ShmUtils.h"
+#include "utils/Traits.h"
+#include "utils/TscClock.h"
+
+namespace frenzy {
+
+struct ContextItem {
+    TypeIndex typeIndex;
+    void* address;
+    size_t length;
+};
+
+constexpr uint32_t MaxContextFields = 64;
+
+// one value of a packed frame, at a fixed offset
+struct ContextField {
+    TypeIndex type{TypeIndex::null_type};
+    uint8_t reserved{0};
+    uint16_t size{0};
+    uint32_t offset{0};
+};
+
+struct ContextMeta {
+    uint64_t magic{0x1234FF03};
+    uint64_t metaSize{sizeof(ContextMeta)};
+    uint64_t dataSize{0};
+    uint64_t used{0};        // data bytes of the latest frame
+    uint32_t frameBytes{0};  // one slot, header included
+    uint32_t frameCount{0};
+    std::atomic<uint64_t> lastFrame{0};  // number of the latest committed frame, 0 if none yet
+    uint32_t schemaFields{0};            // layout of the latest schema saved, see ContextSchema
+    uint32_t schemaBytes{0};
+    uint64_t schemaId{0};  // ContextSchema::Id of that layout
+    ContextField schema[MaxContextFields];
+};
+
+// FNV-1a of the field types and sizes, tells the packed frames of different schemas apart
+template <typename... Ts>
+constexpr uint64_t contextSchemaId() {
+    const uint32_t types[] = {static_cast<uint32_t>(TypeIndexStruct<Ts>::type)...};
+    const uint32_t sizes[] = {static_cast<uint32_t>(sizeof(Ts))...};
+    uint64_t hash = 14695981039346656037UL;
+    for (size_t i = 0; i < sizeof...(Ts); ++i) {
+        hash = (hash ^ types[i]) * 1099511628211UL;
+        hash = (hash ^ sizes[i]) * 1099511628211UL;
+    }
+    return hash;
+}
+
+/**
+ * fixed set of variables saved without type tags, each value at a compile time offset.
+ * ContextSaver::save(schema) is one memcpy per variable, the layout goes into ContextMeta once,
+ * so a reader decodes the frames with the header alone. each frame records the Id of its schema, a frame of
+ * another schema is refused by load and loadField.
+ * types need a TypeIndexStruct and must be trivially copyable, char[N] for text.
+ */
+template <typename... Ts>
+class ContextSchema {
+public:
+    static constexpr size_t Count = sizeof...(Ts);
+    static_assert(Count > 0 && Count <= MaxContextFields, "1 to MaxContextFields variables");
+    static_assert((std::is_trivially_copyable<Ts>::value && ...), "values are copied by memcpy");
+    static_assert(((TypeIndexStruct<Ts>::type != TypeIndex::null_type) && ...), "type has no TypeIndexStruct");
+
+    static constexpr uint32_t Bytes = (0 + ... + static_cast<uint32_t>(sizeof(Ts)));
+    static constexpr uint64_t Id = contextSchemaId<Ts...>();
+
+    explicit ContextSchema(Ts&... values_) : values{&values_...} {}
+
+    void write(uint8_t* dst) const { write(dst, std::index_sequence_for<Ts...>{}); }
+
+    // copy a packed frame back into the variables
+    void read(const uint8_t* src) const { read(src, std::index_sequence_for<Ts...>{}); }
+
+    static void describe(ContextField* fields) {
+        const TypeIndex types[] = {TypeIndexStruct<Ts>::type...};
+        const uint16_t sizes[] = {static_cast<uint16_t>(sizeof(Ts))...};
+        for (size_t i = 0; i < Count; ++i) fields[i] = ContextField{types[i], 0, sizes[i], Offsets[i]};
+    }
+
+private:
+    static constexpr std::array<uint32_t, Count> offsets() {
+        const uint32_t sizes[] = {static_cast<uint32_t>(sizeof(Ts))...};
+        std::array<uint32_t, Count> result{};
+        uint32_t offset = 0;
+        for (size_t i = 0; i < Count; ++i) {
+            result[i] = offset;
+            offset += sizes[i];
+        }
+        return result;
+    }
+
+    static constexpr std::array<uint32_t, Count> Offsets = offsets();
+
+    template <size_t... I>
+    void write(uint8_t* dst, std::index_sequence<I...>) const {
+        (memcpy(dst + Offsets[I], std::get<I>(values), sizeof(Ts)), ...);
+    }
+
+    template <size_t... I>
+    void read(const uint8_t* src, std::index_sequence<I...>) const {
+        (memcpy(std::get<I>(values), src + Offsets[I], sizeof(Ts)), ...);
+    }
+
+    std::tuple<Ts*...> values;
+};
+
+/**
+ * slot of the frame ring, seq is odd while the frame is written.
+ * a reader copies the frame and keeps it only if seq was even and the same before and after.
+ */
+struct alignas(64) ContextFrameHeader {
+    std::atomic<uint64_t> seq{0};
+    uint64_t frame{0};      // frame number, its slot is frame % frameCount
+    uint64_t tsc{0};        // TscClock::ticks() when the frame began
+    uint32_t used{0};       // data bytes
+    uint16_t truncated{0};  // items which did not fit into the frame were left out
+    uint16_t packed{0};     // values of a schema, no type tags
+    uint64_t schema{0};     // ContextSchema::Id of a packed frame
+};
+
+/**
+ * saves program state into a ring of fixed size frames, in shm if given a file name, so the last frames
+ * survive a crash and can be read by attach() from another process.
+ * save() writes all scheduled variables into a new frame, save(value) appends to the current frame.
+ * load() reads from a copy of the frame picked by select(), the latest one if none was picked.
+ * single writer, readers may run concurrently in any process.
+ */
+class ContextSaver {
+public:
+    static constexpr uint32_t DefaultFrameBytes = 4096;
+
+    ContextSaver(std::string fileName_, size_t len, uint32_t frameBytes_ = DefaultFrameBytes) : fileName(fileName_) {
+        size_t shmSize = framesOffset() + len;
+        start = (uint8_t*)create_mmap(fileName_, shmSize);
+        if (start != nullptr) {
+            mappedBytes = shmSize;
+            initMemoryLayout(len, frameBytes_);
+        } else {
+            std::abort();
+        }
+    }
+
+    ContextSaver(size_t len = 1024 * 1024, uint32_t frameBytes_ = DefaultFrameBytes) {
+        start = new uint8_t[framesOffset() + len];
+        initMemoryLayout(len, frameBytes_);
+    }
+
+    ~ContextSaver() {
+        if (fileName.empty()) {
+            delete[] start;
+        } else {
+            munmap(start, mappedBytes);
+        }
+    }
+
+    ContextSaver(const ContextSaver&) = delete;
+    ContextSaver& operator=(const ContextSaver&) = delete;
+
+    /**
+     * map the frames of a saver in another, maybe crashed, process
+     * @return nullptr if fileName is not a context file
+     */
+    static std::unique_ptr<ContextSaver> attach(const std::string& fileName) {
+        size_t size = 0;
+        void* addr = attach_mmap(fileName, size);
+        if (addr == nullptr || addr == MAP_FAILED) return nullptr;
+        ContextMeta* meta = reinterpret_cast<ContextMeta*>(addr);
+        if (size < sizeof(ContextMeta) || meta->magic != ContextMeta{}.magic || meta->metaSize != sizeof(ContextMeta)) {
+            munmap(addr, size);
+            return nullptr;
+        }
+        return std::unique_ptr<ContextSaver>(new ContextSaver(static_cast<uint8_t*>(addr), size, fileName));
+    }
+
+    ContextSaver& schedule(char& value) { return _schedule(value, TypeIndex::char_type); }
+    ContextSaver& schedule(int& value) { return _schedule(value, TypeIndex::int_type); }
+    ContextSaver& schedule(long& value) { return _schedule(value, TypeIndex::int64_type); }
+    ContextSaver& schedule(float& value) { return _schedule(value, TypeIndex::float_type); }
+    ContextSaver& schedule(double& value) { return _schedule(value, TypeIndex::double_type); }
+    ContextSaver& schedule(std::string& value) { return _schedule(value, TypeIndex::string_type); }
+
+    // size 0 means saver will evaluate by std::strlen every time, otherwise it will directly use size
+    ContextSaver& schedule(char* value, size_t size = 0) {
+        userDefinedContext.push_back(ContextItem{TypeIndex::char_array_type, static_cast<void*>(value), size});
+        return *this;
+    }
+
+    /**
+     * snapshot of all scheduled variables as a new frame, overwrites the oldest one
+     */
+    ContextSaver& save() {
+        beginFrame();
+        for (const auto& var : userDefinedContext) {
+            if (var.typeIndex == TypeIndex::string_type) {
+                std::string* pStr = (std::string*)var.address;
+                putString(pStr->c_str(), pStr->size());
+            } else if (var.typeIndex == TypeIndex::char_array_type) {
+                const char* str = (const char*)var.address;
+                putString(str, var.length == 0 ? std::strlen(str) : var.length);
+            } else {
+                put(var.typeIndex, var.address, var.length);
+            }
+        }
+        return publish();
+    }
+
+    /**
+     * snapshot of the schema's variables as a new packed frame
+     */
+    template <typename... Ts>
+    ContextSaver& save(const ContextSchema<Ts...>& schema) {
+        using Schema = ContextSchema<Ts...>;
+        if (schemaDescribe != &Schema::describe) {
+            describeSchema(&Schema::describe, Schema::Count, Schema::Bytes, Schema::Id);
+        }
+        beginFrame();
+        if (fits(Schema::Bytes)) {
+            schema.write(writePos);
+            writePos += Schema::Bytes;
+            frame->packed = 1;
+            frame->schema = Schema::Id;
+        }
+        return publish();
+    }
+
+    ContextSaver& save(char value) { return _save(value, TypeIndex::char_type); }
+    ContextSaver& save(int value) { return _save(value, TypeIndex::int_type); }
+    ContextSaver& save(long value) { return _save(value, TypeIndex::int64_type); }
+    ContextSaver& save(float value) { return _save(value, TypeIndex::float_type); }
+    ContextSaver& save(double value) { return _save(value, TypeIndex::double_type); }
+
+    ContextSaver& save(const char* value, size_t len = 0) {
+        if (value != nullptr && len == 0) {
+            len = std::strlen(value);
+        }
+        open();
+        putString(value, value == nullptr ? 0 : len);
+        return publish();
+    }
+
+    /**
+     * following save(value) calls go into a new frame
+     */
+    ContextSaver& nextFrame() {
+        beginFrame();
+        return publish();
+    }
+
+    /**
+     * copy a committed frame for load(), back 0 is the latest, 1 the one before...
+     * @return false if there is no such frame or it is being overwritten
+     */
+    bool select(size_t back = 0) {
+        uint64_t last = contextMeta->lastFrame.load(std::memory_order_acquire);
+        if (last <= back || back >= contextMeta->frameCount) return false;
+        uint64_t n = last - back;
+        const ContextFrameHeader* slot = frameAt(n);
+        for (int retry = 0; retry < 100; ++retry) {
+            uint64_t seq = slot->seq.load(std::memory_order_acquire);
+            if ((seq & 1) == 0 && slot->frame == n) {
+                readFrame.frame = n;
+                readFrame.tsc = slot->tsc;
+                readFrame.used = std::min(slot->used, maxUsed());
+                readFrame.truncated = slot->truncated;
+                readFrame.packed = slot->packed;
+                readFrame.schema = slot->schema;
+                readBuffer.assign(frameData(slot), frameData(slot) + readFrame.used);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot->seq.load(std::memory_order_relaxed) == seq) {
+                    readPos = readBuffer.data();
+                    readEnd = readPos + readBuffer.size();
+                    return true;
+                }
+            }
+            if (slot->frame != n && (seq & 1) == 0) return false;  // lapped by the writer
+            asm volatile("pause" ::: "memory");
+        }
+        return false;  // writer is in the middle of it, or died there
+    }
+
+    // of the frame picked by select()
+    uint64_t frameNumber() const { return readFrame.frame; }
+    uint64_t frameTsc() const { return readFrame.tsc; }
+    int64_t frameNs() const { return TscClock::instance().to_ns(readFrame.tsc); }
+    bool frameTruncated() const { return readFrame.truncated != 0; }
+
+    bool framePacked() const { return readFrame.packed != 0; }
+
+    uint64_t lastFrame() const { return contextMeta->lastFrame.load(std::memory_order_acquire); }
+    uint32_t frameCount() const { return contextMeta->frameCount; }
+
+    /**
+     * variables of a packed frame, the latest one if none was selected
+     * @return false if the frame was not saved by this schema
+     */
+    template <typename... Ts>
+    bool load(const ContextSchema<Ts...>& schema) {
+        if (readPos == nullptr && !select()) return false;
+        if (readFrame.packed == 0 || readFrame.schema != ContextSchema<Ts...>::Id ||
+            readFrame.used != ContextSchema<Ts...>::Bytes) {
+            return false;
+        }
+        schema.read(readBuffer.data());
+        return true;
+    }
+
+    // layout of the latest schema saved, for readers without the schema type, e.g. attached after a crash
+    uint32_t fieldCount() const { return contextMeta->schemaFields; }
+    const ContextField& field(uint32_t index) const { return contextMeta->schema[index]; }
+
+    /**
+     * one value of the selected packed frame
+     * @return false if T is not the type of the field, or the frame was saved by another schema than the latest
+     */
+    template <typename T>
+    bool loadField(uint32_t index, T& value) {
+        if (readPos == nullptr && !select()) return false;
+        if (readFrame.packed == 0 || readFrame.schema != contextMeta->schemaId || index >= contextMeta->schemaFields) {
+            return false;
+        }
+        const ContextField& f = contextMeta->schema[index];
+        if (f.type != TypeIndexStruct<T>::type || f.size != sizeof(T) || f.offset + sizeof(T) > readFrame.used) {
+            return false;
+        }
+        memcpy(&value, readBuffer.data() + f.offset, sizeof(T));
+        return true;
+    }
+
+    ContextSaver& load(char& value) { return _load(value, TypeIndex::char_type); }
+    ContextSaver& load(int& value) { return _load(value, TypeIndex::int_type); }
+    ContextSaver& load(long& value) { return _load(value, TypeIndex::int64_type); }
+    ContextSaver& load(float& value) { return _load(value, TypeIndex::float_type); }
+    ContextSaver& load(double& value) { return _load(value, TypeIndex::double_type); }
+
+    ContextSaver& load(char* value) {
+        size_t len = 0;
+        if (value != nullptr && loadString(len)) {
+            memcpy(value, readPos, len);
+            value[len] = '\0';
+            readPos += len;
+        }
+        return *this;
+    }
+
+    ContextSaver& load(std::string& value) {
+        size_t len = 0;
+        if (loadString(len)) {
+            value.assign(reinterpret_cast<const char*>(readPos), len);
+            readPos += len;
+        }
+        return *this;
+    }
+
+private:
+    ContextSaver(uint8_t* start_, size_t mappedBytes_, std::string fileName_)
+        : fileName(fileName_), start(start_), mappedBytes(mappedBytes_) {
+        contextMeta = reinterpret_cast<ContextMeta*>(start);
+    }
+
+    static size_t framesOffset() { return (sizeof(ContextMeta) + 63) & ~static_cast<size_t>(63); }
+
+    void initMemoryLayout(size_t len, uint32_t frameBytes_) {
+        contextMeta = reinterpret_cast<ContextMeta*>(start);
+        ContextMeta* meta = new (start) ContextMeta;
+        meta->dataSize = len;
+        uint64_t bytes = std::max<uint64_t>(frameBytes_, sizeof(ContextFrameHeader) + 64);
+        bytes = std::min<uint64_t>(bytes, len) & ~static_cast<uint64_t>(63);
+        meta->frameBytes = static_cast<uint32_t>(bytes);
+        meta->frameCount = bytes == 0 ? 0 : static_cast<uint32_t>(len / bytes);
+        if (meta->frameCount == 0) std::abort();  // len too small for one frame
+        for (uint32_t i = 0; i < meta->frameCount; ++i) new (start + framesOffset() + i * bytes) ContextFrameHeader;
+    }
+
+    ContextFrameHeader* frameAt(uint64_t n) const {
+        return reinterpret_cast<ContextFrameHeader*>(start + framesOffset() +
+                                                     n % contextMeta->frameCount * contextMeta->frameBytes);
+    }
+    uint32_t maxUsed() const { return contextMeta->frameBytes - static_cast<uint32_t>(sizeof(ContextFrameHeader)); }
+
+    static uint8_t* frameData(const ContextFrameHeader* h) {
+        return reinterpret_cast<uint8_t*>(const_cast<ContextFrameHeader*>(h)) + sizeof(ContextFrameHeader);
+    }
+
+    void describeSchema(void (*describe)(ContextField*), size_t count, uint32_t bytes, uint64_t id) {
+        describe(contextMeta->schema);
+        contextMeta->schemaFields = static_cast<uint32_t>(count);
+        contextMeta->schemaBytes = bytes;
+        contextMeta->schemaId = id;
+        schemaDescribe = describe;
+    }
+
+    // take the slot after the latest frame, seq stays odd until publish
+    void beginFrame() {
+        uint64_t n = contextMeta->lastFrame.load(std::memory_order_relaxed) + 1;
+        frame = frameAt(n);
+        frame->seq.store(frame->seq.load(std::memory_order_relaxed) | 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        frame->frame = n;
+        frame->tsc = TscClock::ticks();
+        frame->used = 0;
+        frame->truncated = 0;
+        frame->packed = 0;
+        frame->schema = 0;
+        writePos = frameData(frame);
+    }
+
+    // make seq odd before touching the current frame, the first save(value) starts one
+    void open() {
+        if (frame == nullptr) beginFrame();
+        uint64_t seq = frame->seq.load(std::memory_order_relaxed);
+        if ((seq & 1) == 0) {
+            frame->seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+    }
+
+    // commit the current frame, it becomes the latest
+    ContextSaver& publish() {
+        frame->used = static_cast<uint32_t>(writePos - frameData(frame));
+        frame->seq.store(frame->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        contextMeta->used = frame->used;
+        contextMeta->lastFrame.store(frame->frame, std::memory_order_release);
+        return *this;
+    }
+
+    bool fits(size_t length) {
+        if (writePos + length <= reinterpret_cast<uint8_t*>(frame) + contextMeta->frameBytes) return true;
+        frame->truncated = 1;
+        return false;
+    }
+
+    void put(TypeIndex typeIndex, const void* value, size_t length) {
+        if (!fits(1 + length)) return;
+        *writePos++ = typeIndex;
+        memcpy(writePos, value, length);
+        writePos += length;
+    }
+
+    void putString(const char* value, size_t len) {
+        if (!fits(1 + sizeof(size_t) + len)) return;
+        *writePos++ = TypeIndex::string_type;
+        memcpy(writePos, &len, sizeof(size_t));
+        writePos += sizeof(size_t);
+        if (len > 0) {
+            memcpy(writePos, value, len);
+            writePos += len;
+        }
+    }
+
+    template <typename T>
+    ContextSaver& _schedule(T& value, TypeIndex typeIndex) {
+        userDefinedContext.push_back({typeIndex, &value, sizeof(T)});
+        return *this;
+    }
+
+    template <typename T>
+    ContextSaver& _save(const T& value, TypeIndex typeIndex) {
+        open();
+        put(typeIndex, &value, sizeof(T));
+        return publish();
+    }
+
+    template <typename T>
+    ContextSaver& _load(T& value, TypeIndex typeIndex) {
+        if (checkType(typeIndex) && readPos + 1 + sizeof(T) <= readEnd) {
+            ++readPos;
+            memcpy(&value, readPos, sizeof(T));
+            readPos += sizeof(T);
+        }
+        return *this;
+    }
+
+    // length of the string item at readPos, readPos moves to its bytes
+    bool loadString(size_t& len) {
+        if (!checkTypeNoThrow(TypeIndex::string_type) && !checkTypeNoThrow(TypeIndex::char_array_type)) return false;
+        if (readPos + 1 + sizeof(size_t) > readEnd) return false;
+        memcpy(&len, readPos + 1, sizeof(size_t));
+        if (len > static_cast<size_t>(readEnd - readPos) - 1 - sizeof(size_t)) return false;
+        readPos += 1 + sizeof(size_t);
+        return true;
+    }
+
+    bool checkType(TypeIndex typeIndex) {
+        if (!checkTypeNoThrow(typeIndex)) {
+            std::ostringstream oss;
+            oss << "type not match " << typeIndex << " <--> " << (readPos < readEnd ? *readPos : 0) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // the first load picks the latest frame
+    bool checkTypeNoThrow(TypeIndex typeIndex) {
+        if (readPos == nullptr && !select()) return false;
+        return readPos < readEnd && *readPos == typeIndex;
+    }
+
+private:
+    std::string fileName;
+    ContextMeta* contextMeta{nullptr};
+    uint8_t* start{nullptr};
+    size_t mappedBytes{0};  // of the shm mapping, unmapped by the destructor
+    ContextFrameHeader* frame{nullptr};  // being written
+    uint8_t* writePos{nullptr};
+    ContextFrameHeader readFrame;  // fields of the selected frame, seq unused
+    std::vector<uint8_t> readBuffer;
+    uint8_t* readPos{nullptr};
+    uint8_t* readEnd{nullptr};
+    std::vector<ContextItem> userDefinedContext;
+    void (*schemaDescribe)(ContextField*){nullptr};  // schema of the last save(schema)
+};
+
+}  // namespace frenzy
+#endif
@@ -0,0 +1,319 @@
+#ifndef CONCURRENT_FILE_SINK_H
+#define CONCURRENT_FILE_SINK_H
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "utils/FrenzyException.h"
+
+#ifdef FRENZY_HAS_ZSTD
+#include <zstd.h>
+#endif
+#ifdef FRENZY_HAS_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace frenzy {
+
+enum class SinkCompression : uint8_t { None, Zstd, Lz4 };
+
+struct FileSinkOptions {
+    uint32_t bufferBytes{1024 * 1024};  // one write(2) per full buffer
+    uint64_t rotateBytes{0};            // uncompressed bytes per file, 0 disables size rotation
+    uint32_t rotateSeconds{0};          // aligned to local wall clock, 86400 rotates at midnight, 0 disables
+    uint32_t flushIntervalMs{1000};     // upper bound of data sitting in the buffer, see flush_if_due
+    SinkCompression compression{SinkCompression::None};
+    int level{1};
+    bool append{true};  // false truncates the file on first open
+};
+
+/**
+ * block buffered log file, an ostream can write into it directly, e.g. std::ostream os{&sink}.
+ * std::flush on such an ostream only writes once flushIntervalMs passed, call flush() to force it.
+ * rotation happens on flush at a line boundary, rotated files get a time suffix.
+ * compression is streaming, zstd or lz4 frame, available if built with FRENZY_HAS_ZSTD / FRENZY_HAS_LZ4.
+ */
+class FileSink : public std::streambuf {
+public:
+    explicit FileSink(const std::string &path_, const FileSinkOptions &options_ = FileSinkOptions{})
+        : basePath{path_}, options{options_} {
+        if (options.rotateBytes > 0 && options.rotateBytes < options.bufferBytes) {
+            options.bufferBytes = static_cast<uint32_t>(options.rotateBytes);
+        }
+        if (options.bufferBytes < 4096) options.bufferBytes = 4096;
+        void *p = nullptr;
+        if (posix_memalign(&p, 4096, options.bufferBytes) != 0) THROW_FRENZY_EXCEPTION("FileSink: out of memory");
+        buffer = static_cast<char *>(p);
+        setp(buffer, buffer + options.bufferBytes);
+        init_compression();
+        open_file(options.append ? O_APPEND : O_TRUNC);
+    }
+
+    ~FileSink() override {
+        close();
+        free(buffer);
+#ifdef FRENZY_HAS_ZSTD
+        if (zstd != nullptr) ZSTD_freeCCtx(zstd);
+#endif
+#ifdef FRENZY_HAS_LZ4
+        if (lz4 != nullptr) LZ4F_freeCompressionContext(lz4);
+#endif
+    }
+
+    FileSink(const FileSink &) = delete;
+    FileSink &operator=(const FileSink &) = delete;
+
+    void write(const char *data_, size_t size_) { xsputn(data_, static_cast<std::streamsize>(size_)); }
+
+    /**
+     * hand buffered bytes to the kernel, rotates first if due and the buffer ends with a complete line
+     */
+    void flush() {
+        if (fd < 0) return;
+        bool lineEnd = pptr() == pbase() || pptr()[-1] == '\n';
+        write_buffer(false);
+        lastFlushNs = now_ns();
+        if (lineEnd && rotation_due()) rotate();
+    }
+
+    /**
+     * cheap enough to call on every log line, flushes when flushIntervalMs has passed.
+     * there is no timer behind it, a writer which may go quiet must keep calling it or flush() itself,
+     * like the ShmLog drainer does every idle round.
+     */
+    void flush_if_due() {
+        if (pptr() != pbase() && now_ns() - lastFlushNs >= options.flushIntervalMs * 1000000L) flush();
+    }
+
+    void close() {
+        if (fd < 0) return;
+        write_buffer(true);
+        ::close(fd);
+        fd = -1;
+    }
+
+    /**
+     * close current file, rename it with a time suffix and start a new one
+     */
+    void rotate() {
+        close();
+        char suffix[32];
+        time_t t = time(nullptr);
+        struct tm tm;
+        localtime_r(&t, &tm);
+        strftime(suffix, sizeof(suffix), ".%Y%m%d-%H%M%S", &tm);
+        std::string rotated = basePath + suffix;
+        for (int i = 1; access((rotated + extension()).c_str(), F_OK) == 0; ++i) {
+            rotated = basePath + suffix + "." + std::to_string(i);
+        }
+        if (::rename(active_path().c_str(), (rotated + extension()).c_str()) != 0) {
+            fprintf(stderr, "FileSink: rename %s failed, %s\n", active_path().c_str(), strerror(errno));
+        }
+        open_file(O_APPEND);
+    }
+
+    std::string active_path() const { return basePath + extension(); }
+    uint64_t file_bytes() const { return fileBytes + static_cast<uint64_t>(pptr() - pbase()); }
+
+protected:
+    int_type overflow(int_type c_) override {
+        spill();
+        if (c_ != traits_type::eof()) {
+            *pptr() = static_cast<char>(c_);
+            pbump(1);
+        }
+        return traits_type::not_eof(c_);
+    }
+
+    std::streamsize xsputn(const char *s_, std::streamsize n_) override {
+        std::streamsize left = n_;
+        while (left > 0) {
+            std::streamsize room = epptr() - pptr();
+            if (room == 0) {
+                spill();
+                continue;
+            }
+            std::streamsize n = left < room ? left : room;
+            memcpy(pptr(), s_, static_cast<size_t>(n));
+            pbump(static_cast<int>(n));
+            s_ += n;
+            left -= n;
+        }
+        return n_;
+    }
+
+    // ostream flushes often, e.g. every idle round of a drainer, so they are rate limited to flushIntervalMs
+    int sync() override {
+        flush_if_due();
+        return 0;
+    }
+
+private:
+    static int64_t now_ns() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        return ts.tv_sec * 1000000000L + ts.tv_nsec;
+    }
+
+    // buffer is full, under sustained load rotation cuts at the last complete line in it
+    void spill() {
+        size_t size = static_cast<size_t>(pptr() - pbase());
+        if (rotation_due(size)) {
+            const char *nl = static_cast<const char *>(memrchr(buffer, '\n', size));
+            if (nl != nullptr) {
+                size_t head = static_cast<size_t>(nl + 1 - buffer);
+                setp(buffer, buffer + head);
+                pbump(static_cast<int>(head));
+                write_buffer(false);
+                rotate();
+                memmove(buffer, buffer + head, size - head);
+                pbump(static_cast<int>(size - head));
+                return;
+            }
+        }
+        write_buffer(false);
+    }
+
+    const char *extension() const {
+        if (options.compression == SinkCompression::Zstd) return ".zst";
+        if (options.compression == SinkCompression::Lz4) return ".lz4";
+        return "";
+    }
+
+    void open_file(int mode_) {
+        fd = ::open(active_path().c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | mode_, 0644);
+        if (fd < 0) THROW_FRENZY_EXCEPTION("FileSink: open " << active_path() << " failed, " << strerror(errno));
+        fileBytes = 0;
+        lastFlushNs = now_ns();
+        time_t t = time(nullptr);
+        struct tm tm;
+        localtime_r(&t, &tm);
+        if (options.rotateSeconds > 0) {
+            int64_t local = static_cast<int64_t>(t) + tm.tm_gmtoff;
+            rotateAt = (local / options.rotateSeconds + 1) * options.rotateSeconds - tm.tm_gmtoff;
+        }
+        frameStarted = false;
+    }
+
+    bool rotation_due(uint64_t pending_ = 0) const {
+        if (options.rotateBytes > 0 && fileBytes + pending_ >= options.rotateBytes) return true;
+        return options.rotateSeconds > 0 && time(nullptr) >= rotateAt;
+    }
+
+    void init_compression() {
+        if (options.compression == SinkCompression::Zstd) {
+#ifdef FRENZY_HAS_ZSTD
+            zstd = ZSTD_createCCtx();
+            ZSTD_CCtx_setParameter(zstd, ZSTD_c_compressionLevel, options.level);
+            compressed.resize(ZSTD_CStreamOutSize());
+#else
+            THROW_FRENZY_EXCEPTION("FileSink: built without zstd, define FRENZY_HAS_ZSTD");
+#endif
+        } else if (options.compression == SinkCompression::Lz4) {
+#ifdef FRENZY_HAS_LZ4
+            if (LZ4F_isError(LZ4F_createCompressionContext(&lz4, LZ4F_VERSION)))
+                THROW_FRENZY_EXCEPTION("FileSink: lz4 context creation failed");
+            memset(&lz4Prefs, 0, sizeof(lz4Prefs));
+            lz4Prefs.compressionLevel = options.level;
+            compressed.resize(LZ4F_compressBound(options.bufferBytes, &lz4Prefs) + LZ4F_HEADER_SIZE_MAX);
+#else
+            THROW_FRENZY_EXCEPTION("FileSink: built without lz4, define FRENZY_HAS_LZ4");
+#endif
+        }
+    }
+
+    // write the buffer out, compressed if configured, end_ closes the compression frame
+    void write_buffer(bool end_) {
+        size_t size = static_cast<size_t>(pptr() - pbase());
+        if (options.compression == SinkCompression::None) {
+            write_fully(buffer, size);
+        } else {
+            compress(buffer, size, end_);
+        }
+        fileBytes += size;
+        setp(buffer, buffer + options.bufferBytes);
+    }
+
+    void compress(const char *src_, size_t size_, bool end_) {
+#ifdef FRENZY_HAS_ZSTD
+        if (options.compression == SinkCompression::Zstd) {
+            ZSTD_inBuffer in{src_, size_, 0};
+            ZSTD_EndDirective mode = end_ ? ZSTD_e_end : ZSTD_e_flush;
+            size_t remaining = 0;
+            do {
+                ZSTD_outBuffer out{compressed.data(), compressed.size(), 0};
+                remaining = ZSTD_compressStream2(zstd, &out, &in, mode);
+                if (ZSTD_isError(remaining)) {
+                    fprintf(stderr, "FileSink: zstd %s\n", ZSTD_getErrorName(remaining));
+                    return;
+                }
+                write_fully(compressed.data(), out.pos);
+            } while (remaining != 0 || in.pos < in.size);
+            return;
+        }
+#endif
+#ifdef FRENZY_HAS_LZ4
+        if (options.compression == SinkCompression::Lz4) {
+            if (!frameStarted && (size_ > 0 || end_)) {
+                size_t n = LZ4F_compressBegin(lz4, compressed.data(), compressed.size(), &lz4Prefs);
+                if (LZ4F_isError(n)) return;
+                write_fully(compressed.data(), n);
+                frameStarted = true;
+            }
+            if (!frameStarted) return;
+            size_t n = size_ > 0 ? LZ4F_compressUpdate(lz4, compressed.data(), compressed.size(), src_, size_, nullptr)
+                                 : 0;
+            if (!LZ4F_isError(n)) write_fully(compressed.data(), n);
+            n = end_ ? LZ4F_compressEnd(lz4, compressed.data(), compressed.size(), nullptr)
+                     : LZ4F_flush(lz4, compressed.data(), compressed.size(), nullptr);
+            if (!LZ4F_isError(n)) write_fully(compressed.data(), n);
+            if (end_) frameStarted = false;
+            return;
+        }
+#endif
+        (void)src_;
+        (void)size_;
+        (void)end_;
+    }
+
+    void write_fully(const char *data_, size_t size_) {
+        while (size_ > 0) {
+            ssize_t n = ::write(fd, data_, size_);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                fprintf(stderr, "FileSink: write %s failed, %s\n", active_path().c_str(), strerror(errno));
+                return;
+            }
+            data_ += n;
+            size_ -= static_cast<size_t>(n);
+        }
+    }
+
+    std::string basePath;
+    FileSinkOptions options;
+    int fd{-1};
+    char *buffer{nullptr};
+    uint64_t fileBytes{0};  // uncompressed bytes written to the current file
+    int64_t lastFlushNs{0};
+    time_t rotateAt{0};
+    bool frameStarted{false};
+    std::vector<char> compressed;
+#ifdef FRENZY_HAS_ZSTD
+    ZSTD_CCtx *zstd{nullptr};
+#endif
+#ifdef FRENZY_HAS_LZ4
+    LZ4F_cctx *lz4{nullptr};
+    LZ4F_preferences_t lz4Prefs;
+#endif
+};
+}  // namespace frenzy
+
+#endif
@@ -1,23 +1,32 @@
 #include "ShmLog.h"
 #include <fcntl.h>
+#include <sys/syscall.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <utils/Utils.h>
+#include <utils/TimestampFormatter.h>
+#include <utils/TscClock.h>
 #include <cstdarg>
 #include <cstring>
 #include <map>
+#include <mutex>
+#include <new>
+#include <set>
+#include "log/ShmLogArchive.h"
+#include "log/ShmLogDrainer.h"
 #include "media/ShmUtils.h"
 
 using namespace std;
 
 namespace frenzy {
 
-bool ShmLog::initShm(string logShmName, int shmEntryCount) {
+bool ShmLog::initShm(string logShmName, size_t shmBytes, uint32_t regionCount, ShmOverflowPolicy policy) {
     static bool result = false;
     if (shmInited) {
         cerr << "ShmLog::initShm already called, return last result:" << result;
         return result;
     }
+    TscClock::instance();  // calibrate now, not in the first writer holding the shared region lock
     shmInited = true;
 
     if (logShmName.empty()) {
@@ -25,26 +34,47 @@ bool ShmLog::initShm(string logShmName, int shmEntryCount) {
     }
 
     shmPath = logShmName;
-    maxCount = shmEntryCount;
+    regionCount = std::max<uint32_t>(regionCount, 2);
+    size_t regionBytes = nextPowerOf2(std::max<size_t>(shmBytes / regionCount, 2 * MaxRecordLength));
+    size_t regionOffset = (sizeof(ShmLogMeta) + 63) & ~static_cast<size_t>(63);
+    size_t siteOffset = regionOffset + regionCount * sizeof(ShmLogRegion);
+    size_t poolOffset = siteOffset + (MaxShmLogSites + 1) * sizeof(ShmLogSiteEntry);
+    size_t dataOffset = _roundup_pagesize(static_cast<uint32_t>(poolOffset + ShmLogSitePoolBytes));
 
-    size_t fileSize = static_cast<size_t>(maxCount) * sizeof(ShmContent);
-    printf("/dev/shm/%s shm opened with %d * %zu = %zd\n", logShmName.c_str(), maxCount, sizeof(ShmContent), fileSize);
+    size_t fileSize = dataOffset - META_SIZE + regionCount * regionBytes;
+    printf("/dev/shm/%s shm opened with %u regions * %zu bytes\n", logShmName.c_str(), regionCount, regionBytes);
     pShm = (char*)create_mmap_with_meta(logShmName, fileSize);
 
     if (pShm == nullptr) {
         perror("mmap");
         return false;
     }
+    mappedBytes = fileSize;
+    generation = addLiveShmLog();
 
-    pMeta = (ShmLogMeta*)pShm;
-    ShmLogMeta dummy;
-    dummy.totalSize = fileSize;
-    dummy.contentCount = maxCount;
-    *pMeta = dummy;
+    pMeta = new (pShm) ShmLogMeta;
+    pMeta->totalSize = fileSize;
+    pMeta->regionCount = regionCount;
+    pMeta->regionBytes = regionBytes;
+    pMeta->regionOffset = regionOffset;
+    pMeta->siteOffset = siteOffset;
+    pMeta->poolOffset = poolOffset;
+    pMeta->dataOffset = dataOffset;
+    pMeta->overflowPolicy.store(policy, std::memory_order_relaxed);
+    pMeta->printSource.store(printSource, std::memory_order_relaxed);
+    pMeta->producerPid = getpid();
 
-    pData = (ShmContent*)(pShm + META_SIZE);
-    pIndex = &pMeta->writeIndex;
-    dumpThread = std::thread([this] { dumpLog(); });
+    pRegions = reinterpret_cast<ShmLogRegion*>(pShm + regionOffset);
+    for (uint32_t i = 0; i < regionCount; ++i) new (&pRegions[i]) ShmLogRegion;
+    pRegions[0].state.store(SRS_SHARED, std::memory_order_relaxed);
+    pSites = reinterpret_cast<ShmLogSiteEntry*>(pShm + siteOffset);
+    pSitePool = pShm + poolOffset;
+    pData = reinterpret_cast<uint8_t*>(pShm + dataOffset);
+    ringMask = regionBytes - 1;
+    if (dumpThreadEnabled) {
+        pMeta->drainerPid.store(getpid(), std::memory_order_release);
+        dumpThread = std::thread([this] { dumpLog(); });
+    }
     result = true;
     return true;
 }
@@ -74,6 +104,8 @@ bool ShmLog::open(string outfileName, ShmLogPriority priority, bool print, bool
         return true;
     } else {
         strcpy(pMeta->filePath, outfileName.c_str());
+        pMeta->printSource.store(printSource, std::memory_order_relaxed);
+        if (!dumpThreadEnabled) return true;  // shmlogd opens the file
         if (ofs != nullptr) {
             cerr << "ShmLog::open failed, it cannot bind to two outputs" << endl;
             return false;
@@ -82,18 +114,68 @@ bool ShmLog::open(string outfileName, ShmLogPriority priority, bool print, bool
         if (print) {
             os = &std::cout;
         } else {
-            ofs = new ofstream;
-            ofs->open(outfileName, ios::out | ios::app);
-            if (!ofs->is_open()) {
-                cerr << "open outfile:" << outfileName << " failed" << endl;
+            try {
+                sink = new FileSink(outfileName, sinkOptions);
+            } catch (const std::exception& e) {
+                cerr << "open outfile:" << outfileName << " failed, " << e.what() << endl;
                 return false;
             }
+            ofs = new ostream(sink);
             os = ofs;
+            if (this == &instance()) std::atexit([] { ShmLog::instance().stopDump(); });
         }
     }
     return true;
 }
 
+void ShmLog::close() {
+    stopDump();
+    if (pShm == nullptr) return;
+    removeLiveShmLog(generation);  // thread regions of this segment are not released at thread exit any more
+    munmap(pShm, mappedBytes);
+    pShm = nullptr;
+    pMeta = nullptr;
+    pRegions = nullptr;
+    pData = nullptr;
+    pSites = nullptr;
+    pSitePool = nullptr;
+    shmInited = false;
+}
+
+void ShmLog::stopDump() {
+    // the dump thread drains what is left before the buffered sink is closed
+    stopping.store(true, std::memory_order_release);
+    if (dumpThread.joinable()) {
+        dumpThread.join();
+    }
+    if (ofs != nullptr) {
+        os = &std::cout;
+        delete ofs;
+        delete sink;
+        ofs = nullptr;
+        sink = nullptr;
+    }
+    delete archive;
+    archive = nullptr;
+}
+
+bool ShmLog::setArchive(const std::string& path) { return setArchive(path, ShmArchiveOptions{}); }
+
+bool ShmLog::setArchive(const std::string& path, const ShmArchiveOptions& options) {
+    if (shmInited) {
+        cerr << "ShmLog::setArchive must be called before initShm" << endl;
+        return false;
+    }
+    try {
+        archive = new ShmLogArchiveWriter(path, options);
+    } catch (const std::exception& e) {
+        cerr << "open archive:" << path << " failed, " << e.what() << endl;
+        return false;
+    }
+    if (this == &instance()) std::atexit([] { ShmLog::instance().stopDump(); });
+    return true;
+}
+
 ShmLogPriority ShmLog::getPriorityByStr(std::string p) {
     if (p == "debug")
         return frenzy::ShmLogPriority::SLP_DEBUG;
@@ -107,115 +189,366 @@ ShmLogPriority ShmLog::getPriorityByStr(std::string p) {
         return frenzy::ShmLogPriority::SLP_INFO;
 }
 
-const int KeepLinesForConcurrency = 10;
-void ShmLog::dumpLog() {
-    int doneIndex = -1;
-    while (true) {
-        if (readWarpCount > writeWarpCount) {
-            usleep(100 * 1000);
-            continue;
-        }
+namespace {
+// generations of the segments still mapped by this process, a closed one must not be touched at thread exit
+std::mutex liveShmLogsMutex;
+std::set<uint64_t> liveShmLogs;
+uint64_t lastShmLogGeneration = 0;
 
-        if (writeWarpCount - readWarpCount > 1) {
-            cerr << "too fast log case 1, unable to write to disk file, exit dump thread" << endl;
-            cerr << "writeWarpCount:" << writeWarpCount << ", readWarpCount:" << readWarpCount << endl;
-            break;
-        }
+// regions of the calling thread, one per ShmLog it logged to, handed back to the dump thread when it exits
+struct ShmLogThreadRegions {
+    struct Entry {
+        uint64_t generation;
+        ShmLogRegion* region;
+    };
+    Entry last{0, nullptr};  // most recent lookup, the usual thread logs to one ShmLog only
+    std::vector<Entry> entries;
 
-        int curIndex = *pIndex;
-        int dstIndex = curIndex;
-        if (writeWarpCount - readWarpCount == 1) {
-            cout << "warp1, doneIndex:" << doneIndex << ", curIndex:" << curIndex << endl;
-            // shm index exceeded fileout index
-            if (doneIndex < curIndex + 10 * KeepLinesForConcurrency) {
-                cerr << "too fast log case 2, unable to write to disk file, exit dump thread" << endl;
-                break;
+    ~ShmLogThreadRegions() {
+        std::lock_guard<std::mutex> lock(liveShmLogsMutex);
+        for (const Entry& entry : entries) {
+            uint32_t expected = SRS_OWNED;
+            if (liveShmLogs.count(entry.generation) != 0) {
+                entry.region->state.compare_exchange_strong(expected, SRS_RELEASED);
             }
-
-            dstIndex = maxCount - 1;
         }
+    }
+};
+thread_local ShmLogThreadRegions tlsRegions;
+}  // namespace
 
-        // cout << "batch 1, doneIndex:" << doneIndex << ", curIndex:" << curIndex << ", dstIndex:" << dstIndex << endl;
-        for (int i = doneIndex + 1; i <= min(dstIndex - KeepLinesForConcurrency, maxCount - 1); ++i) {
-            *os << genLogContent(pData[i]) << endl;
-            ++doneIndex;
-        }
+uint64_t ShmLog::addLiveShmLog() {
+    std::lock_guard<std::mutex> lock(liveShmLogsMutex);
+    liveShmLogs.insert(++lastShmLogGeneration);
+    return lastShmLogGeneration;
+}
 
-        if (dstIndex != maxCount - 1) {  // not warp
-            usleep(1000);
-        }
+void ShmLog::removeLiveShmLog(uint64_t generation) {
+    std::lock_guard<std::mutex> lock(liveShmLogsMutex);
+    liveShmLogs.erase(generation);
+}
 
-        if (writeWarpCount - readWarpCount > 1) {
-            cerr << "too fast log case 3, unable to write to disk file, exit dump thread" << endl;
-            cerr << "writeWarpCount:" << writeWarpCount << ", readWarpCount:" << readWarpCount << endl;
-            break;
-        }
-        if (writeWarpCount - readWarpCount == 1) {
-            if (doneIndex < *pIndex + 10 * KeepLinesForConcurrency) {
-                cerr << "too fast log case 4, unable to write to disk file, exit dump thread" << endl;
-                break;
-            }
+void ShmLog::dumpLog() {
+    ShmLogDrainer drainer{pShm, os};
+    drainer.setArchive(archive);
+    drainer.run([this, &drainer] {
+        drainer.setOutput(os);  // open() may switch the output after the thread starts
+        return !stopping.load(std::memory_order_acquire);
+    });
+    drainer.drainAll();
+    os->flush();
+}
+
+void ShmLog::copyToRing(uint8_t* ring, uint64_t pos, const void* src, uint32_t length) {
+    uint64_t offset = pos & ringMask;
+    uint64_t first = std::min<uint64_t>(length, pMeta->regionBytes - offset);
+    memcpy(ring + offset, src, first);
+    if (first < length) memcpy(ring, static_cast<const uint8_t*>(src) + first, length - first);
+}
 
-            dstIndex = maxCount - 1;
+ShmLogRegion* ShmLog::threadRegion() {
+    ShmLogThreadRegions& tls = tlsRegions;
+    if (tls.last.generation == generation) return tls.last.region;
+    for (const auto& entry : tls.entries) {
+        if (entry.generation == generation) {
+            tls.last = entry;
+            return entry.region;
         }
+    }
 
-        for (int i = doneIndex + 1; i <= min(dstIndex, maxCount - 1); ++i) {
-            *os << genLogContent(pData[i]) << endl;
-            ++doneIndex;
+    ShmLogRegion* acquired = &pRegions[0];
+    uint32_t regionCount = pMeta->regionCount;
+    uint32_t start = nextRegion.fetch_add(1, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < regionCount - 1; ++i) {
+        ShmLogRegion& region = pRegions[1 + (start + i) % (regionCount - 1)];
+        uint32_t expected = SRS_FREE;
+        if (region.state.compare_exchange_strong(expected, SRS_OWNED, std::memory_order_acquire)) {
+            region.ownerTid = static_cast<int32_t>(syscall(SYS_gettid));
+            acquired = &region;
+            break;
         }
+    }
+    {  // forget the segments closed since, the entry list stays as short as the live ShmLogs
+        std::lock_guard<std::mutex> lock(liveShmLogsMutex);
+        tls.entries.erase(std::remove_if(tls.entries.begin(), tls.entries.end(),
+                                         [](const ShmLogThreadRegions::Entry& entry) {
+                                             return liveShmLogs.count(entry.generation) == 0;
+                                         }),
+                          tls.entries.end());
+    }
+    tls.last = {generation, acquired};
+    tls.entries.push_back(tls.last);
+    return acquired;
+}
 
-        if (doneIndex >= maxCount - 1) {
-            // read finish the last element, warp back
-            ++readWarpCount;
-            doneIndex = -1;
+bool ShmLog::reserve(ShmLogRegion* region, uint64_t pos, uint64_t size) {
+    ShmOverflowPolicy policy = static_cast<ShmOverflowPolicy>(pMeta->overflowPolicy.load(std::memory_order_relaxed));
+    if (policy == SOP_DROP_OLDEST) return true;
+    while (pos + size - region->readPos.load(std::memory_order_acquire) > pMeta->regionBytes) {
+        if (policy == SOP_DROP_NEWEST) {
+            region->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
+        std::this_thread::yield();
     }
+    return true;
 }
 
-void ShmLog::log(ShmLogPriority priority, const char* sourceFile, int line, const char* formatStr, ...) {
+void ShmLog::writeRecord(ShmLogPriority priority, ShmRecordKind kind, uint16_t siteId, const void* payload,
+                         uint32_t length) {
+    ShmRecordHeader header;
+    header.size = static_cast<uint32_t>(sizeof(ShmRecordHeader)) + length;
+    header.priority = priority;
+    header.kind = kind;
+    header.siteId = siteId;
+
     if (!shmInited) {
-        ShmContent shmContent;
-        clock_gettime(CLOCK_REALTIME, &shmContent.ts);
-        shmContent.priority = priority;
-        char* buf = shmContent.msg;
-
-        va_list argp;
-        va_start(argp, formatStr);
-        int n = vsnprintf(buf, MaxLogLength, formatStr, argp);
-        va_end(argp);
-        if (-1 == n || !printSource)
-            buf[MaxLogLength - 1] = '\0';
-        else {
-            buf += n;
-            sprintf(buf, " (%s:%d)", sourceFile, line);
-        }
-        cout << genLogContent(shmContent) << endl;
+        header.tsNs = TscClock::instance().now_ns();
+        cout << genLogContent(header, static_cast<const char*>(payload)) << endl;
         return;
     }
-    int index = -1;
-    while ((index = __sync_add_and_fetch(pIndex, 1)) >= maxCount) {
-        if (__sync_bool_compare_and_swap(pIndex, maxCount, -1) == true) {
-            __sync_add_and_fetch(&writeWarpCount, 1);
-        } else if (*pIndex > maxCount) {
-            std::cerr << "shm overflow, maybe some concurrent log instance" << std::endl;
-            return;
-        }
+
+    ShmLogRegion* region = threadRegion();
+    bool shared = region == pRegions;
+    if (shared) {
+        while (region->writerLock.exchange(1, std::memory_order_acquire) != 0) asm volatile("pause" ::: "memory");
     }
+    uint64_t pos = region->writePos.load(std::memory_order_relaxed);
+    uint64_t size = alignShmRecord(header.size);
+    if (reserve(region, pos, size)) {
+        // after reserve, which may wait under SOP_BLOCK, and inside the lock, so the region stays in time order
+        header.tsNs = TscClock::instance().now_ns();
+        uint8_t* ring = ringOf(static_cast<uint32_t>(region - pRegions));
+        header.commit = pos + 1;
+        // announce the bytes about to be overwritten, a drainer copying them sees it and drops its copy
+        region->reservePos.store(pos + size, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        copyToRing(ring, pos, &header, sizeof(header));
+        copyToRing(ring, pos + sizeof(header), payload, length);
+        region->writePos.store(pos + size, std::memory_order_release);
+    }
+    if (shared) region->writerLock.store(0, std::memory_order_release);
+}
 
-    clock_gettime(CLOCK_REALTIME, &pData[index].ts);
-    pData[index].priority = priority;
-    char* buf = pData[index].msg;
+void ShmLog::log(ShmLogPriority priority, const char* sourceFile, int line, const char* formatStr, ...) {
+    char stackBuf[MaxLogLength];
+    std::vector<char> heapBuf;
+    char* buf = stackBuf;
+    uint32_t size = MaxLogLength;
 
     va_list argp;
     va_start(argp, formatStr);
-    int n = vsnprintf(buf, MaxLogLength, formatStr, argp);
+    va_list retry;
+    va_copy(retry, argp);
+    int n = vsnprintf(buf, size, formatStr, argp);
     va_end(argp);
-    if (-1 == n || !printSource)
-        buf[MaxLogLength - 1] = '\0';
-    else {
-        buf += n;
-        sprintf(buf, " (%s:%d)", sourceFile, line);
+    if (n >= static_cast<int>(size)) {  // long message, format again into a heap buffer
+        size = std::min<uint32_t>(static_cast<uint32_t>(n) + 64, MaxRecordLength - sizeof(ShmRecordHeader));
+        heapBuf.resize(size);
+        buf = heapBuf.data();
+        n = vsnprintf(buf, size, formatStr, retry);
+    }
+    va_end(retry);
+
+    if (n < 0) {
+        n = 0;
+        buf[0] = '\0';
+    } else if (n >= static_cast<int>(size)) {
+        n = static_cast<int>(size) - 1;
+    }
+    if (printSource) {
+        int m = snprintf(buf + n, size - n, " (%s:%d)", sourceFile, line);
+        n = std::min(n + std::max(m, 0), static_cast<int>(size) - 1);
+    }
+    writeRecord(priority, SRK_TEXT, 0, buf, static_cast<uint32_t>(n) + 1);
+}
+
+uint16_t ShmLog::registerSite(ShmLogSite& site, const ShmLogArgType* types, uint8_t count) {
+    site.argTypes = types;
+    site.argCount = count;
+    if (!shmInited) return 0;
+
+    uint32_t id = pMeta->siteCount.load(std::memory_order_relaxed);
+    if (id >= MaxShmLogSites) return 0;
+    id = pMeta->siteCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t formatLength = static_cast<uint32_t>(strlen(site.format)) + 1;
+    uint32_t fileLength = static_cast<uint32_t>(strlen(site.file)) + 1;
+    uint32_t offset = pMeta->poolCursor.fetch_add(formatLength + fileLength + count, std::memory_order_relaxed);
+    if (id > MaxShmLogSites || offset + formatLength + fileLength + count > ShmLogSitePoolBytes) return 0;
+
+    memcpy(pSitePool + offset, site.format, formatLength);
+    memcpy(pSitePool + offset + formatLength, site.file, fileLength);
+    memcpy(pSitePool + offset + formatLength + fileLength, types, count);
+    ShmLogSiteEntry& entry = pSites[id];
+    entry.line = site.line;
+    entry.formatOffset = offset;
+    entry.fileOffset = offset + formatLength;
+    entry.argTypesOffset = offset + formatLength + fileLength;
+    entry.argCount = count;
+    entry.ready.store(1, std::memory_order_release);
+
+    // racing threads of the same site may both get here, the first CAS on site.id wins, the other entry is unused
+    uint16_t expected = 0;
+    if (!site.id.compare_exchange_strong(expected, static_cast<uint16_t>(id), std::memory_order_acq_rel)) {
+        return expected;
+    }
+    return static_cast<uint16_t>(id);
+}
+
+namespace {
+// copy one conversion spec "%[flags][width][.precision][length]conv" out of format
+const char* nextSpec(const char* p, char* spec, int size, char& conv) {
+    int n = 0;
+    spec[n++] = *p++;  // '%'
+    while (*p != '\0' && n < size - 1) {
+        char c = *p++;
+        spec[n++] = c;
+        if (strchr("diouxXeEfFgGaAcspn", c) != nullptr) {
+            conv = c;
+            break;
+        }
+    }
+    spec[n] = '\0';
+    return p;
+}
+}  // namespace
+
+int formatShmLogArgs(const char* format, const ShmLogArgType* argTypes, const uint8_t* payload, char* buf,
+                     int size) {
+    const uint8_t* p = payload;
+    uint8_t stored = *p++;
+    uint8_t argIndex = 0;
+    int pos = 0;
+    const char* f = format;
+    char spec[32];
+    char str[MaxLogLength];
+
+    auto remain = [&]() { return pos < size ? size - pos : 0; };
+    auto advance = [&](int n) {
+        if (n > 0) pos = std::min(pos + n, size - 1);
+    };
+
+    while (*f != '\0' && pos < size - 1) {
+        if (*f != '%') {
+            buf[pos++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            buf[pos++] = '%';
+            f += 2;
+            continue;
+        }
+        char conv = '\0';
+        f = nextSpec(f, spec, sizeof(spec), conv);
+        if (conv == '\0' || conv == 'n') continue;
+        if (argIndex >= stored) {  // truncated on the call site
+            advance(snprintf(buf + pos, remain(), "<trunc>"));
+            break;
+        }
+        switch (argTypes[argIndex++]) {
+            case SLA_INT: {
+                int v;
+                memcpy(&v, p, sizeof(v));
+                p += sizeof(v);
+                advance(snprintf(buf + pos, remain(), spec, v));
+                break;
+            }
+            case SLA_UINT: {
+                unsigned int v;
+                memcpy(&v, p, sizeof(v));
+                p += sizeof(v);
+                advance(snprintf(buf + pos, remain(), spec, v));
+                break;
+            }
+            case SLA_LONG: {
+                long v;
+                memcpy(&v, p, sizeof(v));
+                p += sizeof(v);
+                advance(snprintf(buf + pos, remain(), spec, v));
+                break;
+            }
+            case SLA_ULONG: {
+                unsigned long v;
+                memcpy(&v, p, sizeof(v));
+                p += sizeof(v);
+                advance(snprintf(buf + pos, remain(), spec, v));
+                break;
+            }
+            case SLA_DOUBLE: {
+                double v;
+                memcpy(&v, p, sizeof(v));
+                p += sizeof(v);
+                advance(snprintf(buf + pos, remain(), spec, v));
+                break;
+            }
+            case SLA_LONG_DOUBLE: {
+                long double v;
+                memcpy(&v, p, sizeof(v));
+                p += sizeof(v);
+                advance(snprintf(buf + pos, remain(), spec, v));
+                break;
+            }
+            case SLA_STRING: {
+                uint16_t n;
+                memcpy(&n, p, sizeof(n));
+                n = std::min<uint16_t>(n, MaxLogLength - 1);
+                memcpy(str, p + sizeof(n), n);
+                str[n] = '\0';
+                p += sizeof(n) + n;
+                advance(snprintf(buf + pos, remain(), spec, str));
+                break;
+            }
+            case SLA_POINTER: {
+                const void* v;
+                memcpy(&v, p, sizeof(v));
+                p += sizeof(v);
+                advance(snprintf(buf + pos, remain(), spec, v));
+                break;
+            }
+        }
+    }
+    pos = std::min(pos, size - 1);
+    buf[pos] = '\0';
+    return pos;
+}
+
+std::string genLogContent(const ShmRecordHeader& header, const char* payload, const ShmLogSiteView* site,
+                          bool printSource) {
+    thread_local TimestampFormatter formatter{6};
+    char stamp[TimestampFormatter::MaxLength];
+    std::string content(stamp, formatter.format(header.tsNs, stamp));
+    content += '[';
+    content += ShmLog::getPriorityStr(static_cast<ShmLogPriority>(header.priority));
+    content += ']';
+    if (header.kind == SRK_TEXT) {
+        content.append(payload, strnlen(payload, header.size - sizeof(ShmRecordHeader)));
+        return content;
+    }
+
+    char msg[MaxLogLength];
+    if (site == nullptr) {
+        snprintf(msg, MaxLogLength, "<unknown log site %u>", header.siteId);
+    } else {
+        int n = formatShmLogArgs(site->format, site->argTypes, reinterpret_cast<const uint8_t*>(payload), msg,
+                                 MaxLogLength);
+        if (printSource) snprintf(msg + n, MaxLogLength - n, " (%s:%d)", site->file, site->line);
+    }
+    content += msg;
+    return content;
+}
+
+std::string genLogContent(const ShmRecordHeader& header, const char* payload, const ShmLogMeta* meta) {
+    const char* base = reinterpret_cast<const char*>(meta);
+    const ShmLogSiteEntry* entry = nullptr;
+    if (meta != nullptr && header.kind == SRK_DEFERRED && header.siteId <= MaxShmLogSites) {
+        entry = reinterpret_cast<const ShmLogSiteEntry*>(base + meta->siteOffset) + header.siteId;
+        if (entry->ready.load(std::memory_order_acquire) == 0) entry = nullptr;
     }
+    if (entry == nullptr) return genLogContent(header, payload, nullptr, false);
+    const char* pool = base + meta->poolOffset;
+    ShmLogSiteView site{pool + entry->formatOffset, pool + entry->fileOffset, entry->line,
+                        reinterpret_cast<const ShmLogArgType*>(pool + entry->argTypesOffset)};
+    return genLogContent(header, payload, &site, meta->printSource.load(std::memory_order_relaxed) != 0);
 }
 
 }  // namespace frenzy
@@ -2,55 +2,286 @@
 #define CONCURRENT_SHMLOG_H
 
 #include <utils/Singleton.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <vector>
+#include "log/FileSink.h"
+#include "utils/TscClock.h"
 #include "utils/Utils.h"
 
 namespace frenzy {
 
-constexpr int MaxLogLength = 256;
-constexpr int DefaultShmLogEntryCount = 2 * 1024 * 1024;
+constexpr int MaxLogLength = 1024;              // stack buffer for formatting, longer text takes a heap buffer
+constexpr uint32_t MaxRecordLength = 64 * 1024;  // longer text is truncated
+constexpr size_t DefaultShmLogBytes = 64 * 1024 * 1024;
+constexpr uint32_t DefaultShmLogRegions = 32;
 enum ShmLogPriority : uint8_t { SLP_DEBUG = 01, SLP_INFO = 02, SLP_WARNING = 03, SLP_ERROR = 04, SLP_CRITICAL = 05 };
 
-struct ShmContent {
-    struct timespec ts;
-    ShmLogPriority priority;
-    char msg[MaxLogLength];
+enum ShmRecordKind : uint8_t { SRK_TEXT = 1, SRK_DEFERRED = 2, SRK_SITE = 3 };  // SRK_SITE in archives only
+
+/**
+ * what a writer does when its region is full
+ * SOP_BLOCK: wait for the dump thread, never lose a record
+ * SOP_DROP_NEWEST: discard the new record and count it
+ * SOP_DROP_OLDEST: overwrite unread records, dump thread counts the lost bytes
+ */
+enum ShmOverflowPolicy : uint8_t { SOP_BLOCK = 1, SOP_DROP_NEWEST = 2, SOP_DROP_OLDEST = 3 };
+
+/**
+ * variable length record in the shm byte ring: | ShmRecordHeader | payload | pad to 8 bytes |
+ * commit is the record position + 1, tells a record boundary from a stale one of the previous lap,
+ * so the dump thread can resync after being overrun. records may wrap around the ring end.
+ */
+struct ShmRecordHeader {
+    uint64_t commit;
+    int64_t tsNs;   // CLOCK_REALTIME
+    uint32_t size;  // header included, pad excluded
+    uint8_t priority;
+    uint8_t kind;
+    uint16_t siteId;  // deferred records only
+};
+constexpr uint32_t ShmRecordAlignment = 8;
+
+inline uint64_t alignShmRecord(uint64_t size) {
+    return (size + ShmRecordAlignment - 1) & ~static_cast<uint64_t>(ShmRecordAlignment - 1);
+}
+
+/**
+ * argument types of deferred log, values are stored as their default argument promotion,
+ * so the dump thread passes exactly what vsnprintf would have seen on the call site.
+ */
+enum ShmLogArgType : uint8_t {
+    SLA_INT = 1,
+    SLA_UINT,
+    SLA_LONG,
+    SLA_ULONG,
+    SLA_DOUBLE,
+    SLA_LONG_DOUBLE,
+    SLA_STRING,
+    SLA_POINTER
+};
+
+template <typename T>
+struct ShmLogArgDependentFalse : std::false_type {};
+
+template <typename T>
+constexpr ShmLogArgType shm_log_arg_type() {
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same<D, char *>::value || std::is_same<D, const char *>::value ||
+                  std::is_same<D, std::string>::value) {
+        return SLA_STRING;
+    } else if constexpr (std::is_pointer<D>::value) {
+        return SLA_POINTER;
+    } else if constexpr (std::is_same<D, long double>::value) {
+        return SLA_LONG_DOUBLE;
+    } else if constexpr (std::is_floating_point<D>::value) {
+        return SLA_DOUBLE;
+    } else if constexpr (std::is_enum<D>::value) {
+        return shm_log_arg_type<std::underlying_type_t<D>>();
+    } else if constexpr (std::is_integral<D>::value) {
+        if constexpr (sizeof(D) < sizeof(int) || (sizeof(D) == sizeof(int) && std::is_signed<D>::value)) {
+            return SLA_INT;
+        } else if constexpr (sizeof(D) == sizeof(int)) {
+            return SLA_UINT;
+        } else {
+            return std::is_signed<D>::value ? SLA_LONG : SLA_ULONG;
+        }
+    } else {
+        static_assert(ShmLogArgDependentFalse<D>::value, "unsupported deferred log argument type");
+        return SLA_INT;
+    }
+}
+
+template <typename... Args>
+struct ShmLogArgSignature {
+    static constexpr uint8_t count = sizeof...(Args);
+    static constexpr ShmLogArgType types[sizeof...(Args) + 1] = {shm_log_arg_type<Args>()..., SLA_INT};
+};
+
+/**
+ * one static instance per deferred log call site, constant initialized so the call site has no guard.
+ * id is assigned on first use, when the site is copied into the shm site table,
+ * so a drainer in another process can format the record as well.
+ */
+struct ShmLogSite {
+    const char *format;
+    const char *file;
+    int line;
+    std::atomic<uint16_t> id{0};
+    const ShmLogArgType *argTypes{nullptr};
+    uint8_t argCount{0};
+
+    constexpr ShmLogSite(const char *format_, const char *file_, int line_)
+        : format{format_}, file{file_}, line{line_} {}
+};
+
+// site of a deferred record, resolved from the shm site table or from an archive
+struct ShmLogSiteView {
+    const char* format;
+    const char* file;
+    int line;
+    const ShmLogArgType* argTypes;
+};
+
+constexpr int MaxShmLogSites = 4096;
+constexpr uint32_t ShmLogSitePoolBytes = 512 * 1024;
+
+// shm copy of a ShmLogSite, strings and argument types live in the site pool
+struct ShmLogSiteEntry {
+    std::atomic<uint32_t> ready{0};
+    int32_t line{0};
+    uint32_t formatOffset{0};
+    uint32_t fileOffset{0};
+    uint32_t argTypesOffset{0};
+    uint32_t argCount{0};
+};
+
+/**
+ * format deferred arguments back to text, same as vsnprintf on the call site.
+ * '*' width or precision is not supported.
+ * @return length of the text in buf
+ */
+int formatShmLogArgs(const char* format, const ShmLogArgType* argTypes, const uint8_t* payload, char* buf,
+                     int size);
+
+/**
+ * one SPSC record ring per writer thread, the thread owns it until it exits.
+ * region 0 is shared by threads which find no free region, writers take writerLock there.
+ */
+enum ShmRegionState : uint32_t { SRS_FREE = 0, SRS_OWNED = 1, SRS_RELEASED = 2, SRS_SHARED = 3 };
+
+struct ShmLogRegion {
+    alignas(64) std::atomic<uint64_t> writePos{0};  // bytes written, never wraps
+    std::atomic<uint64_t> reservePos{0};             // end of the record being copied in, >= writePos
+    std::atomic<uint64_t> dropped{0};                // records refused by SOP_DROP_NEWEST
+    alignas(64) std::atomic<uint64_t> readPos{0};   // bytes consumed by dump thread
+    uint64_t reportedDropped{0};                     // dump thread only
+    alignas(64) std::atomic<uint32_t> state{SRS_FREE};
+    std::atomic<uint32_t> writerLock{0};
+    int32_t ownerTid{0};
+};
+
+constexpr uint32_t ShmLogMagic = 0xFF00EE15;
+
+/**
+ * GCRA limiter of one call site, a static instance in each SHM_PERFORM_* macro, lock free.
+ * a site logs up to burst lines at once and perSecond on average, the lines over it are only counted.
+ */
+struct ShmLogRateLimit {
+    std::atomic<int64_t> tat{0};  // theoretical arrival time of the next line, ns
+    std::atomic<uint64_t> suppressed{0};
+
+    constexpr ShmLogRateLimit() {}
+
+    bool allow(int64_t nowNs, int64_t intervalNs, int64_t toleranceNs) {
+        int64_t t = tat.load(std::memory_order_relaxed);
+        while (true) {
+            int64_t next = std::max(t, nowNs) + intervalNs;
+            if (next - nowNs > toleranceNs + intervalNs) {
+                suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (tat.compare_exchange_weak(t, next, std::memory_order_relaxed)) return true;
+        }
+    }
 };
 
 struct ShmLogMeta {
-    uint32_t magic{0xFF00EE11};
+    uint32_t magic{ShmLogMagic};
     size_t metaSize{sizeof(ShmLogMeta)};
     size_t totalSize{0};
-    int contentCount{0};
-    int writeIndex{-1};  // shared memory location, which support multiply writers
+    uint32_t regionCount{0};
+    uint64_t regionBytes{0};   // bytes of each record ring, power of 2
+    uint64_t regionOffset{0};  // offset of ShmLogRegion array from meta
+    uint64_t siteOffset{0};    // offset of ShmLogSiteEntry array from meta
+    uint64_t poolOffset{0};    // offset of the site string pool from meta
+    uint64_t dataOffset{0};    // offset of the first record ring from meta
+    std::atomic<uint8_t> overflowPolicy{SOP_DROP_NEWEST};
+    std::atomic<uint8_t> printSource{0};      // append source location to deferred records
+    std::atomic<uint8_t> collapseRepeats{0};  // drainer folds identical consecutive records into one line
     char filePath[256]{0};
+    int32_t producerPid{0};
+    std::atomic<int32_t> drainerPid{0};  // process which dumps the regions, only one at a time
+    std::atomic<uint32_t> siteCount{0};
+    std::atomic<uint32_t> poolCursor{0};
+    std::atomic<uint64_t> lostBytes{0};       // overwritten before dumped
+    std::atomic<uint64_t> droppedRecords{0};  // refused by writers
 };
 
+class ShmLogArchiveWriter;
+struct ShmArchiveOptions;
+
 class ShmLog {
 public:
     ShmLog() {}
 
-    ~ShmLog() {
-        if (ofs != nullptr) delete ofs;
-        if (dumpThread.joinable()) {
-            dumpThread.join();
-        }
-    }
+    ~ShmLog() { close(); }
 
     static ShmLog& instance() { return Singleton<ShmLog>::instance(); }
 
     /**
-     * log count can not be too small. otherwise it is easily entry overflow
+     * shm size can not be too small, otherwise records are overwritten before dumped.
+     * @param shmBytes bytes of all record rings, each region is rounded up to power of 2
+     * @param regionCount writer threads beyond regionCount - 1 share one locked region
+     */
+    bool initShm(std::string logShmName = "", size_t shmBytes = DefaultShmLogBytes,
+                 uint32_t regionCount = DefaultShmLogRegions, ShmOverflowPolicy policy = SOP_DROP_NEWEST);
+
+    /**
+     * call before initShm, false leaves the draining to shmlogd, logging process does no file I/O then
      */
-    bool initShm(std::string logShmName = "", int maxLogCount = DefaultShmLogEntryCount);
+    void setDumpThread(bool enabled) { dumpThreadEnabled = enabled; }
+
+    /**
+     * call before open, buffering, rotation and compression of the log file
+     */
+    void setSinkOptions(const FileSinkOptions& options) { sinkOptions = options; }
+
+    /**
+     * call before initShm, dump thread also keeps the binary records in path, see ShmLogArchive.h.
+     * query it with shmlogq instead of grepping the text log.
+     */
+    bool setArchive(const std::string& path);
+    bool setArchive(const std::string& path, const ShmArchiveOptions& options);
+
+    void setOverflowPolicy(ShmOverflowPolicy policy) {
+        if (pMeta != nullptr) pMeta->overflowPolicy.store(policy, std::memory_order_relaxed);
+    }
+
+    /**
+     * per call site limit, each LOG_* site may log burst lines at once and perSecond lines on average.
+     * suppressed lines are reported by a warning when the site logs again. 0 turns it off, the default.
+     */
+    void setRateLimit(uint32_t perSecond, uint32_t burst = 1) {
+        int64_t interval = perSecond == 0 ? 0 : 1000000000L / perSecond;
+        rateToleranceNs.store(interval * (burst > 0 ? burst - 1 : 0), std::memory_order_relaxed);
+        rateIntervalNs.store(interval, std::memory_order_relaxed);
+    }
+
+    /**
+     * identical consecutive records are written once, then as one "[repeated N times]" line, off by default
+     */
+    void setCollapseRepeats(bool enabled) {
+        if (pMeta != nullptr) pMeta->collapseRepeats.store(enabled, std::memory_order_relaxed);
+    }
 
     bool open(std::string outfileName = "", ShmLogPriority priority = SLP_INFO, bool print = true,
               bool printSource_ = false);
 
+    /**
+     * stop the dump thread after it drained everything, close the log file and unmap the segment.
+     * writers must be done with this ShmLog by then. the singleton, whose destructor never runs, only stops the
+     * dump at exit and keeps its mapping, late writers of other threads may still log then.
+     */
+    void close();
+
     ShmLogPriority getPriority() const { return priority_; }
     void setPriority(ShmLogPriority p) { priority_ = p; }
     static ShmLogPriority getPriorityByStr(std::string p);
@@ -61,6 +292,33 @@ public:
         log(priority, sourceFile, line, msg.c_str());
     }
 
+    /**
+     * deferred formatting, only the site id and the raw argument bytes are stored on the calling thread,
+     * dump thread does the vsnprintf work. output text is the same as log().
+     */
+    template <typename... Args>
+    void logDeferred(ShmLogPriority priority, ShmLogSite& site, const Args&... args) {
+        uint16_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0) id = registerSite(site, ShmLogArgSignature<Args...>::types, ShmLogArgSignature<Args...>::count);
+
+        uint8_t payload[MaxLogLength];
+        uint8_t* p = payload;
+        uint8_t* end = p + MaxLogLength;
+        uint8_t* pCount = p++;
+        *pCount = 0;
+        (void)std::initializer_list<int>{(encodeArg(p, end, pCount, args), 0)...};
+        uint32_t length = static_cast<uint32_t>((p == nullptr ? end : p) - payload);
+
+        if (id != 0) {
+            writeRecord(priority, SRK_DEFERRED, id, payload, length);
+        } else {  // no shm or site table full, format right now
+            char msg[MaxLogLength];
+            int n = formatShmLogArgs(site.format, site.argTypes, payload, msg, MaxLogLength);
+            if (printSource) snprintf(msg + n, MaxLogLength - n, " (%s:%d)", site.file, site.line);
+            writeRecord(priority, SRK_TEXT, 0, msg, static_cast<uint32_t>(strlen(msg)) + 1);
+        }
+    }
+
     static std::string getPriorityStr(ShmLogPriority priority) {
         if (priority == SLP_DEBUG) {
             return "debug";
@@ -77,55 +335,174 @@ public:
 
     bool can_log(ShmLogPriority priority) { return priority >= priority_; }
 
+    // true if the site is over its rate, a site passing again first reports how many lines it lost
+    bool rateLimited(ShmLogRateLimit& limit, const char* sourceFile, int line) {
+        int64_t interval = rateIntervalNs.load(std::memory_order_relaxed);
+        if (interval == 0) return false;
+        if (!limit.allow(TscClock::instance().now_ns(), interval, rateToleranceNs.load(std::memory_order_relaxed))) {
+            return true;
+        }
+        if (limit.suppressed.load(std::memory_order_relaxed) != 0) {
+            uint64_t n = limit.suppressed.exchange(0, std::memory_order_relaxed);
+            log(SLP_WARNING, sourceFile, line, "rate limit suppressed %lu lines of this site", n);
+        }
+        return false;
+    }
+
 private:
     void dumpLog();
 
-    static std::string genLogContent(const ShmContent& shmContent) {
-        char buf[1024];
-        std::string levelStr = ShmLog::getPriorityStr(shmContent.priority);
-        sprintf(buf, "%s[%s]%s", timespec2string(shmContent.ts).c_str(), levelStr.c_str(), shmContent.msg);
-        return buf;
+    // stop the dump thread after it drained everything, then close the log file and the archive
+    void stopDump();
+
+    // generations identify a mapped segment in the per thread region cache, unlike the address of a ShmLog
+    static uint64_t addLiveShmLog();
+    static void removeLiveShmLog(uint64_t generation);
+
+    // copy one record into the ring, or print it directly when shm is not inited
+    void writeRecord(ShmLogPriority priority, ShmRecordKind kind, uint16_t siteId, const void* payload,
+                     uint32_t length);
+
+    // region of the calling thread in this segment, acquired on its first log
+    ShmLogRegion* threadRegion();
+
+    // reserve space for size bytes in a region according to overflow policy, false if dropped
+    bool reserve(ShmLogRegion* region, uint64_t pos, uint64_t size);
+
+    uint8_t* ringOf(uint32_t index) const { return pData + index * pMeta->regionBytes; }
+    void copyToRing(uint8_t* ring, uint64_t pos, const void* src, uint32_t length);
+
+    // copy the site into the shm site table, return 0 if there is no shm or the table is full
+    uint16_t registerSite(ShmLogSite& site, const ShmLogArgType* types, uint8_t count);
+
+    template <typename T>
+    static void encodeArg(uint8_t*& p, uint8_t* end, uint8_t* pCount, const T& arg) {
+        if (p == nullptr) return;  // previous argument truncated, drop the rest
+        constexpr ShmLogArgType type = shm_log_arg_type<T>();
+        if constexpr (type == SLA_STRING) {
+            const char* str = nullptr;
+            size_t len = 0;
+            if constexpr (std::is_same<std::decay_t<T>, std::string>::value) {
+                str = arg.c_str();
+                len = arg.size();
+            } else {
+                str = arg;  // decays char arrays, which can not be null
+                if (str == nullptr) str = "(null)";
+                len = std::strlen(str);
+            }
+            if (p + sizeof(uint16_t) > end) {
+                p = nullptr;
+                return;
+            }
+            uint16_t n = static_cast<uint16_t>(std::min<size_t>(len, static_cast<size_t>(end - p) - sizeof(uint16_t)));
+            memcpy(p, &n, sizeof(uint16_t));
+            memcpy(p + sizeof(uint16_t), str, n);
+            p += sizeof(uint16_t) + n;
+        } else {
+            using Stored = std::conditional_t<
+                type == SLA_INT, int,
+                std::conditional_t<
+                    type == SLA_UINT, unsigned int,
+                    std::conditional_t<
+                        type == SLA_LONG, long,
+                        std::conditional_t<type == SLA_ULONG, unsigned long,
+                                           std::conditional_t<type == SLA_DOUBLE, double,
+                                                              std::conditional_t<type == SLA_LONG_DOUBLE,
+                                                                                 long double, const void*>>>>>>;
+            if (p + sizeof(Stored) > end) {
+                p = nullptr;
+                return;
+            }
+            Stored v = (Stored)(arg);
+            memcpy(p, &v, sizeof(Stored));
+            p += sizeof(Stored);
+        }
+        ++*pCount;
     }
 
 public:
     char* pShm{nullptr};  // start address of shm
     ShmLogMeta* pMeta{nullptr};
-    ShmContent* pData{nullptr};     // ShmContent address
-    int* volatile pIndex{nullptr};  // point to ShmLogMeta.writeIndex, support multi-writer
-    int maxCount{0};
-    volatile int writeWarpCount{0};  // current writer pos warp count
-    int readWarpCount{0};            // read pos warp count
+    ShmLogRegion* pRegions{nullptr};
+    uint8_t* pData{nullptr};  // first record ring address
+    ShmLogSiteEntry* pSites{nullptr};
+    char* pSitePool{nullptr};
+    uint64_t ringMask{0};
+    size_t mappedBytes{0};
+    uint64_t generation{0};                   // of the mapped segment, 0 before initShm
+    std::atomic<uint32_t> nextRegion{1};      // hint for the next free region scan
+    std::atomic<int64_t> rateIntervalNs{0};   // per site rate limit, 0 is off
+    std::atomic<int64_t> rateToleranceNs{0};  // burst allowance
     ShmLogPriority priority_{SLP_INFO};
     std::string shmPath;
     std::ostream* os{&std::cout};  // no need to destruct
-    std::ofstream* ofs{nullptr};   // this should be destructed
+    std::ostream* ofs{nullptr};    // stream over sink, this should be destructed
+    FileSink* sink{nullptr};
+    FileSinkOptions sinkOptions;
+    ShmLogArchiveWriter* archive{nullptr};
+    std::atomic<bool> stopping{false};
     bool shmInited{false};
     bool opened_{false};  // prevent open shm multi time
     bool printSource{true};
+    bool dumpThreadEnabled{true};
 
     std::thread dumpThread;
 };
 
+/**
+ * text of one record as it goes into the log file, deferred records are formatted through site entries
+ */
+std::string genLogContent(const ShmRecordHeader& header, const char* payload, const ShmLogMeta* meta = nullptr);
+
+// same with the site already resolved, nullptr if unknown
+std::string genLogContent(const ShmRecordHeader& header, const char* payload, const ShmLogSiteView* site,
+                          bool printSource);
+
 }  // namespace frenzy
 
-#define SHM_PERFORM_LOG(priority, file, line, format, ...)                               \
-    do {                                                                                 \
-        if (frenzy::ShmLog::instance().can_log(priority)) {                              \
-            frenzy::ShmLog::instance().log(priority, file, line, format, ##__VA_ARGS__); \
-        }                                                                                \
+#define SHM_PERFORM_LOG(priority, file, line, format, ...)                                   \
+    do {                                                                                     \
+        if (frenzy::ShmLog::instance().can_log(priority)) {                                  \
+            static frenzy::ShmLogRateLimit __shm_log_limit;                                  \
+            if (!frenzy::ShmLog::instance().rateLimited(__shm_log_limit, file, line)) {      \
+                frenzy::ShmLog::instance().log(priority, file, line, format, ##__VA_ARGS__); \
+            }                                                                                \
+        }                                                                                    \
     } while (false)
 
+// format string must be a literal, it is kept by pointer and formatted later on the dump thread
+#define SHM_PERFORM_DEFERRED_LOG(priority, file, line, format, ...)                              \
+    do {                                                                                          \
+        if (frenzy::ShmLog::instance().can_log(priority)) {                                       \
+            static frenzy::ShmLogSite __shm_log_site{format, file, line};                         \
+            static frenzy::ShmLogRateLimit __shm_log_limit;                                       \
+            if (!frenzy::ShmLog::instance().rateLimited(__shm_log_limit, file, line)) {           \
+                frenzy::ShmLog::instance().logDeferred(priority, __shm_log_site, ##__VA_ARGS__); \
+            }                                                                                     \
+        }                                                                                         \
+    } while (false)
+
+/**
+ * define SHM_LOG_DEFERRED_FORMAT to switch LOG_* to deferred formatting,
+ * '*' width or precision is not supported then.
+ */
+#ifdef SHM_LOG_DEFERRED_FORMAT
+#define SHM_LOG_DISPATCH SHM_PERFORM_DEFERRED_LOG
+#else
+#define SHM_LOG_DISPATCH SHM_PERFORM_LOG
+#endif
+
 #define LOG_SET_PRIORITY(priority) frenzy::ShmLog::instance().setPriority(priority);
-#define LOG_DEBUG(...) SHM_PERFORM_LOG(frenzy::ShmLogPriority::SLP_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
-#define LOG_INFO(...) SHM_PERFORM_LOG(frenzy::ShmLogPriority::SLP_INFO, __FILE__, __LINE__, __VA_ARGS__)
-#define LOG_WARN(...) SHM_PERFORM_LOG(frenzy::ShmLogPriority::SLP_WARNING, __FILE__, __LINE__, __VA_ARGS__)
-#define LOG_ERROR(...) SHM_PERFORM_LOG(frenzy::ShmLogPriority::SLP_ERROR, __FILE__, __LINE__, __VA_ARGS__)
-#define LOG_CRITICAL(...) SHM_PERFORM_LOG(frenzy::ShmLogPriority::SLP_CRITICAL, __FILE__, __LINE__, __VA_ARGS__)
-
-#define INIT_DEFAULT_SHM_LOG()                       \
-    do {                                             \
-        frenzy::ShmLog::instance().initShm("", 100); \
-        frenzy::ShmLog::instance().open();           \
+#define LOG_DEBUG(...) SHM_LOG_DISPATCH(frenzy::ShmLogPriority::SLP_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_INFO(...) SHM_LOG_DISPATCH(frenzy::ShmLogPriority::SLP_INFO, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARN(...) SHM_LOG_DISPATCH(frenzy::ShmLogPriority::SLP_WARNING, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) SHM_LOG_DISPATCH(frenzy::ShmLogPriority::SLP_ERROR, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_CRITICAL(...) SHM_LOG_DISPATCH(frenzy::ShmLogPriority::SLP_CRITICAL, __FILE__, __LINE__, __VA_ARGS__)
+
+#define INIT_DEFAULT_SHM_LOG()                           \
+    do {                                                 \
+        frenzy::ShmLog::instance().initShm("", 1 << 20); \
+        frenzy::ShmLog::instance().open();               \
     } while (false)
 
 #endif
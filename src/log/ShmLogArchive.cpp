@@ -0,0 +1,280 @@
+#include "ShmLogArchive.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include "utils/FrenzyException.h"
+
+namespace frenzy {
+
+namespace {
+constexpr uint32_t MaxSiteRecordBytes = 8 * 1024;  // longer site definitions are left out, rendered as unknown
+
+uint32_t siteRecordBytes(const ShmLogSiteView& site, uint32_t argCount) {
+    return static_cast<uint32_t>(sizeof(ShmArchiveRecord) + sizeof(int32_t) + 1 + argCount +
+                                 strlen(site.format) + 1 + strlen(site.file) + 1);
+}
+
+// site of a deferred record from the segment's site table, false if it is not there
+bool lookupSite(const ShmLogMeta* meta, uint16_t id, ShmLogSiteView& site, uint32_t& argCount) {
+    if (meta == nullptr || id == 0 || id > MaxShmLogSites) return false;
+    const char* base = reinterpret_cast<const char*>(meta);
+    const ShmLogSiteEntry& entry = reinterpret_cast<const ShmLogSiteEntry*>(base + meta->siteOffset)[id];
+    if (entry.ready.load(std::memory_order_acquire) == 0) return false;
+    const char* pool = base + meta->poolOffset;
+    site = ShmLogSiteView{pool + entry.formatOffset, pool + entry.fileOffset, entry.line,
+                          reinterpret_cast<const ShmLogArgType*>(pool + entry.argTypesOffset)};
+    argCount = entry.argCount;
+    return true;
+}
+}  // namespace
+
+ShmLogArchiveWriter::ShmLogArchiveWriter(const std::string& path_, const ShmArchiveOptions& options_)
+    : basePath{path_}, options{options_}, sitesWritten(MaxShmLogSites + 1) {
+    uint32_t minBytes = MaxRecordLength + sizeof(ShmArchiveBlock) + sizeof(ShmArchiveRecord) + MaxSiteRecordBytes;
+    options.blockBytes = (std::max(options.blockBytes, minBytes) + 4095) & ~4095U;
+    blockData.resize(options.blockBytes);
+    if (access(basePath.c_str(), F_OK) == 0) rotate();
+    openFile();
+}
+
+ShmLogArchiveWriter::~ShmLogArchiveWriter() {
+    if (fd < 0) return;
+    flush();
+    ::close(fd);
+}
+
+void ShmLogArchiveWriter::openFile() {
+    fd = ::open(basePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) THROW_FRENZY_EXCEPTION("ShmLogArchiveWriter: open " << basePath << " failed, " << strerror(errno));
+    fileHeader = ShmArchiveFileHeader{};
+    fileHeader.blockBytes = options.blockBytes;
+    fileHeader.producerPid = getpid();
+    fileHeader.createdNs = TscClock::realtime_ns();
+    headerDirty = true;
+    blockIndex = 0;
+    std::fill(sitesWritten.begin(), sitesWritten.end(), 0);
+    startBlock();
+}
+
+// close the file and move it aside with a time suffix, the next one starts at basePath
+void ShmLogArchiveWriter::rotate() {
+    if (fd >= 0) {
+        flush();
+        ::close(fd);
+        fd = -1;
+    }
+    char suffix[32];
+    time_t t = time(nullptr);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(suffix, sizeof(suffix), ".%Y%m%d-%H%M%S", &tm);
+    std::string rotated = basePath + suffix;
+    for (int i = 1; access(rotated.c_str(), F_OK) == 0; ++i) rotated = basePath + suffix + "." + std::to_string(i);
+    if (::rename(basePath.c_str(), rotated.c_str()) != 0) {
+        fprintf(stderr, "ShmLogArchiveWriter: rename %s failed, %s\n", basePath.c_str(), strerror(errno));
+    }
+}
+
+void ShmLogArchiveWriter::startBlock() {
+    block = ShmArchiveBlock{};
+    block.used = sizeof(ShmArchiveBlock);
+    flushedBytes = sizeof(ShmArchiveBlock);
+}
+
+void ShmLogArchiveWriter::finishBlock() {
+    flush();
+    ++blockIndex;
+    uint64_t fileBytes = ShmArchiveFileHeaderBytes + blockIndex * options.blockBytes;
+    if (options.rotateBytes > 0 && fileBytes >= options.rotateBytes) {
+        rotate();
+        openFile();
+    } else {
+        startBlock();
+    }
+}
+
+void ShmLogArchiveWriter::append(const ShmRecordHeader& header, const char* payload, int32_t tid,
+                                 const ShmLogMeta* meta) {
+    uint32_t length = header.size - static_cast<uint32_t>(sizeof(ShmRecordHeader));
+    uint64_t need = alignShmRecord(sizeof(ShmArchiveRecord) + length);
+    ShmLogSiteView site{};
+    uint32_t argCount = 0;
+    bool newSite = header.kind == SRK_DEFERRED && sitesWritten[header.siteId] == 0 &&
+                   lookupSite(meta, header.siteId, site, argCount);
+    if (newSite) need += alignShmRecord(siteRecordBytes(site, argCount));
+    if (block.used + need > options.blockBytes) {
+        finishBlock();  // a rotated file needs the definition again
+        newSite = header.kind == SRK_DEFERRED && sitesWritten[header.siteId] == 0 &&
+                  lookupSite(meta, header.siteId, site, argCount);
+    }
+
+    if (meta != nullptr && fileHeader.printSource != meta->printSource.load(std::memory_order_relaxed)) {
+        fileHeader.printSource = meta->printSource.load(std::memory_order_relaxed);
+        headerDirty = true;
+    }
+    if (newSite) {
+        sitesWritten[header.siteId] = 1;
+        if (siteRecordBytes(site, argCount) <= MaxSiteRecordBytes) {
+            std::string def(sizeof(int32_t), '\0');
+            memcpy(&def[0], &site.line, sizeof(int32_t));
+            def += static_cast<char>(argCount);
+            def.append(reinterpret_cast<const char*>(site.argTypes), argCount);
+            def.append(site.format, strlen(site.format) + 1);
+            def.append(site.file, strlen(site.file) + 1);
+            ShmArchiveRecord r{header.tsNs, 0, tid, header.siteId, header.priority, SRK_SITE, 0};
+            appendRecord(r, def.data(), static_cast<uint32_t>(def.size()));
+            ++block.siteCount;
+        }
+    }
+
+    ShmArchiveRecord r{header.tsNs, 0, tid, header.siteId, header.priority, header.kind, 0};
+    appendRecord(r, payload, length);
+    block.minTs = std::min(block.minTs, r.tsNs);
+    block.maxTs = std::max(block.maxTs, r.tsNs);
+    block.minTid = std::min(block.minTid, tid);
+    block.maxTid = std::max(block.maxTid, tid);
+    block.minSite = std::min(block.minSite, r.siteId);
+    block.maxSite = std::max(block.maxSite, r.siteId);
+    block.minPriority = std::min(block.minPriority, r.priority);
+    block.maxPriority = std::max(block.maxPriority, r.priority);
+}
+
+void ShmLogArchiveWriter::appendRecord(const ShmArchiveRecord& record, const char* payload, uint32_t length) {
+    char* p = blockData.data() + block.used;
+    uint32_t size = static_cast<uint32_t>(sizeof(ShmArchiveRecord)) + length;
+    memcpy(p, &record, sizeof(ShmArchiveRecord));
+    reinterpret_cast<ShmArchiveRecord*>(p)->size = size;
+    memcpy(p + sizeof(ShmArchiveRecord), payload, length);
+    memset(p + size, 0, alignShmRecord(size) - size);
+    block.used += static_cast<uint32_t>(alignShmRecord(size));
+    ++block.count;
+}
+
+void ShmLogArchiveWriter::flush() {
+    if (fd < 0) return;
+    if (headerDirty) {
+        writeAt(&fileHeader, sizeof(fileHeader), 0);
+        headerDirty = false;
+    }
+    if (block.used == flushedBytes) return;
+    uint64_t offset = ShmArchiveFileHeaderBytes + blockIndex * options.blockBytes;
+    // records first, the header which makes them visible after
+    writeAt(blockData.data() + flushedBytes, block.used - flushedBytes, offset + flushedBytes);
+    writeAt(&block, sizeof(block), offset);
+    flushedBytes = block.used;
+}
+
+void ShmLogArchiveWriter::writeAt(const void* data, size_t size, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "ShmLogArchiveWriter: write %s failed, %s\n", basePath.c_str(), strerror(errno));
+            return;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+}
+
+ShmLogArchiveReader::ShmLogArchiveReader(const std::string& path_) : path{path_} {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) THROW_FRENZY_EXCEPTION("ShmLogArchiveReader: open " << path << " failed, " << strerror(errno));
+    struct stat stats;
+    if (fstat(fd, &stats) < 0 || static_cast<size_t>(stats.st_size) < ShmArchiveFileHeaderBytes) {
+        ::close(fd);
+        THROW_FRENZY_EXCEPTION("ShmLogArchiveReader: " << path << " is not a ShmLog archive");
+    }
+    size = static_cast<size_t>(stats.st_size);
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) THROW_FRENZY_EXCEPTION("ShmLogArchiveReader: mmap " << path << " failed");
+    base = static_cast<char*>(addr);
+    header = reinterpret_cast<const ShmArchiveFileHeader*>(base);
+    if (header->magic != ShmArchiveMagic || header->blockBytes < sizeof(ShmArchiveBlock)) {
+        munmap(base, size);
+        THROW_FRENZY_EXCEPTION("ShmLogArchiveReader: " << path << " is not a ShmLog archive");
+    }
+
+    // headers only, the last block may be partial or not written yet
+    sites.resize(MaxShmLogSites + 1, ShmLogSiteView{nullptr, nullptr, 0, nullptr});
+    for (size_t i = 0; ShmArchiveFileHeaderBytes + i * header->blockBytes + sizeof(ShmArchiveBlock) <= size; ++i) {
+        const ShmArchiveBlock* b = reinterpret_cast<const ShmArchiveBlock*>(blockAt(i));
+        if (b->magic != ShmArchiveBlockMagic || b->used > header->blockBytes ||
+            static_cast<size_t>(blockAt(i) - base) + b->used > size) {
+            break;
+        }
+        blocks.push_back(*b);
+        if (b->siteCount > 0) loadSites(i);
+    }
+    maxTsUpTo.resize(blocks.size());
+    minTsFrom.resize(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        maxTsUpTo[i] = i == 0 ? blocks[i].maxTs : std::max(maxTsUpTo[i - 1], blocks[i].maxTs);
+    }
+    for (size_t i = blocks.size(); i-- > 0;) {
+        minTsFrom[i] = i + 1 == blocks.size() ? blocks[i].minTs : std::min(minTsFrom[i + 1], blocks[i].minTs);
+    }
+}
+
+ShmLogArchiveReader::~ShmLogArchiveReader() { munmap(base, size); }
+
+void ShmLogArchiveReader::loadSites(size_t i) {
+    const char* p = blockAt(i) + sizeof(ShmArchiveBlock);
+    const char* end = blockAt(i) + blocks[i].used;
+    while (p + sizeof(ShmArchiveRecord) <= end) {
+        const ShmArchiveRecord* r = reinterpret_cast<const ShmArchiveRecord*>(p);
+        if (r->size < sizeof(ShmArchiveRecord) || p + r->size > end) break;
+        if (r->kind == SRK_SITE && r->siteId <= MaxShmLogSites) {
+            const char* def = p + sizeof(ShmArchiveRecord);
+            const char* defEnd = p + r->size;
+            ShmLogSiteView& site = sites[r->siteId];
+            memcpy(&site.line, def, sizeof(int32_t));
+            uint8_t argCount = static_cast<uint8_t>(def[sizeof(int32_t)]);
+            site.argTypes = reinterpret_cast<const ShmLogArgType*>(def + sizeof(int32_t) + 1);
+            site.format = def + sizeof(int32_t) + 1 + argCount;
+            site.file = site.format + strnlen(site.format, static_cast<size_t>(defEnd - site.format)) + 1;
+            if (site.file >= defEnd) site.format = nullptr;  // truncated, leave it unknown
+        }
+        p += alignShmRecord(r->size);
+    }
+}
+
+std::string ShmLogArchiveReader::render(const ShmArchiveRecord& record, const char* payload) const {
+    ShmRecordHeader h{};
+    h.tsNs = record.tsNs;
+    h.size = record.size - static_cast<uint32_t>(sizeof(ShmArchiveRecord) - sizeof(ShmRecordHeader));
+    h.priority = record.priority;
+    h.kind = record.kind;
+    h.siteId = record.siteId;
+    const ShmLogSiteView* site = nullptr;
+    if (record.kind == SRK_DEFERRED && record.siteId <= MaxShmLogSites && sites[record.siteId].format != nullptr) {
+        site = &sites[record.siteId];
+    }
+    return genLogContent(h, payload, site, header->printSource != 0);
+}
+
+std::vector<uint16_t> ShmLogArchiveReader::findSites(const std::string& file_, int line_) const {
+    std::vector<uint16_t> ids;
+    for (size_t id = 1; id < sites.size(); ++id) {
+        const ShmLogSiteView& site = sites[id];
+        if (site.format == nullptr || (line_ != 0 && site.line != line_)) continue;
+        size_t length = strlen(site.file);
+        if (length >= file_.size() && file_.compare(0, file_.size(), site.file + length - file_.size()) == 0) {
+            ids.push_back(static_cast<uint16_t>(id));
+        }
+    }
+    return ids;
+}
+
+int64_t ShmLogArchiveReader::firstNs() const { return blocks.empty() ? 0 : minTsFrom.front(); }
+
+int64_t ShmLogArchiveReader::lastNs() const { return blocks.empty() ? 0 : maxTsUpTo.back(); }
+}  // namespace frenzy
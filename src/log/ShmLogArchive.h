@@ -0,0 +1,209 @@
+#ifndef CONCURRENT_SHMLOG_ARCHIVE_H
+#define CONCURRENT_SHMLOG_ARCHIVE_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "log/ShmLog.h"
+
+namespace frenzy {
+
+constexpr uint32_t ShmArchiveMagic = 0x534C4231;  // "SLB1"
+constexpr uint32_t ShmArchiveBlockMagic = 0x534C4242;
+constexpr uint32_t ShmArchiveFileHeaderBytes = 64;
+
+/**
+ * binary ShmLog records on disk, the text is rendered only when queried.
+ * | ShmArchiveFileHeader | block 0 | block 1 | ...
+ * every block takes blockBytes in the file, so block i is at a known offset, the last one may be partial.
+ * blocks follow the drainer merge order, which is timestamp order.
+ */
+struct ShmArchiveFileHeader {
+    uint32_t magic{ShmArchiveMagic};
+    uint32_t blockBytes{0};
+    uint32_t printSource{0};  // deferred records get " (file:line)" appended, as in the text log
+    int32_t producerPid{0};
+    int64_t createdNs{0};
+    char reserved[40]{};
+};
+static_assert(sizeof(ShmArchiveFileHeader) == ShmArchiveFileHeaderBytes, "archive header layout");
+
+/**
+ * block header, a query skips the block by its min/max without reading any record.
+ * site definitions are not counted in the min/max, only log records are.
+ */
+struct ShmArchiveBlock {
+    uint32_t magic{ShmArchiveBlockMagic};
+    uint32_t used{0};       // bytes of header and records
+    uint32_t count{0};      // records, site definitions included
+    uint32_t siteCount{0};  // site definitions
+    int64_t minTs{INT64_MAX};
+    int64_t maxTs{INT64_MIN};
+    int32_t minTid{INT32_MAX};
+    int32_t maxTid{INT32_MIN};
+    uint16_t minSite{UINT16_MAX};
+    uint16_t maxSite{0};
+    uint8_t minPriority{UINT8_MAX};
+    uint8_t maxPriority{0};
+    char reserved[18]{};
+};
+static_assert(sizeof(ShmArchiveBlock) == 64, "archive block layout");
+
+/**
+ * record in a block: | ShmArchiveRecord | payload | pad to 8 bytes |, payload is the same as in the shm ring.
+ * a deferred record's site is defined by an SRK_SITE record earlier in the same file, its payload is
+ * | int32 line | uint8 argCount | argTypes | format \0 | file \0 |
+ */
+struct ShmArchiveRecord {
+    int64_t tsNs;
+    uint32_t size;  // header included, pad excluded
+    int32_t tid;    // writer thread, 0 for the shared region
+    uint16_t siteId;
+    uint8_t priority;
+    uint8_t kind;
+    uint32_t reserved;
+};
+
+struct ShmArchiveOptions {
+    uint32_t blockBytes{256 * 1024};  // raised to fit the longest record
+    uint64_t rotateBytes{0};          // file size, 0 disables rotation
+};
+
+/**
+ * appends drained records to an archive file, owned by one drainer thread.
+ * an existing file is renamed with a time suffix first, so a file holds one producer run and its site ids.
+ */
+class ShmLogArchiveWriter {
+public:
+    explicit ShmLogArchiveWriter(const std::string& path_, const ShmArchiveOptions& options_ = ShmArchiveOptions{});
+    ~ShmLogArchiveWriter();
+
+    ShmLogArchiveWriter(const ShmLogArchiveWriter&) = delete;
+    ShmLogArchiveWriter& operator=(const ShmLogArchiveWriter&) = delete;
+
+    /**
+     * @param tid writer thread of the record
+     * @param meta segment of the record, for site definitions of deferred records
+     */
+    void append(const ShmRecordHeader& header, const char* payload, int32_t tid, const ShmLogMeta* meta);
+
+    // write what is new in the current block, the file is readable up to here
+    void flush();
+
+    const std::string& path() const { return basePath; }
+
+private:
+    void openFile();
+    void rotate();
+    void startBlock();
+    void finishBlock();
+    void appendSite(const ShmRecordHeader& header, const ShmLogMeta* meta);
+    void appendRecord(const ShmArchiveRecord& record, const char* payload, uint32_t length);
+    void writeAt(const void* data, size_t size, uint64_t offset);
+
+    std::string basePath;
+    ShmArchiveOptions options;
+    int fd{-1};
+    ShmArchiveFileHeader fileHeader;
+    bool headerDirty{true};
+    uint64_t blockIndex{0};
+    ShmArchiveBlock block;
+    std::vector<char> blockData;  // current block, header included
+    uint32_t flushedBytes{0};     // of the current block
+    std::vector<char> sitesWritten;
+};
+
+// which records a query returns, a zero or empty field matches everything
+struct ShmArchiveQuery {
+    int64_t fromNs{INT64_MIN};
+    int64_t toNs{INT64_MAX};
+    uint8_t minPriority{0};
+    int32_t tid{0};
+    std::vector<uint16_t> sites;  // sorted
+
+    bool matches(const ShmArchiveRecord& r) const {
+        return r.kind != SRK_SITE && r.tsNs >= fromNs && r.tsNs <= toNs && r.priority >= minPriority &&
+               (tid == 0 || r.tid == tid) &&
+               (sites.empty() || std::binary_search(sites.begin(), sites.end(), r.siteId));
+    }
+
+    bool mayMatch(const ShmArchiveBlock& b) const {
+        if (b.count == b.siteCount) return false;  // nothing but site definitions
+        if (b.maxTs < fromNs || b.minTs > toNs || b.maxPriority < minPriority) return false;
+        if (tid != 0 && (tid < b.minTid || tid > b.maxTid)) return false;
+        if (sites.empty()) return true;
+        auto it = std::lower_bound(sites.begin(), sites.end(), b.minSite);
+        return it != sites.end() && *it <= b.maxSite;
+    }
+};
+
+/**
+ * read only mmap of an archive file. block headers are indexed on open, a query binary searches the index
+ * by time and only reads blocks whose min/max may match.
+ */
+class ShmLogArchiveReader {
+public:
+    explicit ShmLogArchiveReader(const std::string& path_);
+    ~ShmLogArchiveReader();
+
+    ShmLogArchiveReader(const ShmLogArchiveReader&) = delete;
+    ShmLogArchiveReader& operator=(const ShmLogArchiveReader&) = delete;
+
+    /**
+     * call f(record, payload) for each matching record in file order, f returns false to stop
+     * @return number of blocks read
+     */
+    template <typename F>
+    size_t query(const ShmArchiveQuery& q, F&& f) const {
+        // first block which may hold fromNs, its max and all maxima before it are earlier
+        size_t i = static_cast<size_t>(std::partition_point(maxTsUpTo.begin(), maxTsUpTo.end(),
+                                                            [&q](int64_t ts) { return ts < q.fromNs; }) -
+                                       maxTsUpTo.begin());
+        size_t scanned = 0;
+        for (; i < blocks.size() && minTsFrom[i] <= q.toNs; ++i) {
+            if (!q.mayMatch(blocks[i])) continue;
+            ++scanned;
+            const char* p = blockAt(i) + sizeof(ShmArchiveBlock);
+            const char* end = blockAt(i) + blocks[i].used;
+            while (p + sizeof(ShmArchiveRecord) <= end) {
+                const ShmArchiveRecord* r = reinterpret_cast<const ShmArchiveRecord*>(p);
+                if (r->size < sizeof(ShmArchiveRecord) || p + r->size > end) break;
+                if (q.matches(*r) && !f(*r, p + sizeof(ShmArchiveRecord))) return scanned;
+                p += alignShmRecord(r->size);
+            }
+        }
+        return scanned;
+    }
+
+    // text of a record, the same line as the text log has
+    std::string render(const ShmArchiveRecord& record, const char* payload) const;
+
+    /**
+     * ids of the sites whose file ends with file_, and whose line is line_ unless it is 0
+     */
+    std::vector<uint16_t> findSites(const std::string& file_, int line_ = 0) const;
+
+    size_t blockCount() const { return blocks.size(); }
+    int64_t firstNs() const;
+    int64_t lastNs() const;
+
+private:
+    const char* blockAt(size_t i) const {
+        return base + ShmArchiveFileHeaderBytes + i * static_cast<uint64_t>(header->blockBytes);
+    }
+    void loadSites(size_t i);
+
+    std::string path;
+    char* base{nullptr};
+    size_t size{0};
+    const ShmArchiveFileHeader* header{nullptr};
+    std::vector<ShmArchiveBlock> blocks;
+    std::vector<int64_t> maxTsUpTo;  // running max of block maxTs, monotonic even if blocks overlap a little
+    std::vector<int64_t> minTsFrom;  // running min of block minTs from the end
+    std::vector<ShmLogSiteView> sites;  // by id, format nullptr if not defined
+};
+}  // namespace frenzy
+
+#endif
@@ -0,0 +1,199 @@
+#include "ShmLogDrainer.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+
+using namespace std;
+
+namespace frenzy {
+
+ShmLogDrainer::ShmLogDrainer(char* shm_, std::ostream* os_, size_t mappedSize_)
+    : shm{shm_}, mappedSize{mappedSize_}, os{os_} {
+    meta = reinterpret_cast<ShmLogMeta*>(shm);
+    regions = reinterpret_cast<ShmLogRegion*>(shm + meta->regionOffset);
+    data = reinterpret_cast<const uint8_t*>(shm + meta->dataOffset);
+    ringMask = meta->regionBytes - 1;
+    heads.resize(meta->regionCount);
+    hasHead.resize(meta->regionCount);
+    record.resize(MaxRecordLength + ShmRecordAlignment);
+}
+
+ShmLogDrainer::~ShmLogDrainer() {
+    if (mappedSize != 0) munmap(shm, mappedSize);
+}
+
+std::unique_ptr<ShmLogDrainer> ShmLogDrainer::attach(const std::string& name, std::ostream* os) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0666);
+    if (fd < 0) return nullptr;
+    struct stat stats;
+    if (fstat(fd, &stats) < 0 || static_cast<size_t>(stats.st_size) < sizeof(ShmLogMeta)) {
+        close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(stats.st_size);
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return nullptr;
+
+    const ShmLogMeta* meta = reinterpret_cast<const ShmLogMeta*>(addr);
+    if (meta->magic != ShmLogMagic || meta->metaSize != sizeof(ShmLogMeta) ||
+        meta->dataOffset + meta->regionCount * meta->regionBytes > size) {
+        munmap(addr, size);
+        return nullptr;
+    }
+    return std::unique_ptr<ShmLogDrainer>(new ShmLogDrainer(reinterpret_cast<char*>(addr), os, size));
+}
+
+bool ShmLogDrainer::isProcessAlive(int32_t pid) {
+    if (pid <= 0) return false;
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+bool ShmLogDrainer::claim() {
+    int32_t self = getpid();
+    int32_t holder = meta->drainerPid.load(std::memory_order_acquire);
+    if (holder == self) return true;
+    if (holder != 0 && isProcessAlive(holder)) return false;
+    return meta->drainerPid.compare_exchange_strong(holder, self, std::memory_order_acq_rel);
+}
+
+bool ShmLogDrainer::empty() const {
+    for (uint32_t i = 0; i < meta->regionCount; ++i) {
+        if (regions[i].readPos.load(std::memory_order_relaxed) !=
+            regions[i].writePos.load(std::memory_order_acquire)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ShmLogDrainer::drain(int64_t cutoffNs) {
+    uint32_t regionCount = meta->regionCount;
+    for (uint32_t i = 0; i < regionCount; ++i) hasHead[i] = peekRegion(i, heads[i]);
+
+    int count = 0;
+    while (true) {
+        int best = -1;
+        for (uint32_t i = 0; i < regionCount; ++i) {
+            if (!hasHead[i] || heads[i].tsNs > cutoffNs) continue;
+            if (best < 0 || heads[i].tsNs < heads[best].tsNs) best = static_cast<int>(i);
+        }
+        if (best < 0) break;
+
+        ShmLogRegion& region = regions[best];
+        const ShmRecordHeader& header = heads[best];
+        uint64_t pos = region.readPos.load(std::memory_order_relaxed);
+        copyFromRing(ringOf(best), record.data(), pos + sizeof(header), header.size - sizeof(header));
+        // copy is intact if no writer reservation reached it meanwhile, SOP_DROP_OLDEST only
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (region.reservePos.load(std::memory_order_relaxed) - pos <= meta->regionBytes) {
+            record[header.size - sizeof(header)] = '\0';
+            if (archive != nullptr) archive->append(header, record.data(), best == 0 ? 0 : region.ownerTid, meta);
+            emit(header, record.data());
+            region.readPos.store(pos + alignShmRecord(header.size), std::memory_order_release);
+            ++count;
+        }
+        hasHead[best] = peekRegion(best, heads[best]);
+    }
+
+    if (repeats != 0 && realtimeNs() - lastHeader.tsNs > RepeatFlushNs) flushRepeats();
+    for (uint32_t i = 0; i < regionCount; ++i) {
+        reportLoss(i);
+        ShmLogRegion& region = regions[i];
+        uint32_t expected = SRS_RELEASED;
+        if (region.readPos.load(std::memory_order_relaxed) == region.writePos.load(std::memory_order_acquire)) {
+            region.state.compare_exchange_strong(expected, SRS_FREE);
+        }
+    }
+    return count;
+}
+
+bool ShmLogDrainer::peekRegion(uint32_t index, ShmRecordHeader& header) {
+    ShmLogRegion& region = regions[index];
+    const uint8_t* ring = ringOf(index);
+    uint64_t capacity = meta->regionBytes;
+    while (true) {
+        uint64_t pos = region.readPos.load(std::memory_order_relaxed);
+        uint64_t writePos = region.writePos.load(std::memory_order_acquire);
+        if (pos == writePos) return false;
+
+        uint64_t reservePos = region.reservePos.load(std::memory_order_relaxed);
+        if (reservePos - pos > capacity) {  // lapped by the writer, maybe by a record still being copied in
+            uint64_t next = resync(ring, reservePos - capacity, writePos);
+            meta->lostBytes.fetch_add(next - pos, std::memory_order_relaxed);
+            flushRepeats();
+            *os << time_string() << "[warning]ShmLog lost " << next - pos << " bytes of " << regionName(index)
+                << ", dump is too slow" << '\n';
+            region.readPos.store(next, std::memory_order_release);
+            continue;
+        }
+
+        copyFromRing(ring, &header, pos, sizeof(header));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (region.reservePos.load(std::memory_order_relaxed) - pos > capacity) continue;
+        if (header.commit != pos + 1 || header.size < sizeof(ShmRecordHeader) || header.size > MaxRecordLength) {
+            // not expected below writePos, skip to the next sane record
+            region.readPos.store(resync(ring, pos + ShmRecordAlignment, writePos), std::memory_order_release);
+            continue;
+        }
+        return true;
+    }
+}
+
+void ShmLogDrainer::reportLoss(uint32_t index) {
+    ShmLogRegion& region = regions[index];
+    uint64_t dropped = region.dropped.load(std::memory_order_relaxed);
+    if (dropped == region.reportedDropped) return;
+    meta->droppedRecords.fetch_add(dropped - region.reportedDropped, std::memory_order_relaxed);
+    flushRepeats();
+    *os << time_string() << "[warning]ShmLog dropped " << dropped - region.reportedDropped << " records of "
+        << regionName(index) << ", region full" << '\n';
+    region.reportedDropped = dropped;
+}
+
+void ShmLogDrainer::emit(const ShmRecordHeader& header, const char* payload) {
+    uint32_t length = header.size - static_cast<uint32_t>(sizeof(header));
+    bool collapse = meta->collapseRepeats.load(std::memory_order_relaxed) != 0;
+    if (collapse && hasLast && header.kind == lastHeader.kind && header.priority == lastHeader.priority &&
+        header.siteId == lastHeader.siteId && header.size == lastHeader.size &&
+        memcmp(payload, lastPayload.data(), length) == 0) {
+        ++repeats;
+        lastHeader.tsNs = header.tsNs;
+        return;
+    }
+    flushRepeats();
+    *os << genLogContent(header, payload, meta) << '\n';
+    hasLast = collapse;
+    if (collapse) {
+        lastHeader = header;
+        lastPayload.assign(payload, payload + length + 1);  // with the terminator
+    }
+}
+
+void ShmLogDrainer::flushRepeats() {
+    if (repeats == 0) return;
+    *os << genLogContent(lastHeader, lastPayload.data(), meta) << " [repeated " << repeats << " times]" << '\n';
+    repeats = 0;
+}
+
+std::string ShmLogDrainer::regionName(uint32_t index) const {
+    return index == 0 ? "shared region" : "thread " + std::to_string(regions[index].ownerTid);
+}
+
+uint64_t ShmLogDrainer::resync(const uint8_t* ring, uint64_t from, uint64_t to) const {
+    for (uint64_t pos = alignShmRecord(from); pos < to; pos += ShmRecordAlignment) {
+        if (commitAt(ring, pos) == pos + 1) return pos;
+    }
+    return to;
+}
+
+void ShmLogDrainer::copyFromRing(const uint8_t* ring, void* dst, uint64_t pos, uint32_t length) const {
+    uint64_t offset = pos & ringMask;
+    uint64_t first = std::min<uint64_t>(length, meta->regionBytes - offset);
+    memcpy(dst, ring + offset, first);
+    if (first < length) memcpy(static_cast<uint8_t*>(dst) + first, ring, length - first);
+}
+}  // namespace frenzy
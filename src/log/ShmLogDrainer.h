@@ -0,0 +1,148 @@
+#ifndef CONCURRENT_SHMLOG_DRAINER_H
+#define CONCURRENT_SHMLOG_DRAINER_H
+
+#include <unistd.h>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "log/ShmLog.h"
+#include "log/ShmLogArchive.h"
+
+namespace frenzy {
+
+/**
+ * reader side of a ShmLog segment, dumps all regions merged in timestamp order.
+ * runs as the dump thread inside the logging process, or in shmlogd over a segment attached by name,
+ * which keeps draining after the logging process is gone.
+ */
+class ShmLogDrainer {
+public:
+    // records younger than this wait for the next round, covers a writer preempted between clock read and publish
+    static constexpr int64_t MergeDelayNs = 1000 * 1000;
+    // a run of repeated records is summarized at the latest this long after its last repeat
+    static constexpr int64_t RepeatFlushNs = 1000L * 1000 * 1000;
+
+    /**
+     * drain a segment already mapped by this process
+     */
+    ShmLogDrainer(char* shm_, std::ostream* os_, size_t mappedSize_ = 0);
+
+    ~ShmLogDrainer();
+
+    ShmLogDrainer(const ShmLogDrainer&) = delete;
+    ShmLogDrainer& operator=(const ShmLogDrainer&) = delete;
+
+    /**
+     * map /dev/shm/name if it is a ShmLog segment of this layout version
+     * @return nullptr otherwise
+     */
+    static std::unique_ptr<ShmLogDrainer> attach(const std::string& name, std::ostream* os = &std::cout);
+
+    /**
+     * only one process drains a segment, take the role if nobody alive holds it
+     */
+    bool claim();
+
+    bool isProducerAlive() const { return isProcessAlive(meta->producerPid); }
+
+    // all regions consumed up to their write position
+    bool empty() const;
+
+    ShmLogMeta* getMeta() const { return meta; }
+    void setOutput(std::ostream* os_) { os = os_; }
+
+    // binary copy of every record, kept as they are, before repeats are collapsed. nullptr stops it
+    void setArchive(ShmLogArchiveWriter* archive_) { archive = archive_; }
+
+    /**
+     * dump records up to cutoffNs, later ones wait for the next call
+     * @return number of records
+     */
+    int drain(int64_t cutoffNs);
+
+    // everything written so far, used once the producer is gone
+    int drainAll() {
+        int count = drain(INT64_MAX);
+        flushRepeats();
+        if (archive != nullptr) archive->flush();
+        return count;
+    }
+
+    /**
+     * drain until keepRunning returns false, sleeps 1ms when there is nothing to dump.
+     * output failures and exceptions are reported to stderr, the loop goes on.
+     */
+    template <typename F>
+    void run(F&& keepRunning) {
+        while (keepRunning()) {
+            try {
+                if (drain(realtimeNs() - MergeDelayNs) == 0) {
+                    os->flush();
+                    if (archive != nullptr) archive->flush();
+                    usleep(1000);
+                }
+                if (os->fail()) {
+                    std::cerr << "ShmLog dump output failed, some log lines are lost" << std::endl;
+                    os->clear();
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "ShmLog dump exception: " << e.what() << std::endl;
+                usleep(100 * 1000);
+            }
+        }
+    }
+
+    static int64_t realtimeNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec * 1000000000L + ts.tv_nsec;
+    }
+
+    static bool isProcessAlive(int32_t pid);
+
+private:
+    // head record of a region, false if the region is empty
+    bool peekRegion(uint32_t index, ShmRecordHeader& header);
+    void reportLoss(uint32_t index);
+
+    // write a record, or count it if it repeats the previous one
+    void emit(const ShmRecordHeader& header, const char* payload);
+    // "[repeated N times]" line of the pending run
+    void flushRepeats();
+    std::string regionName(uint32_t index) const;
+
+    // find the next committed record after an overrun, return its position
+    uint64_t resync(const uint8_t* ring, uint64_t from, uint64_t to) const;
+
+    const uint8_t* ringOf(uint32_t index) const { return data + index * meta->regionBytes; }
+    void copyFromRing(const uint8_t* ring, void* dst, uint64_t pos, uint32_t length) const;
+    uint64_t commitAt(const uint8_t* ring, uint64_t pos) const {
+        return reinterpret_cast<const std::atomic<uint64_t>*>(ring + (pos & ringMask))->load(std::memory_order_acquire);
+    }
+
+    char* shm{nullptr};
+    size_t mappedSize{0};  // non zero if attached by name, unmapped on destruction
+    ShmLogMeta* meta{nullptr};
+    ShmLogRegion* regions{nullptr};
+    const uint8_t* data{nullptr};
+    uint64_t ringMask{0};
+    std::ostream* os{&std::cout};
+    ShmLogArchiveWriter* archive{nullptr};
+
+    std::vector<ShmRecordHeader> heads;
+    std::vector<char> hasHead;
+    std::vector<char> record;
+
+    ShmRecordHeader lastHeader{};  // last written record, to detect repeats
+    std::vector<char> lastPayload;
+    bool hasLast{false};
+    uint64_t repeats{0};
+};
+}  // namespace frenzy
+
+#endif
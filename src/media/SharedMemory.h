@@ -1,16 +1,25 @@
 #ifndef CONCURRENT_SHARED_MEMORY_H
 #define CONCURRENT_SHARED_MEMORY_H
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <atomic>
+#include <cerrno>
 #include <cstdint>
 #include <cstring>
+#include <ctime>
 #include <limits>
+#include <new>
 #include <stdexcept>
 #include <string>
+#include <vector>
+#include "utils/FrenzyException.h"
 
 namespace frenzy {
 
@@ -20,7 +29,14 @@ private:
         uint8_t magic[8] = {'M', 'I', 'D', 'A', 'S', 's', 'h', 'm'};
         uint32_t size = 0;
         uint64_t version = 0;
-        uint64_t ownerPid = 0;
+        std::atomic<uint64_t> ownerPid{0};
+        /**
+         * owner lease, owner refreshes heartbeat (CLOCK_MONOTONIC ns) within leaseNs.
+         * heartbeat 0 means owner never joined the lease protocol, only pid liveness is checked.
+         */
+        std::atomic<uint64_t> heartbeat{0};
+        uint64_t leaseNs = 0;
+        uint64_t takeoverCount = 0;  // bumped every time a new owner takes over a stale segment
     };
 
     static constexpr uint32_t PAGE_SIZE{4096};
@@ -29,11 +45,14 @@ private:
     static uint32_t _roundup_pagesize(uint32_t x_) { return (x_ + PAGE_SIZE - 1) & (~(PAGE_SIZE - 1)); }
 
 public:
+    static constexpr uint64_t DefaultLeaseNs{3UL * 1000 * 1000 * 1000};  // for owners which heartbeat
+
     std::string filename;
     Meta *meta{nullptr};
     uint8_t *buffer{nullptr};
     int fd{-1};
     bool isOwner{false};
+    bool isTakeover{false};  // true if created by taking over a stale segment, content is kept
 
 public:
     bool is_valid() const { return meta != nullptr; }
@@ -65,12 +84,133 @@ public:
      */
     static SharedMemory reclaim_shared_memory(const std::string &name_) { return SharedMemory(name_); }
 
+    /**
+     * Create a SharedMemory, or take over a leftover segment whose owner is dead.
+     * On takeover the content is kept and isTakeover is set, e.g. a restarted writer should attach its
+     * CircularBuffer with init_ = false, then it resumes at the write position in the ring meta and
+     * readers keep their mapping.
+     * Throws if the segment is still owned by a live process. the check and the takeover run under flock, so
+     * of several processes restarting at once only the first takes over, the others throw.
+     * @param leaseNs_ 0 keeps the owner out of the lease protocol, only a dead pid is taken over. an owner passing
+     *                 a lease must call heartbeat() more often than that, or it is taken over while alive.
+     */
+    static SharedMemory create_or_takeover_shared_memory(const std::string &name_, uint32_t mapSize,
+                                                         uint64_t leaseNs_ = 0) {
+        int fd_ = shm_open(name_.c_str(), O_RDWR, 0666);
+        if (fd_ < 0) {
+            SharedMemory sm(name_, mapSize, true);
+            sm.start_lease(leaseNs_);
+            return sm;
+        }
+        close(fd_);
+
+        SharedMemory sm = attach_shared_memory(name_);
+        // racing restarts take turns, the first one takes over, the ones after it find a live owner
+        struct Unlock {
+            ~Unlock() { flock(fd, LOCK_UN); }
+            int fd;
+        } unlock{sm.fd};
+        flock(sm.fd, LOCK_EX);
+        if (sm.is_owner_alive()) {
+            THROW_FRENZY_EXCEPTION("shared memory " << name_ << " still owned by pid " << sm.meta->ownerPid.load());
+        }
+        sm.meta->ownerPid.store(static_cast<uint64_t>(getpid()), std::memory_order_release);
+        sm.start_lease(leaseNs_);
+        if (sm.capacity() < _roundup_pagesize(mapSize)) {  // layout changed, start over
+            shm_unlink(name_.c_str());
+            SharedMemory fresh(name_, mapSize, true);
+            fresh.start_lease(leaseNs_);
+            return fresh;
+        }
+        sm.isOwner = true;
+        sm.isTakeover = true;
+        ++sm.meta->takeoverCount;
+        return sm;
+    }
+
+    /**
+     * Owner joins the lease protocol, then it must call heartbeat() more often than leaseNs_, 0 leaves it
+     */
+    void start_lease(uint64_t leaseNs_ = DefaultLeaseNs) {
+        meta->leaseNs = leaseNs_;
+        if (leaseNs_ != 0) {
+            heartbeat();
+        } else {
+            meta->heartbeat.store(0, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Owner refreshes its lease, cheap enough for the main loop, one clock read and one store
+     */
+    void heartbeat() { meta->heartbeat.store(monotonic_ns(), std::memory_order_release); }
+
+    /**
+     * attacher side check, false if the owner process is gone or stops refreshing its lease,
+     * readers should stop trusting the data then.
+     */
+    bool is_owner_alive() const { return is_meta_alive(*meta); }
+
+    /**
+     * same as ztool::CheckProcessAlive but without reaping children, a library should not steal exit status.
+     * EPERM means the process exists under another user.
+     */
+    static bool is_process_alive(uint64_t pid_) {
+        if (pid_ == 0) return false;
+        return kill(static_cast<pid_t>(pid_), 0) == 0 || errno == EPERM;
+    }
+
+    /**
+     * List segments under dir_ with our magic whose owner joined the lease protocol and is dead.
+     * segments without a lease are left alone, their pid may be alive in another pid namespace.
+     * @return shm names, which could be passed to shm_unlink directly
+     */
+    static std::vector<std::string> list_stale_shared_memory(const std::string &dir_ = "/dev/shm") {
+        std::vector<std::string> ret;
+        DIR *dir = opendir(dir_.c_str());
+        if (dir == nullptr) return ret;
+        while (struct dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+            std::string path = dir_ + "/" + entry->d_name;
+            int fd_ = ::open(path.c_str(), O_RDONLY);
+            if (fd_ < 0) continue;
+            Meta copy;
+            Meta dummy;
+            bool stale = false;
+            if (::pread(fd_, static_cast<void *>(&copy), sizeof(Meta), 0) == sizeof(Meta) &&
+                memcmp(copy.magic, dummy.magic, sizeof(dummy.magic)) == 0 && copy.leaseNs != 0) {
+                stale = !is_meta_alive(copy);
+            }
+            close(fd_);
+            if (stale) ret.push_back(entry->d_name);
+        }
+        closedir(dir);
+        return ret;
+    }
+
+    /**
+     * Unlink all stale segments found by list_stale_shared_memory
+     * @return number of segments removed
+     */
+    static size_t reap_stale_shared_memory(const std::string &dir_ = "/dev/shm") {
+        size_t count = 0;
+        for (const auto &name : list_stale_shared_memory(dir_)) {
+            if (shm_unlink(name.c_str()) == 0) ++count;
+        }
+        return count;
+    }
+
     ~SharedMemory() { _unmap(); }
 
     SharedMemory(const SharedMemory &) = delete;
 
     SharedMemory(SharedMemory &&sm_)
-        : filename{sm_.filename}, meta{sm_.meta}, buffer{sm_.buffer}, fd{sm_.fd}, isOwner{sm_.isOwner} {
+        : filename{sm_.filename},
+          meta{sm_.meta},
+          buffer{sm_.buffer},
+          fd{sm_.fd},
+          isOwner{sm_.isOwner},
+          isTakeover{sm_.isTakeover} {
         sm_.meta = nullptr;
         sm_.buffer = nullptr;
         sm_.fd = -1;
@@ -86,6 +226,7 @@ public:
         buffer = rhs_.buffer;
         fd = rhs_.fd;
         isOwner = rhs_.isOwner;
+        isTakeover = rhs_.isTakeover;
         rhs_.meta = nullptr;
         rhs_.buffer = nullptr;
         rhs_.fd = -1;
@@ -94,6 +235,20 @@ public:
     }
 
 private:
+    static uint64_t monotonic_ns() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000UL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    static bool is_meta_alive(const Meta &meta_) {
+        if (!is_process_alive(meta_.ownerPid.load(std::memory_order_acquire))) return false;
+        uint64_t hb = meta_.heartbeat.load(std::memory_order_acquire);
+        if (hb == 0 || meta_.leaseNs == 0) return true;
+        uint64_t now = monotonic_ns();
+        return now < hb || now - hb <= meta_.leaseNs;
+    }
+
     uint8_t *_map(uint32_t mapSize, bool create_) {
         int fd_ = -1;
         mapSize = _roundup_pagesize(mapSize);
@@ -141,9 +296,9 @@ private:
         Meta dummy;
         if (create_) {
             memset(addr, 0, size);
-            dummy.size = mapSize;
-            dummy.ownerPid = static_cast<uint64_t>(getpid());
-            *meta = dummy;
+            new (addr) Meta;
+            meta->size = mapSize;
+            meta->ownerPid.store(static_cast<uint64_t>(getpid()), std::memory_order_release);
         } else {
             if (memcmp(meta->magic, &dummy.magic, sizeof(dummy.magic)) != 0) {
                 THROW_FRENZY_EXCEPTION("unexpected magic: " << std::string((char *)meta->magic, sizeof(dummy.magic)));
@@ -172,7 +327,8 @@ private:
 
     SharedMemory(const std::string &name_) : filename{name_}, isOwner{true} {
         buffer = _map(0, false);
-        meta->ownerPid = static_cast<uint64_t>(getpid());
+        meta->ownerPid.store(static_cast<uint64_t>(getpid()), std::memory_order_release);
+        if (meta->leaseNs != 0) heartbeat();
     }
 };
 }  // namespace frenzy
@@ -0,0 +1,250 @@
+#ifndef CONCURRENT_SHM_ARENA_H
+#define CONCURRENT_SHM_ARENA_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include "container/CircularBuffer.h"
+#include "media/HeapMemory.h"
+#include "media/SharedMemory.h"
+#include "utils/FrenzyException.h"
+
+namespace frenzy {
+
+/**
+ * named typed regions inside one SharedMemory segment, one shm_open and one mmap for all IPC objects.
+ * offset based bump allocator, regions live as long as the segment, there is no free.
+ * directory lookups are lock free, creation is serialized by a spin lock in the shared header.
+ * the lock and each region under construction record the pid working on them: a process dying with the lock
+ * held loses it to the next creator, a region it left half constructed is constructed again by the next
+ * find_or_create, find throws for it.
+ */
+class ShmArena {
+private:
+    static constexpr uint32_t ArenaMagic = 0xA7E4A001;
+    static constexpr uint32_t MaxNameLength = 48;
+    static constexpr uint64_t DefaultAlignment = 64;
+    static constexpr uint32_t AliveCheckSpins = 1024;  // spins between two liveness checks of a lock or region
+
+    struct Entry {
+        char name[MaxNameLength];
+        uint64_t offset;                // relative to the arena header
+        uint64_t size;                  // in bytes
+        uint64_t typeTag;               // sizeof and alignof of the element, catches layout mismatch
+        std::atomic<uint32_t> ready;    // set after the creator finishes construction
+        uint32_t count;                 // element count for arrays, 1 otherwise
+        std::atomic<uint32_t> creator;  // pid constructing the region
+    };
+
+    struct alignas(64) Header {
+        uint32_t magic{ArenaMagic};
+        uint32_t maxEntries{0};
+        uint64_t capacity{0};              // bytes of the whole arena, header included
+        uint64_t dataOffset{0};            // first byte after directory
+        std::atomic<uint32_t> lock;        // pid of the creator holding it, 0 if free
+        std::atomic<uint32_t> entryCount;  // published entries
+        std::atomic<uint64_t> cursor;      // next free offset
+    };
+
+    SharedMemory space;
+    Header *header{nullptr};
+    Entry *entries{nullptr};
+
+public:
+    /**
+     * @param init_ true for the side which formats the arena, usually the creator of the SharedMemory
+     */
+    ShmArena(SharedMemory &&space_, bool init_, uint32_t maxEntries_ = 1024) : space{std::move(space_)} {
+        uint8_t *base = space.buffer;
+        header = reinterpret_cast<Header *>(base);
+        if (init_) {
+            uint64_t dataOffset = align(sizeof(Header) + maxEntries_ * sizeof(Entry), DefaultAlignment);
+            if (dataOffset >= space.capacity()) THROW_FRENZY_EXCEPTION("ShmArena: Insufficient space.");
+            memset(base, 0, dataOffset);
+            header = new (base) Header;
+            header->maxEntries = maxEntries_;
+            header->capacity = space.capacity();
+            header->dataOffset = dataOffset;
+            header->lock.store(0, std::memory_order_relaxed);
+            header->entryCount.store(0, std::memory_order_relaxed);
+            header->cursor.store(dataOffset, std::memory_order_release);
+        } else if (header->magic != ArenaMagic) {
+            THROW_FRENZY_EXCEPTION("ShmArena: Magic number mismatch.");
+        }
+        entries = reinterpret_cast<Entry *>(base + sizeof(Header));
+    }
+
+    static ShmArena create(const std::string &name_, uint32_t size_, uint32_t maxEntries_ = 1024) {
+        return ShmArena(SharedMemory::create_shared_memory(name_, size_), true, maxEntries_);
+    }
+
+    static ShmArena attach(const std::string &name_) {
+        return ShmArena(SharedMemory::attach_shared_memory(name_), false);
+    }
+
+    ShmArena(ShmArena &&) = default;
+    ShmArena(const ShmArena &) = delete;
+    ShmArena &operator=(const ShmArena &) = delete;
+
+    SharedMemory &shared_memory() { return space; }
+    uint64_t capacity() const { return header->capacity; }
+    uint64_t used() const { return header->cursor.load(std::memory_order_acquire); }
+    uint32_t entry_count() const { return header->entryCount.load(std::memory_order_acquire); }
+
+    /**
+     * Find a region by name, waits if its creator is still constructing it
+     * @return nullptr if not found
+     */
+    void *find(const std::string &name_, uint64_t *size_ = nullptr) const {
+        const Entry *e = lookup(name_);
+        if (e == nullptr) return nullptr;
+        if (!wait_ready(*e)) THROW_FRENZY_EXCEPTION("ShmArena: creator of region " << name_ << " died.");
+        if (size_) *size_ = e->size;
+        return address(e->offset);
+    }
+
+    /**
+     * Find a T by name, or construct it with args_ if not there yet
+     */
+    template <typename T, typename... Args>
+    T *find_or_create(const std::string &name_, Args &&... args_) {
+        void *p = acquire(name_, sizeof(T), alignof(T), type_tag<T>(), 1,
+                          [&](void *addr_) { new (addr_) T(std::forward<Args>(args_)...); });
+        return reinterpret_cast<T *>(p);
+    }
+
+    /**
+     * Find a fixed array of count_ value-initialized T by name, or create it
+     */
+    template <typename T>
+    T *find_or_create_array(const std::string &name_, uint32_t count_) {
+        void *p = acquire(name_, sizeof(T) * count_, alignof(T), type_tag<T>(), count_, [&](void *addr_) {
+            T *arr = reinterpret_cast<T *>(addr_);
+            for (uint32_t i = 0; i < count_; ++i) new (arr + i) T();
+        });
+        return reinterpret_cast<T *>(p);
+    }
+
+    /**
+     * Place a CircularBuffer of bytes_ inside the arena, the first caller formats the ring meta
+     */
+    template <typename Element = uint8_t, typename Traits = FlatStructTraits<Element>>
+    CircularBuffer<HeapMemory, Element, Traits> find_or_create_circular_buffer(const std::string &name_,
+                                                                               uint32_t bytes_) {
+        void *p = acquire(name_, bytes_, DefaultAlignment, bytes_, 1, [&](void *addr_) {
+            CircularBuffer<HeapMemory, Element, Traits> rb{HeapMemory{reinterpret_cast<uint8_t *>(addr_), bytes_},
+                                                           true};
+        });
+        return CircularBuffer<HeapMemory, Element, Traits>{HeapMemory{reinterpret_cast<uint8_t *>(p), bytes_},
+                                                           false};
+    }
+
+    /**
+     * names of all regions, for tooling
+     */
+    std::vector<std::string> names() const {
+        std::vector<std::string> ret;
+        uint32_t n = entry_count();
+        for (uint32_t i = 0; i < n; ++i) ret.emplace_back(entries[i].name);
+        return ret;
+    }
+
+private:
+    static uint64_t align(uint64_t x_, uint64_t a_) { return (x_ + a_ - 1) & ~(a_ - 1); }
+
+    template <typename T>
+    static uint64_t type_tag() {
+        return (static_cast<uint64_t>(sizeof(T)) << 16) | alignof(T);
+    }
+
+    void *address(uint64_t offset_) const { return reinterpret_cast<uint8_t *>(header) + offset_; }
+
+    Entry *lookup(const std::string &name_) const {
+        uint32_t n = header->entryCount.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < n; ++i) {
+            if (strncmp(entries[i].name, name_.c_str(), MaxNameLength) == 0) return &entries[i];
+        }
+        return nullptr;
+    }
+
+    static uint32_t self() { return static_cast<uint32_t>(getpid()); }
+
+    // false if the creator died before the region got ready
+    static bool wait_ready(const Entry &e_) {
+        for (uint32_t i = 1; e_.ready.load(std::memory_order_acquire) == 0; ++i) {
+            if (i % AliveCheckSpins == 0 && !SharedMemory::is_process_alive(e_.creator.load(std::memory_order_relaxed)))
+                return e_.ready.load(std::memory_order_acquire) != 0;
+            asm volatile("pause" ::: "memory");
+        }
+        return true;
+    }
+
+    // a dead holder's lock is taken over, the directory entry it was writing is not published yet
+    void lock() {
+        uint32_t holder = 0;
+        for (uint32_t i = 1; !header->lock.compare_exchange_weak(holder, self(), std::memory_order_acquire,
+                                                                 std::memory_order_relaxed);
+             ++i) {
+            if (holder != 0 && i % AliveCheckSpins == 0 && !SharedMemory::is_process_alive(holder)) continue;
+            holder = 0;
+            asm volatile("pause" ::: "memory");
+        }
+    }
+
+    void unlock() { header->lock.store(0, std::memory_order_release); }
+
+    template <typename Init>
+    void *acquire(const std::string &name_, uint64_t size_, uint64_t align_, uint64_t tag_, uint32_t count_,
+                  Init &&init_) {
+        if (name_.empty() || name_.size() >= MaxNameLength)
+            THROW_FRENZY_EXCEPTION("ShmArena: invalid region name " << name_);
+
+        lock();
+        Entry *found = lookup(name_);
+        if (found != nullptr) {
+            unlock();
+            if (found->typeTag != tag_ || found->count != count_)
+                THROW_FRENZY_EXCEPTION("ShmArena: region " << name_ << " type mismatch.");
+            void *addr = address(found->offset);
+            while (!wait_ready(*found)) {
+                uint32_t dead = found->creator.load(std::memory_order_relaxed);
+                if (found->creator.compare_exchange_strong(dead, self(), std::memory_order_acq_rel)) {
+                    init_(addr);  // its creator died half way, construct it again
+                    found->ready.store(1, std::memory_order_release);
+                }
+            }
+            return addr;
+        }
+
+        uint32_t n = header->entryCount.load(std::memory_order_relaxed);
+        uint64_t offset = align(header->cursor.load(std::memory_order_relaxed), std::max(align_, DefaultAlignment));
+        if (n >= header->maxEntries || offset + size_ > header->capacity) {
+            unlock();
+            THROW_FRENZY_EXCEPTION("ShmArena: out of space for " << name_ << ", size " << size_);
+        }
+        Entry &e = entries[n];
+        strncpy(e.name, name_.c_str(), MaxNameLength - 1);
+        e.offset = offset;
+        e.size = size_;
+        e.typeTag = tag_;
+        e.count = count_;
+        e.ready.store(0, std::memory_order_relaxed);
+        e.creator.store(self(), std::memory_order_relaxed);
+        header->cursor.store(offset + size_, std::memory_order_relaxed);
+        header->entryCount.store(n + 1, std::memory_order_release);  // publish entry, not ready yet
+        unlock();
+
+        void *addr = address(offset);
+        init_(addr);  // construct outside the lock, finders spin on ready
+        e.ready.store(1, std::memory_order_release);
+        return addr;
+    }
+};
+}  // namespace frenzy
+
+#endif
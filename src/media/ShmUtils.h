@@ -18,7 +18,7 @@ constexpr uint32_t META_SIZE{PAGE_SIZE};
 
 inline uint32_t _roundup_pagesize(uint32_t x_) { return (x_ + PAGE_SIZE - 1) & (~(PAGE_SIZE - 1)); }
 
-void* create_mmap(const std::string& fileName, size_t& mapSize) {
+inline void* create_mmap(const std::string& fileName, size_t& mapSize) {
     int fd = -1;
     mapSize = _roundup_pagesize(static_cast<uint32_t>(mapSize));
     fd = shm_open(fileName.c_str(), O_CREAT | O_RDWR, 0666);
@@ -55,15 +55,17 @@ void* create_mmap(const std::string& fileName, size_t& mapSize) {
         std::cerr << "mmap: " << strerror(errno) << std::endl;
         return nullptr;
     }
+    close(fd);  // the mapping stays valid
     return addr;
 }
 
-void* create_mmap_with_meta(const std::string& fileName, size_t& mapSize) {
+inline void* create_mmap_with_meta(const std::string& fileName, size_t& mapSize) {
     mapSize += META_SIZE;
     return create_mmap(fileName, mapSize);
 }
 
-void* attach_mmap(const std::string& fileName, size_t& mapSize) {
+// mapSize 0 maps the whole file, mapSize is set to the bytes mapped
+inline void* attach_mmap(const std::string& fileName, size_t& mapSize) {
     int fd = -1;
     mapSize = _roundup_pagesize(static_cast<uint32_t>(mapSize));
     fd = shm_open(fileName.c_str(), O_RDWR, 0666);
@@ -86,11 +88,14 @@ void* attach_mmap(const std::string& fileName, size_t& mapSize) {
     if (addr == MAP_FAILED) {
         close(fd);
         std::cerr << "mmap: " << strerror(errno) << std::endl;
+        return addr;
     }
+    close(fd);
+    mapSize = size;
     return addr;
 }
 
-void* attach_mmap_with_meta(const std::string& fileName, size_t& mapSize) {
+inline void* attach_mmap_with_meta(const std::string& fileName, size_t& mapSize) {
     mapSize += META_SIZE;
     return attach_mmap(fileName, mapSize);
 }
@@ -1,36 +1,268 @@
 #ifndef CONCURRENT_ACTIVE_H
 #define CONCURRENT_ACTIVE_H
 
-#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
-#include "ConcurrentQueue.h"
+#include <vector>
+#include "allocator/SlabPool.h"
+#include "lockfree/MpmcBoundedQueue.h"
+#include "thread/Task.h"
+#include "utils/CpuTopology.h"
+#include "utils/Futex.h"
 
 namespace frenzy {
 
-class Active {
+struct ActiveOptions {
+    int cpu{-1};            // pin the worker to this cpu, -1 leaves it to the os
+    size_t batch{64};       // tasks run per visit of the mailbox
+    size_t capacity{4096};  // slots of a BoundedMailbox, submit blocks while they are all taken
+};
+
+/**
+ * mailboxes of BasicActive, any number of producers and the worker as the single consumer.
+ * push and try_push take a task, consume runs up to max_ of them in order through run_ and returns how many.
+ */
+
+// lock free linked list, unbounded, nodes come from a SlabPool so a submit does not malloc in steady state
+class MpscMailbox {
+public:
+    explicit MpscMailbox(const ActiveOptions &) {}
+
+    MpscMailbox(const MpscMailbox &) = delete;
+    MpscMailbox &operator=(const MpscMailbox &) = delete;
+
+    ~MpscMailbox() {
+        while (Node *next = head_->next.load(std::memory_order_acquire)) {
+            release(head_);
+            head_ = next;
+            head_->task.reset();
+        }
+        release(head_);
+    }
+
+    void push(Task &&task_) {
+        Node *node = new (Pool::allocate()) Node;
+        node->task = std::move(task_);
+        Node *prev = tail_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool try_push(Task &task_) {
+        push(std::move(task_));
+        return true;
+    }
+
+    // a push between its exchange and its link is seen by the next call
+    template <typename F>
+    size_t consume(size_t max_, F &&run_) {
+        size_t n = 0;
+        for (; n < max_; ++n) {
+            Node *next = head_->next.load(std::memory_order_acquire);
+            if (next == nullptr) break;
+            release(head_);
+            head_ = next;  // the new head is the stub, its task runs and is dropped in place
+            run_(next->task);
+            next->task.reset();
+        }
+        return n;
+    }
+
 private:
-    ConcurrentQueue<std::function<void()>> queue_;
-    std::thread worker_;
-    bool done_;
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        Task task;
+    };
+    using Pool = SlabPool<sizeof(Node)>;
+
+    void release(Node *node_) {
+        if (node_ == &stub_) return;
+        node_->~Node();
+        Pool::deallocate(node_);
+    }
+
+    Node stub_;
+    alignas(64) std::atomic<Node *> tail_{&stub_};
+    alignas(64) Node *head_{&stub_};
+};
+
+// ring of ActiveOptions::capacity tasks, a full ring is back pressure: submit waits, try_submit fails
+class BoundedMailbox {
+public:
+    explicit BoundedMailbox(const ActiveOptions &options_) : ring_{options_.capacity} {}
+
+    void push(Task &&task_) {
+        for (int i = 0; !ring_.try_push(std::move(task_)); ++i) {
+            if (i < 64) {
+                asm volatile("pause" ::: "memory");
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool try_push(Task &task_) { return ring_.try_push(std::move(task_)); }  // task_ is kept on failure
+
+    template <typename F>
+    size_t consume(size_t max_, F &&run_) {
+        size_t n = 0;
+        Task task;
+        for (; n < max_ && ring_.try_pop(task); ++n) {
+            run_(task);
+            task.reset();
+        }
+        return n;
+    }
 
 private:
-    Active(const Active&) = delete;
-    Active& operator=(const Active&) = delete;
+    MpmcBoundedQueue<Task> ring_;
+};
 
+// vector behind a mutex, unbounded. the worker swaps the whole vector out, one lock per batch
+class LockedMailbox {
 public:
-    Active() : done_{false} {
-        worker_ = std::thread([this] {
-            while (!done_) queue_.pop()();
+    explicit LockedMailbox(const ActiveOptions &) {}
+
+    void push(Task &&task_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(task_));
+    }
+
+    bool try_push(Task &task_) {
+        push(std::move(task_));
+        return true;
+    }
+
+    template <typename F>
+    size_t consume(size_t max_, F &&run_) {
+        if (next_ == batch_.size()) {
+            batch_.clear();
+            next_ = 0;
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch_.swap(queue_);
+        }
+        size_t n = 0;
+        for (; n < max_ && next_ < batch_.size(); ++n) {
+            Task task = std::move(batch_[next_++]);
+            run_(task);
+        }
+        return n;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Task> queue_;
+    std::vector<Task> batch_;  // worker only
+    size_t next_{0};
+};
+
+/**
+ * active object: tasks submitted from any thread run one after another on a worker thread of its own.
+ * the worker runs tasks in batches, spins a while when the mailbox runs empty, then parks on a futex,
+ * submitters wake it only if it is parked. an exception thrown by a task is printed to stderr.
+ * stop(), also called by the destructor, runs every task submitted before it, then joins the worker.
+ * a submit racing with stop() either runs, throws, or stays queued and is destroyed with the Active.
+ */
+template <typename Mailbox = MpscMailbox>
+class BasicActive {
+public:
+    static constexpr int SpinCount = 256;
+
+    explicit BasicActive(const ActiveOptions &options_ = {})
+        : batch_{options_.batch > 0 ? options_.batch : 1}, mailbox_{options_} {
+        worker_ = std::thread([this, cpu = options_.cpu] {
+            if (cpu >= 0 && !pin_current_thread(cpu)) fprintf(stderr, "Active can not pin worker to cpu %d\n", cpu);
+            work();
         });
     }
 
-    ~Active() {
-        queue_.push([this] { done_ = true; });
-        worker_.join();
+    BasicActive(const BasicActive &) = delete;
+    BasicActive &operator=(const BasicActive &) = delete;
+
+    ~BasicActive() { stop(); }
+
+    // waits while a bounded mailbox is full
+    void submit(Task task_) {
+        if (stopping_.load(std::memory_order_relaxed)) throw std::runtime_error("submit on stopped Active");
+        mailbox_.push(std::move(task_));
+        notify();
     }
 
-    void submit(std::function<void()> callback_) { queue_.push(callback_); }
+    // false if the mailbox is full or the Active stopped, task_ is left untouched then
+    bool try_submit(Task &task_) {
+        if (stopping_.load(std::memory_order_relaxed) || !mailbox_.try_push(task_)) return false;
+        notify();
+        return true;
+    }
+
+    // from one thread. from a task it only stops taking submits, the destructor joins
+    void stop() {
+        if (!stopping_.exchange(true, std::memory_order_acq_rel)) {
+            epoch_.fetch_add(1, std::memory_order_release);
+            futex_wake(&epoch_, 1, false);
+        }
+        if (worker_.joinable() && std::this_thread::get_id() != worker_.get_id()) worker_.join();
+    }
+
+    std::thread::id worker_id() const { return worker_.get_id(); }
+
+private:
+    static void run(Task &task_) {
+        try {
+            task_();
+        } catch (const std::exception &e) {
+            fprintf(stderr, "Active task exception: %s\n", e.what());
+        } catch (...) {
+            fprintf(stderr, "Active task exception\n");
+        }
+    }
+
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the fence in work
+        // the first submitter to see the worker parked wakes it, the others skip the syscall
+        if (sleeping_.load(std::memory_order_relaxed) != 0 && sleeping_.exchange(0, std::memory_order_relaxed) != 0) {
+            epoch_.fetch_add(1, std::memory_order_release);
+            futex_wake(&epoch_, 1, false);
+        }
+    }
+
+    void work() {
+        while (true) {
+            if (mailbox_.consume(batch_, run) > 0) continue;
+            bool found = false;
+            for (int i = 0; i < SpinCount && !found; ++i) {
+                asm volatile("pause" ::: "memory");
+                found = mailbox_.consume(batch_, run) > 0;
+            }
+            if (found) continue;
+            if (stopping_.load(std::memory_order_acquire)) {
+                while (mailbox_.consume(batch_, run) > 0) {
+                }
+                return;
+            }
+            uint32_t seen = epoch_.load(std::memory_order_acquire);
+            sleeping_.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (mailbox_.consume(batch_, run) == 0 && !stopping_.load(std::memory_order_acquire)) {
+                futex_wait(&epoch_, seen, -1, false);  // a submit after the check bumps epoch first
+            }
+            sleeping_.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    const size_t batch_;
+    Mailbox mailbox_;
+    std::thread worker_;
+    std::atomic<bool> stopping_{false};
+    alignas(64) std::atomic<uint32_t> epoch_{0};
+    std::atomic<uint32_t> sleeping_{0};
 };
+
+using Active = BasicActive<>;
 }  // namespace frenzy
 
 #endif
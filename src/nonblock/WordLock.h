@@ -3,6 +3,7 @@
 
 #include <x86intrin.h>
 #include <cstdint>
+#include "utils/TscClock.h"
 
 namespace frenzy {
 /**
@@ -11,7 +12,7 @@ namespace frenzy {
  */
 class WordLock {
 public:
-    const static uint32_t updateTimeoutTSC = 5000;
+    const static uint32_t updateTimeoutNs = 2000;
     const static uint32_t LockMetaOffset = 12;
 
     struct MetaT {
@@ -32,6 +33,8 @@ public:
         auto metaTarget = reinterpret_cast<MetaT *>(&target);
 
         bool timeout = false;
+        // no calibration spin nor calibrator attach on the first lock of a process
+        const uint64_t updateTimeoutTSC = TscClock::approx_ns_to_ticks(updateTimeoutNs);
         const uint64_t baseTsc = __rdtsc();  // read time stamp counter
         uint64_t nowTsc = baseTsc;
         do {
@@ -0,0 +1,205 @@
+#ifndef CONCURRENT_FUTURE_H
+#define CONCURRENT_FUTURE_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "allocator/SlabPool.h"
+#include "utils/Futex.h"
+
+namespace frenzy {
+
+/**
+ * one shot result shared by a Promise and a Future, T may be void.
+ * the state is one reference counted block from a SlabPool, waiters spin a little then sleep on a futex.
+ */
+template <typename T>
+class FutureState {
+public:
+    using Value = typename std::conditional<std::is_void<T>::value, char, T>::type;
+
+    static FutureState *create() {
+        if constexpr (pooled()) {
+            return new (SlabPool<BlockSize>::allocate()) FutureState;
+        } else {
+            return new FutureState;
+        }
+    }
+
+    void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        if constexpr (pooled()) {
+            this->~FutureState();
+            SlabPool<BlockSize>::deallocate(this);
+        } else {
+            delete this;
+        }
+    }
+
+    template <typename... V>
+    void set_value(V &&... v_) {
+        new (&storage) Value(std::forward<V>(v_)...);
+        publish(Ready);
+    }
+
+    void set_exception(std::exception_ptr e_) {
+        error = std::move(e_);
+        publish(Failed);
+    }
+
+    bool ready() const { return status.load(std::memory_order_acquire) >= Ready; }
+
+    void wait() {
+        for (int i = 0; i < 64; ++i) {
+            if (ready()) return;
+            asm volatile("pause" ::: "memory");
+        }
+        uint32_t s = status.load(std::memory_order_acquire);
+        while (s < Ready) {
+            if (s == Empty && !status.compare_exchange_weak(s, Waiting, std::memory_order_acquire)) continue;
+            futex_wait(&status, Waiting, -1, false);
+            s = status.load(std::memory_order_acquire);
+        }
+    }
+
+    T get() {
+        wait();
+        if (status.load(std::memory_order_relaxed) == Failed) std::rethrow_exception(error);
+        if constexpr (!std::is_void<T>::value) return std::move(*std::launder(reinterpret_cast<T *>(&storage)));
+    }
+
+private:
+    enum : uint32_t { Empty, Waiting, Ready, Failed };
+
+    static constexpr std::size_t BlockSize = 64 * ((sizeof(std::atomic<uint32_t>) * 2 + sizeof(std::exception_ptr) +
+                                                    sizeof(Value) + alignof(Value) + 63) / 64);
+
+    static constexpr bool pooled() { return BlockSize <= 256 && alignof(Value) <= alignof(std::max_align_t); }
+
+    FutureState() = default;
+
+    ~FutureState() {
+        if (status.load(std::memory_order_relaxed) == Ready) reinterpret_cast<Value *>(&storage)->~Value();
+    }
+
+    void publish(uint32_t s_) {
+        if (status.exchange(s_, std::memory_order_release) == Waiting) futex_wake(&status, INT32_MAX, false);
+    }
+
+    std::atomic<uint32_t> refs{1};  // the promise, and the future once taken
+    std::atomic<uint32_t> status{Empty};
+    std::exception_ptr error;
+    typename std::aligned_storage<sizeof(Value), alignof(Value)>::type storage;
+};
+
+/**
+ * lighter std::future, get() once, no shared_future
+ */
+template <typename T>
+class Future {
+public:
+    Future() noexcept = default;
+
+    explicit Future(FutureState<T> *state_) noexcept : state{state_} {}
+
+    Future(Future &&other_) noexcept : state{other_.state} { other_.state = nullptr; }
+
+    Future &operator=(Future &&other_) noexcept {
+        if (this != &other_) {
+            if (state != nullptr) state->release();
+            state = other_.state;
+            other_.state = nullptr;
+        }
+        return *this;
+    }
+
+    ~Future() {
+        if (state != nullptr) state->release();
+    }
+
+    bool valid() const noexcept { return state != nullptr; }
+
+    bool ready() const { return state->ready(); }
+
+    void wait() const { state->wait(); }
+
+    // waits, returns the value or rethrows the exception of the task, the future is invalid afterwards
+    T get() {
+        std::unique_ptr<FutureState<T>, Release> hold{state};
+        state = nullptr;
+        return hold->get();
+    }
+
+private:
+    struct Release {
+        void operator()(FutureState<T> *s_) const { s_->release(); }
+    };
+
+    FutureState<T> *state{nullptr};
+};
+
+/**
+ * the writing end, a promise dropped without a result breaks it, get() then throws std::future_error
+ */
+template <typename T>
+class Promise {
+public:
+    Promise() : state{FutureState<T>::create()} {}
+
+    Promise(Promise &&other_) noexcept : state{other_.state} { other_.state = nullptr; }
+
+    Promise &operator=(Promise &&) = delete;
+
+    ~Promise() {
+        if (state == nullptr) return;
+        state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        state->release();
+    }
+
+    // once only, before any set_value
+    Future<T> get_future() {
+        state->retain();
+        return Future<T>{state};
+    }
+
+    template <typename... V>
+    void set_value(V &&... v_) {
+        state->set_value(std::forward<V>(v_)...);
+        state->release();
+        state = nullptr;
+    }
+
+    void set_exception(std::exception_ptr e_) {
+        state->set_exception(std::move(e_));
+        state->release();
+        state = nullptr;
+    }
+
+    // runs f_ and stores what it returns or throws
+    template <typename F>
+    void run(F &f_) {
+        try {
+            if constexpr (std::is_void<T>::value) {
+                f_();
+                set_value();
+            } else {
+                set_value(f_());
+            }
+        } catch (...) {
+            set_exception(std::current_exception());
+        }
+    }
+
+private:
+    FutureState<T> *state;
+};
+}  // namespace frenzy
+
+#endif
@@ -3,16 +3,20 @@
 
 #include <condition_variable>
 #include <functional>
-#include <future>
+#include <iostream>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <stdexcept>
 #include <thread>
 #include <vector>
+#include "thread/Future.h"
+#include "thread/Task.h"
+#include "utils/CpuTopology.h"
 
 namespace frenzy {
 
+// one locked queue for all workers, TaskScheduler scales better for small or recursively spawned tasks
 class SimpleThreadPool {
 public:
     explicit SimpleThreadPool(size_t threads) : thread_count{threads} {}
@@ -28,31 +32,44 @@ public:
         for (std::thread &worker : workers) worker.join();
     }
 
+    // the future state comes from a slab, a small callable is stored inside the Task, no allocation per call
     template <class F, class... Args>
-    auto enqueue(F &&f, Args &&... args) -> std::future<typename std::result_of<F(Args...)>::type> {
+    auto enqueue(F &&f, Args &&... args) -> Future<typename std::result_of<F(Args...)>::type> {
         using return_type = typename std::result_of<F(Args...)>::type;
 
-        auto task = std::make_shared<std::packaged_task<return_type()> >(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        Promise<return_type> promise;
+        Future<return_type> res = promise.get_future();
+        if constexpr (sizeof...(Args) == 0) {
+            post([promise = std::move(promise), f = std::forward<F>(f)]() mutable { promise.run(f); });
+        } else {
+            auto bound = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+            post([promise = std::move(promise), bound = std::move(bound)]() mutable { promise.run(bound); });
+        }
+        return res;
+    }
 
-        std::future<return_type> res = task->get_future();
+    // fire and forget, no future, an exception thrown by the task is printed to stderr
+    void post(Task task) {
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
 
             // don't allow enqueueing after stopping the pool
             if (stop) throw std::runtime_error("enqueue on stopped SimpleThreadPool");
 
-            tasks.emplace([task]() { (*task)(); });
+            tasks.push(std::move(task));
         }
         condition.notify_one();
-        return res;
     }
 
-    void start() {
+    // cpus_ pins worker i to cpus_[i % size], see CpuTopology::placement
+    void start(const std::vector<int> &cpus_ = {}) {
         for (size_t i = 0; i < thread_count; ++i)
-            workers.emplace_back([this] {
+            workers.emplace_back([this, cpu = cpus_.empty() ? -1 : cpus_[i % cpus_.size()]] {
+                if (cpu >= 0 && !pin_current_thread(cpu)) {
+                    std::cerr << "SimpleThreadPool can not pin a worker to cpu " << cpu << std::endl;
+                }
                 for (;;) {
-                    std::function<void()> task;
+                    Task task;
 
                     {
                         std::unique_lock<std::mutex> lock(this->queue_mutex);
@@ -63,7 +80,13 @@ public:
                         this->tasks.pop();
                     }
 
-                    task();
+                    try {
+                        task();
+                    } catch (const std::exception &e) {  // only posted tasks throw, enqueue keeps it in the future
+                        std::cerr << "SimpleThreadPool task exception: " << e.what() << std::endl;
+                    } catch (...) {
+                        std::cerr << "SimpleThreadPool task exception" << std::endl;
+                    }
                 }
             });
     }
@@ -72,7 +95,7 @@ public:
 
 private:
     std::vector<std::thread> workers;
-    std::queue<std::function<void()> > tasks;
+    std::queue<Task> tasks;
     std::mutex queue_mutex;
     std::condition_variable condition;
     bool stop{false};
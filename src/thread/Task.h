@@ -0,0 +1,111 @@
+#ifndef CONCURRENT_TASK_H
+#define CONCURRENT_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace frenzy {
+
+/**
+ * move only void() callable, a replacement of std::function for task queues.
+ * callables up to InlineSize bytes, e.g. a lambda capturing a few pointers, are stored inline, no allocation.
+ * bigger ones or ones with a throwing move constructor go to the heap.
+ */
+class Task {
+public:
+    static constexpr size_t InlineSize = 48;  // whole Task is one cache line
+
+    Task() noexcept = default;
+
+    template <typename F, typename D = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<D, Task>::value>::type>
+    Task(F &&f_) {
+        if constexpr (fits_inline<D>()) {
+            new (&storage) D(std::forward<F>(f_));
+            ops = &InlineOps<D>::ops;
+        } else {
+            *reinterpret_cast<D **>(&storage) = new D(std::forward<F>(f_));
+            ops = &HeapOps<D>::ops;
+        }
+    }
+
+    Task(Task &&other_) noexcept : ops{other_.ops} {
+        if (ops != nullptr) {
+            ops->move(&storage, &other_.storage);
+            other_.ops = nullptr;
+        }
+    }
+
+    Task &operator=(Task &&other_) noexcept {
+        if (this != &other_) {
+            reset();
+            ops = other_.ops;
+            if (ops != nullptr) {
+                ops->move(&storage, &other_.storage);
+                other_.ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops->invoke(&storage); }
+
+    explicit operator bool() const noexcept { return ops != nullptr; }
+
+    void reset() noexcept {
+        if (ops != nullptr) {
+            ops->destroy(&storage);
+            ops = nullptr;
+        }
+    }
+
+    // true if F is stored without allocation
+    template <typename F>
+    static constexpr bool fits_inline() {
+        return sizeof(F) <= InlineSize && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<F>::value;
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void *);
+        void (*move)(void *dst, void *src) noexcept;  // move constructs dst, destroys src
+        void (*destroy)(void *) noexcept;
+    };
+
+    template <typename F>
+    struct InlineOps {
+        static void invoke(void *p_) { (*reinterpret_cast<F *>(p_))(); }
+        static void move(void *dst_, void *src_) noexcept {
+            new (dst_) F(std::move(*reinterpret_cast<F *>(src_)));
+            reinterpret_cast<F *>(src_)->~F();
+        }
+        static void destroy(void *p_) noexcept { reinterpret_cast<F *>(p_)->~F(); }
+        static constexpr Ops ops{&invoke, &move, &destroy};
+    };
+
+    template <typename F>
+    struct HeapOps {
+        static void invoke(void *p_) { (**reinterpret_cast<F **>(p_))(); }
+        static void move(void *dst_, void *src_) noexcept {
+            *reinterpret_cast<F **>(dst_) = *reinterpret_cast<F **>(src_);
+        }
+        static void destroy(void *p_) noexcept { delete *reinterpret_cast<F **>(p_); }
+        static constexpr Ops ops{&invoke, &move, &destroy};
+    };
+
+    typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type storage;
+    const Ops *ops{nullptr};
+};
+
+static_assert(sizeof(Task) == 64, "Task should fill one cache line");
+}  // namespace frenzy
+
+#endif
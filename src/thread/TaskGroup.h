@@ -0,0 +1,172 @@
+#ifndef CONCURRENT_TASK_GROUP_H
+#define CONCURRENT_TASK_GROUP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "thread/TaskScheduler.h"
+
+namespace frenzy {
+
+/**
+ * fork join on a TaskScheduler. run() spawns, wait() returns once every spawned task finished, it runs queued
+ * tasks on the waiting thread meanwhile instead of blocking, so groups nest inside tasks without starving the pool.
+ * the first exception thrown by a task is rethrown by wait().
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskScheduler &scheduler_ = TaskScheduler::instance()) : pool{scheduler_} {}
+
+    ~TaskGroup() {
+        try {
+            wait();
+        } catch (...) {
+        }
+    }
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    template <typename F>
+    void run(F &&f_) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        pool.submit([this, f = std::forward<F>(f_)]() mutable {
+            {
+                auto fn = std::move(f);  // captures die before the group may be destroyed
+                try {
+                    fn();
+                } catch (...) {
+                    if (!failed.exchange(true, std::memory_order_relaxed)) error = std::current_exception();
+                }
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    void wait() {
+        for (int idle = 0; pending.load(std::memory_order_acquire) != 0;) {
+            if (pool.run_one()) {
+                idle = 0;
+            } else if (++idle < 64) {
+                asm volatile("pause" ::: "memory");
+            } else {
+                std::this_thread::yield();  // the rest runs on other workers
+            }
+        }
+        if (failed.load(std::memory_order_relaxed)) {
+            std::exception_ptr e = std::move(error);
+            error = nullptr;
+            failed.store(false, std::memory_order_relaxed);
+            std::rethrow_exception(e);
+        }
+    }
+
+    TaskScheduler &scheduler() { return pool; }
+
+private:
+    TaskScheduler &pool;
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+};
+
+namespace detail {
+
+// grain 0 leaves about 8 chunks per worker
+inline size_t auto_grain(size_t n_, size_t grain_, const TaskScheduler &scheduler_) {
+    return grain_ != 0 ? grain_ : std::max<size_t>(1, n_ / (8 * scheduler_.size()));
+}
+
+/**
+ * lazy binary splitting: half of the range is spawned only while the worker's own deque is nearly empty,
+ * i.e. thieves took what was there. otherwise a grain is run inline and the deque checked again.
+ */
+template <typename Body>
+void for_range(TaskGroup &group_, size_t lo_, size_t hi_, size_t grain_, const Body &body_) {
+    while (hi_ - lo_ > grain_) {
+        if (group_.scheduler().local_backlog() < 2) {
+            size_t mid = lo_ + (hi_ - lo_) / 2;
+            group_.run([&group_, mid, hi_, grain_, &body_] { for_range(group_, mid, hi_, grain_, body_); });
+            hi_ = mid;
+        } else {
+            body_(lo_, lo_ + grain_);
+            lo_ += grain_;
+        }
+    }
+    body_(lo_, hi_);
+}
+
+template <typename T, typename Map, typename Combine>
+struct ReduceContext {
+    TaskScheduler &scheduler;
+    size_t grain;
+    const T &identity;
+    const Map &map;
+    const Combine &combine;
+};
+
+// like for_range, partial results are combined in index order so combine need not be commutative
+template <typename T, typename Context>
+T reduce_range(const Context &ctx_, size_t lo_, size_t hi_) {
+    T acc = ctx_.identity;
+    while (hi_ - lo_ > ctx_.grain && ctx_.scheduler.local_backlog() >= 2) {
+        acc = ctx_.combine(acc, ctx_.map(lo_, lo_ + ctx_.grain));
+        lo_ += ctx_.grain;
+    }
+    if (hi_ - lo_ <= ctx_.grain) return ctx_.combine(acc, ctx_.map(lo_, hi_));
+    size_t mid = lo_ + (hi_ - lo_) / 2;
+    T right = ctx_.identity;
+    TaskGroup group(ctx_.scheduler);
+    group.run([&ctx_, &right, mid, hi_] { right = reduce_range<T>(ctx_, mid, hi_); });
+    T left = reduce_range<T>(ctx_, lo_, mid);
+    group.wait();
+    return ctx_.combine(ctx_.combine(acc, left), right);
+}
+}  // namespace detail
+
+/**
+ * runs fn_ over [begin_, end_) on the scheduler, fn_(lo, hi) per chunk or fn_(i) per index.
+ * chunks are at least grain_ long except the last, 0 picks one. returns when all are done,
+ * rethrows the first exception.
+ */
+template <typename F>
+void parallel_for(size_t begin_, size_t end_, size_t grain_, F &&fn_,
+                  TaskScheduler &scheduler_ = TaskScheduler::instance()) {
+    if (end_ <= begin_) return;
+    size_t grain = detail::auto_grain(end_ - begin_, grain_, scheduler_);
+    auto run = [&](const auto &body) {
+        TaskGroup group(scheduler_);
+        group.run([&group, begin_, end_, grain, &body] { detail::for_range(group, begin_, end_, grain, body); });
+        group.wait();
+    };
+    if constexpr (std::is_invocable<F &, size_t, size_t>::value) {
+        run(fn_);
+    } else {
+        run([&fn_](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) fn_(i);
+        });
+    }
+}
+
+/**
+ * combine_(identity_, map_(lo, hi)) over chunks of [begin_, end_), combine_ must be associative.
+ */
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(size_t begin_, size_t end_, size_t grain_, const T &identity_, const Map &map_,
+                  const Combine &combine_, TaskScheduler &scheduler_ = TaskScheduler::instance()) {
+    if (end_ <= begin_) return identity_;
+    detail::ReduceContext<T, Map, Combine> ctx{scheduler_, detail::auto_grain(end_ - begin_, grain_, scheduler_),
+                                               identity_, map_, combine_};
+    T result = identity_;
+    TaskGroup group(scheduler_);
+    group.run([&ctx, &result, begin_, end_] { result = detail::reduce_range<T>(ctx, begin_, end_); });
+    group.wait();
+    return result;
+}
+}  // namespace frenzy
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef CONCURRENT_TASK_SCHEDULER_H
+#define CONCURRENT_TASK_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "allocator/SlabPool.h"
+#include "lockfree/MpmcBoundedQueue.h"
+#include "lockfree/WorkStealingDeque.h"
+#include "thread/Future.h"
+#include "thread/Task.h"
+#include "utils/CpuTopology.h"
+#include "utils/Futex.h"
+
+namespace frenzy {
+
+struct TaskSchedulerOptions {
+    size_t threads{0};           // 0 is one per cpu, or one per entry of cpus
+    bool pin{false};             // pin each worker to one cpu, CpuTopology::placement picks them unless cpus is set
+    std::vector<int> cpus;       // worker i runs on cpus[i % size], implies pin
+    std::vector<int> exclude;    // cpus kept free of workers, e.g. isolated for a latency critical thread
+    bool local_memory{true};     // pinned workers prefer memory of their numa node
+};
+
+/**
+ * work stealing pool for fine grained tasks, in place of PThreadPool and SimpleThreadPool.
+ * a task submitted by a worker goes to the worker's own deque, it runs them newest first while idle workers
+ * steal the oldest ones from a random victim. other threads submit through a shared injection queue.
+ * idle workers spin a while, then park on a futex, submitters wake one only if some are parked.
+ * waiting on a future inside a task blocks its worker, TaskGroup::wait runs other tasks meanwhile.
+ * with pinned workers on a numa host each node has its own injection queue, a task submitted with a node hint
+ * goes there, and idle workers steal from their own node before crossing the interconnect.
+ */
+class TaskScheduler {
+public:
+    static constexpr size_t InjectionCapacity = 16 * 1024;  // external submitters spin while it is full
+    static constexpr int SpinRounds = 64;
+
+    explicit TaskScheduler(size_t threads_ = std::thread::hardware_concurrency())
+        : TaskScheduler(TaskSchedulerOptions{threads_}) {}
+
+    explicit TaskScheduler(const TaskSchedulerOptions &options_) {
+        const CpuTopology &topology = CpuTopology::instance();
+        std::vector<int> cpus = options_.cpus;
+        if (options_.pin && cpus.empty()) cpus = topology.placement(options_.threads, options_.exclude);
+        size_t n = options_.threads != 0 ? options_.threads : cpus.size();
+        if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+        nodes = cpus.empty() ? 1 : std::max(1, topology.node_count());
+        for (int i = 0; i < nodes; ++i) injections.emplace_back(new MpmcBoundedQueue<Task>(InjectionCapacity));
+
+        for (size_t i = 0; i < n; ++i) {
+            int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+            int node = cpu < 0 ? 0 : std::max(0, topology.node_of(cpu)) % nodes;
+            workers.emplace_back(new Worker(i, cpu, node));
+        }
+        for (auto &w : workers) {
+            everyone.push_back(w.get());
+            for (auto &v : workers) {
+                if (v != w) (v->node == w->node ? w->near : w->far).push_back(v.get());
+            }
+        }
+        bool localMemory = options_.local_memory && nodes > 1;
+        for (size_t i = 0; i < n; ++i) {
+            workers[i]->thread = std::thread([this, i, localMemory] { run(i, localMemory); });
+        }
+    }
+
+    // runs what is queued, tasks spawned meanwhile included, then joins the workers
+    ~TaskScheduler() {
+        stopping.store(true, std::memory_order_seq_cst);
+        // an external submit which passed the check before stopping is still pushing, workers stay for its task
+        while (externalSubmits.load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+        exiting.store(true, std::memory_order_release);
+        epoch.fetch_add(1, std::memory_order_release);
+        futex_wake(&epoch, INT32_MAX, false);
+        for (auto &w : workers) w->thread.join();
+    }
+
+    TaskScheduler(const TaskScheduler &) = delete;
+    TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+    // same as SimpleThreadPool::enqueue, the future state comes from a slab and a small callable stays in the Task
+    template <class F, class... Args>
+    auto enqueue(F &&f, Args &&... args) -> Future<typename std::result_of<F(Args...)>::type> {
+        using return_type = typename std::result_of<F(Args...)>::type;
+
+        Promise<return_type> promise;
+        Future<return_type> res = promise.get_future();
+        if constexpr (sizeof...(Args) == 0) {
+            submit([promise = std::move(promise), f = std::forward<F>(f)]() mutable { promise.run(f); });
+        } else {
+            auto bound = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+            submit([promise = std::move(promise), bound = std::move(bound)]() mutable { promise.run(bound); });
+        }
+        return res;
+    }
+
+    /**
+     * fire and forget, an exception thrown by the task is printed to stderr
+     * @param node_ numa node owning the task's data, its workers run it first. -1 is the submitting thread's node
+     */
+    void submit(Task task_, int node_ = -1) {
+        Current &c = current();
+        bool worker = c.scheduler == this;
+        if (worker && (node_ < 0 || node_ % nodes == workers[c.index]->node)) {
+            workers[c.index]->deque.push(new (TaskBox::allocate()) Task(std::move(task_)));
+        } else {
+            // a worker keeps spawning while the destructor drains, it checks every injection queue before it exits.
+            // other threads are counted until their task is queued, the destructor waits for them (Dekker with
+            // stopping, both seq_cst)
+            if (!worker) {
+                externalSubmits.fetch_add(1, std::memory_order_seq_cst);
+                if (stopping.load(std::memory_order_seq_cst)) {
+                    externalSubmits.fetch_sub(1, std::memory_order_release);
+                    throw std::runtime_error("submit on stopped TaskScheduler");
+                }
+            }
+            if (node_ < 0) node_ = nodes > 1 ? current_node() : 0;
+            injections[node_ % nodes]->push(std::move(task_));
+            if (!worker) externalSubmits.fetch_sub(1, std::memory_order_release);
+        }
+        notify();
+    }
+
+    /**
+     * runs one queued task on the calling thread, false if none was found. lets a thread waiting for tasks
+     * help with them instead of blocking, see TaskGroup. any thread may call it.
+     */
+    bool run_one() {
+        Current &c = current();
+        Task task;
+        bool found = false;
+        if (c.scheduler == this) {
+            found = find(*workers[c.index], task);
+        } else {
+            thread_local uint64_t rng = 0x9E3779B97F4A7C15ULL ^ reinterpret_cast<uintptr_t>(&c);
+            for (int i = 0; i < nodes && !found; ++i) found = injections[i]->try_pop(task);
+            if (!found) found = steal(rng, everyone, task);
+        }
+        if (found) execute(task);
+        return found;
+    }
+
+    // the process wide scheduler, one thread per core, shared by services and batch work
+    static TaskScheduler &instance() {
+        static TaskScheduler scheduler;
+        return scheduler;
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // tasks queued on the calling worker's own deque, 0 on other threads. parallel_for splits ranges while it is low
+    size_t local_backlog() const {
+        const Current &c = current();
+        return c.scheduler == this ? static_cast<size_t>(workers[c.index]->deque.size()) : 0;
+    }
+
+    // index of the calling worker of this scheduler, -1 on other threads
+    int worker_index() const { return current().scheduler == this ? static_cast<int>(current().index) : -1; }
+
+    // cpu the worker is pinned to, -1 if not pinned
+    int worker_cpu(size_t index_) const { return workers[index_]->cpu; }
+
+    int worker_node(size_t index_) const { return workers[index_]->node; }
+
+    // numa nodes the workers are spread over, 1 unless pinned on a numa host
+    int node_count() const { return nodes; }
+
+private:
+    using TaskBox = SlabPool<sizeof(Task)>;  // deque items are pointers, the tasks live in pooled boxes
+
+    struct alignas(64) Worker {
+        Worker(size_t index_, int cpu_, int node_)
+            : rng{0x9E3779B97F4A7C15ULL * (index_ + 1)}, cpu{cpu_}, node{node_} {}
+
+        WorkStealingDeque<Task *> deque;
+        uint64_t rng;
+        int cpu;
+        int node;
+        std::vector<Worker *> near;  // other workers on the same node
+        std::vector<Worker *> far;
+        std::thread thread;
+    };
+
+    struct Current {
+        TaskScheduler *scheduler{nullptr};
+        size_t index{0};
+    };
+
+    static Current &current() {
+        thread_local Current c;
+        return c;
+    }
+
+    void run(size_t index_, bool localMemory_) {
+        current() = Current{this, index_};
+        Worker &self = *workers[index_];
+        if (self.cpu >= 0 && !pin_current_thread(self.cpu)) {
+            std::cerr << "TaskScheduler can not pin worker " << index_ << " to cpu " << self.cpu << std::endl;
+        }
+        if (localMemory_) prefer_node_memory(self.node);  // first touch by a pinned worker is node local anyway
+        Task task;
+        while (true) {
+            if (find(self, task)) {
+                execute(task);
+                continue;
+            }
+            bool found = false;
+            for (int i = 0; i < SpinRounds && !found; ++i) {
+                asm volatile("pause" ::: "memory");
+                found = find(self, task);
+            }
+            if (found) {
+                execute(task);
+                continue;
+            }
+
+            uint32_t seen = epoch.load(std::memory_order_acquire);
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the fence in notify
+            bool exit = exiting.load(std::memory_order_acquire);  // before find, every external task is visible then
+            if (find(self, task)) {
+                sleepers.fetch_sub(1, std::memory_order_relaxed);
+                execute(task);
+                continue;
+            }
+            if (exit) {
+                sleepers.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            futex_wait(&epoch, seen, -1, false);  // a submit after the check bumps epoch first
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+        current() = Current{};
+    }
+
+    /**
+     * own deque first, then the node's injection queue, then steal from a random victim on the node.
+     * other nodes only after that.
+     */
+    bool find(Worker &self_, Task &task_) {
+        Task *p = nullptr;
+        if (self_.deque.pop(p)) return take(p, task_);
+        if (injections[self_.node]->try_pop(task_)) return true;
+        if (steal(self_.rng, self_.near, task_)) return true;
+        for (int i = 1; i < nodes; ++i) {
+            if (injections[(self_.node + i) % nodes]->try_pop(task_)) return true;
+        }
+        return steal(self_.rng, self_.far, task_);
+    }
+
+    bool steal(uint64_t &rng_, const std::vector<Worker *> &victims_, Task &task_) {
+        Task *p = nullptr;
+        size_t n = victims_.size();
+        if (n == 0) return false;
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 7;
+        rng_ ^= rng_ << 17;
+        size_t start = static_cast<size_t>(rng_ % n);
+        for (size_t i = 0; i < n; ++i) {
+            Worker &victim = *victims_[(start + i) % n];
+            if (victim.deque.steal(p)) {
+                if (!victim.deque.empty()) notify();  // more to steal, get another idle worker on it
+                return take(p, task_);
+            }
+        }
+        return false;
+    }
+
+    static bool take(Task *p_, Task &task_) {
+        task_ = std::move(*p_);
+        p_->~Task();
+        TaskBox::deallocate(p_);
+        return true;
+    }
+
+    static void execute(Task &task_) {
+        try {
+            task_();
+        } catch (const std::exception &e) {
+            std::cerr << "TaskScheduler task exception: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "TaskScheduler task exception" << std::endl;
+        }
+        task_.reset();
+    }
+
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) != 0) {
+            epoch.fetch_add(1, std::memory_order_release);
+            futex_wake(&epoch, 1, false);
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<Worker *> everyone;  // victims of threads helping in run_one
+    std::vector<std::unique_ptr<MpmcBoundedQueue<Task>>> injections;  // one per node
+    int nodes{1};
+    alignas(64) std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> sleepers{0};
+    std::atomic<bool> stopping{false};         // external submits throw
+    std::atomic<bool> exiting{false};          // set once no external submit is in flight, idle workers leave
+    std::atomic<uint32_t> externalSubmits{0};  // submits of other threads between the stopping check and the push
+};
+}  // namespace frenzy
+
+#endif
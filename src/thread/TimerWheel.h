@@ -1,68 +1,599 @@
 #ifndef CONCURRENT_TIMERWHEEL_H
 #define CONCURRENT_TIMERWHEEL_H
 
-#include <lock/SpinLock.h>
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "lockfree/MpmcBoundedQueue.h"
 
 namespace frenzy {
+
+/**
+ * windows in which timers do not run, checked when a timer comes due rather than expanded up front.
+ * a due occurrence inside a window is skipped, a recurring timer goes on with its first occurrence after it.
+ */
 template <typename TTime = int64_t>
-class TimerWheel {
+class TimerCalendar {
 public:
-    typedef std::function<void(TTime)> TFunc;
+    // nothing runs within [start, end]
+    TimerCalendar& black_out(TTime start, TTime end) {
+        windows.push_back(Window{start, end, 0});
+        return *this;
+    }
 
-    bool advance(TTime now) {
-        TFunc func;
-        while (true) {
-            TTime tm = 0;
-
-            {
-                std::lock_guard<frenzy::spin_mutex> lock(mutex_);
-                if (!timers_.empty()) {
-                    auto& timer = timers_.top();
-
-                    if (timer.tm > now) {
-                        return false;
-                    } else {
-                        tm = timer.tm;
-                        func = std::move(timer.func);
-                        timers_.pop();
-                    }
-                } else {
-                    return false;
+    // nothing runs within [from, to] + k * period for every k, e.g. a daily lunch break in ns since the epoch
+    TimerCalendar& black_out_every(TTime period, TTime from, TTime to) {
+        windows.push_back(Window{from, to, period});
+        return *this;
+    }
+
+    bool blocked(TTime t) const {
+        for (const auto& w : windows) {
+            if (w.end_of(t) >= t) return true;
+        }
+        return false;
+    }
+
+    // the first time at or after t outside every window
+    TTime next_open(TTime t) const {
+        for (bool moved = true; moved;) {
+            moved = false;
+            for (const auto& w : windows) {
+                TTime end = w.end_of(t);
+                if (end >= t) {
+                    t = end + 1;
+                    moved = true;
                 }
             }
-            func(tm);
-            return true;
         }
+        return t;
     }
 
-    void register_timer(const TFunc& func, TTime start_time, TTime interval = 0, TTime end_time = 0,
-                        TTime black_out_start = 0, TTime black_out_end = 0) {
-        std::lock_guard<frenzy::spin_mutex> lock(mutex_);
-        if (interval && end_time) {
-            for (TTime tm = start_time; tm <= end_time; tm += interval) {
-                if (tm >= black_out_start && tm <= black_out_end) {
-                } else {
-                    timers_.push(TimerScheduler{tm, func});
-                }
+    bool empty() const { return windows.empty(); }
+
+    bool operator==(const TimerCalendar& other) const {
+        if (windows.size() != other.windows.size()) return false;
+        for (size_t i = 0; i < windows.size(); ++i) {
+            const Window &a = windows[i], &b = other.windows[i];
+            if (a.start != b.start || a.end != b.end || a.period != b.period) return false;
+        }
+        return true;
+    }
+
+private:
+    struct Window {
+        // end of the window holding t, below t if none does
+        TTime end_of(TTime t) const {
+            if (period <= 0) return t >= start && t <= end ? end : t - 1;
+            TTime shift = ((t - start) % period + period) % period;  // t - shift is the latest window start <= t
+            return shift <= end - start ? t - shift + (end - start) : t - 1;
+        }
+
+        TTime start, end, period;
+    };
+
+    std::vector<Window> windows;
+};
+
+/**
+ * hierarchical timing wheel, 11 levels of 64 slots cover every 64 bit tick count, insert, cancel and reschedule
+ * are O(1). a level keeps a bitmap of its busy slots, so advance() jumps straight to the next due slot however
+ * far away, entries of a higher level cascade down when their slot comes up.
+ * the thread calling advance() owns the wheel, other threads register, cancel and reschedule without locks,
+ * their registrations, cancels and reschedules are queued for the next advance(). recurring timers re-arm themselves.
+ * a timer is one 64 byte node, linked by 32 bit indexes and pooled in chunks recycled through a lock free free list.
+ * a callable up to 16 bytes, e.g. a lambda capturing a pointer and an id, is stored in the node, bigger ones on
+ * the heap. a Handle stays safe to use after its timer ran or the node got reused, it just no longer matches.
+ * a Handle must not outlive its wheel.
+ */
+template <typename TTime = int64_t>
+class TimerWheel {
+public:
+    typedef std::function<void(TTime)> TFunc;
+
+    static constexpr int Levels = 11;
+    static constexpr int SlotBits = 6;
+    static constexpr uint64_t SlotMask = (1 << SlotBits) - 1;
+    static constexpr uint32_t ChunkBits = 10;
+    static constexpr uint32_t MaxChunks = 4096;  // about 4M live timers
+    static constexpr uint32_t MaxCalendars = 1024;
+    static constexpr size_t RequestCapacity = 1024;  // cancels and reschedules of other threads, they spin while full
+
+    struct CalendarId {
+        uint16_t id{0};  // 0 is no calendar
+    };
+
+private:
+    enum Status : uint32_t { Free, Armed, Cancelled };
+    enum Place : uint8_t { Batch = 0xFE, Nowhere = 0xFF };  // level of a node not linked in a slot
+
+public:
+    class Handle {
+    public:
+        Handle() = default;
+
+        /**
+         * stops the timer, a recurring one included, from any thread. it never runs after a true return,
+         * the node is freed at once on the owner thread, at the next advance() from others.
+         * @return false if it already ran for good or was cancelled
+         */
+        bool cancel() { return wheel_ != nullptr && wheel_->cancel(index_, generation_); }
+
+        /**
+         * moves the next run to time, a recurring timer goes on every interval from there.
+         * immediate on the owner thread, at the next advance() from others.
+         * @return false if it already ran for good or was cancelled
+         */
+        bool reschedule(TTime time) { return wheel_ != nullptr && wheel_->reschedule(index_, generation_, time); }
+
+        // armed and not cancelled yet
+        bool active() const {
+            return wheel_ != nullptr && wheel_->node(index_).state.load(std::memory_order_acquire) ==
+                                            stamp(generation_, Armed);
+        }
+
+    private:
+        friend class TimerWheel;
+        Handle(TimerWheel* wheel, uint32_t index, uint32_t generation)
+            : wheel_{wheel}, index_{index}, generation_{generation} {}
+
+        TimerWheel* wheel_{nullptr};
+        uint32_t index_{0};
+        uint32_t generation_{0};
+    };
+
+    /**
+     * @param resolution length of a tick in TTime units, a timer runs at the first advance() at or after its time
+     *        rounded up to a tick
+     */
+    explicit TimerWheel(TTime resolution = 1) : resolution_{resolution > 0 ? resolution : 1} {}
+
+    ~TimerWheel() {
+        for (uint32_t c = 0; c < chunk_count_; ++c) {
+            Timer* chunk = chunks_[c].load(std::memory_order_relaxed);
+            for (uint32_t i = 0; i < ChunkSize; ++i) chunk[i].reset();
+            delete[] chunk;
+        }
+        for (uint32_t i = 1; i < calendar_count_; ++i) delete calendars_[i].load(std::memory_order_relaxed);
+        delete requests_.load(std::memory_order_relaxed);
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * runs every timer due at now, a recurring timer at most once per tick.
+     * the first caller becomes the owner, a call from any other thread throws.
+     * @return number of timers run
+     */
+    size_t advance(TTime now) {
+        if (!owned()) {
+            std::thread::id none{};
+            if (!owner_.compare_exchange_strong(none, std::this_thread::get_id(), std::memory_order_acq_rel)) {
+                throw std::runtime_error("TimerWheel: advance from a thread other than the owner");
             }
+            origin_ = now;
+        }
+        drain();
+        if (now < origin_) return 0;
+        uint64_t target = static_cast<uint64_t>((now - origin_) / resolution_);
+        size_t fired = 0;
+        int level = 0;
+        uint64_t slot = 0, deadline = 0;
+        while (next_slot(level, slot, deadline) && deadline <= target) {
+            elapsed_ = deadline;
+            fired += expire(level, slot);
+        }
+        if (target > elapsed_) elapsed_ = target;
+        return fired;
+    }
+
+    /**
+     * calendars are kept by the wheel and can not change, timers refer to them by id.
+     * adding an equal one again returns the same id.
+     */
+    CalendarId add_calendar(const TimerCalendar<TTime>& calendar) {
+        if (calendar.empty()) return CalendarId{};
+        std::lock_guard<std::mutex> lock(grow_mutex_);
+        for (uint32_t i = 1; i < calendar_count_; ++i) {
+            if (*calendars_[i].load(std::memory_order_relaxed) == calendar) return CalendarId{uint16_t(i)};
+        }
+        if (calendar_count_ == MaxCalendars) throw std::runtime_error("TimerWheel: too many calendars");
+        calendars_[calendar_count_].store(new TimerCalendar<TTime>(calendar), std::memory_order_release);
+        return CalendarId{uint16_t(calendar_count_++)};
+    }
+
+    /**
+     * runs func(time) at start_time, then every interval until end_time, 0 is no end, skipping what the
+     * calendar blacks out. any thread may register.
+     */
+    template <typename F>
+    Handle register_timer(F&& func, TTime start_time, TTime interval, TTime end_time, CalendarId calendar) {
+        uint32_t index = allocate();
+        Timer& t = node(index);
+        t.emplace(std::forward<F>(func));
+        t.time = start_time;
+        t.interval = interval > 0 ? interval : 0;
+        t.end = end_time;
+        t.calendar = calendar.id;
+        t.level = Nowhere;
+        uint32_t generation = t.state.load(std::memory_order_relaxed) >> 2;
+        t.state.store(stamp(generation, Armed), std::memory_order_release);
+        if (owned()) {
+            insert(index, t, elapsed_);
         } else {
-            timers_.push(TimerScheduler{start_time, func});
+            uint32_t head = inbox_.load(std::memory_order_relaxed);
+            do {
+                t.next.store(head, std::memory_order_relaxed);
+            } while (!inbox_.compare_exchange_weak(head, index + 1, std::memory_order_release,
+                                                   std::memory_order_relaxed));
+        }
+        return Handle{this, index, generation};
+    }
+
+    /**
+     * same as the heap based wheel: recurring only with both an interval and an end_time, a one shot otherwise.
+     * the blackout window [black_out_start, black_out_end], a single point if they are equal, becomes a calendar
+     * of a recurring timer. a one shot ignores it. both 0 is no window.
+     * a timer without end takes the calendar overload, e.g. register_timer(f, start, interval, 0, CalendarId{}).
+     */
+    template <typename F>
+    Handle register_timer(F&& func, TTime start_time, TTime interval = 0, TTime end_time = 0,
+                          TTime black_out_start = 0, TTime black_out_end = 0) {
+        if (interval <= 0 || end_time == 0) {
+            return register_timer(std::forward<F>(func), start_time, 0, 0, CalendarId{});
+        }
+        CalendarId calendar;
+        bool window = black_out_start != 0 || black_out_end != 0;
+        if (window && black_out_start <= black_out_end) {
+            calendar = add_calendar(TimerCalendar<TTime>().black_out(black_out_start, black_out_end));
         }
+        return register_timer(std::forward<F>(func), start_time, interval, end_time, calendar);
     }
 
 private:
-    struct TimerScheduler {
-        TTime tm;
-        TFunc func;
+    static constexpr uint32_t ChunkSize = 1 << ChunkBits;
+
+    struct Ops {
+        void (*invoke)(void*, TTime);
+        void (*destroy)(void*) noexcept;
+    };
+
+    template <typename F>
+    struct InlineOps {
+        static void invoke(void* p, TTime time) { (*reinterpret_cast<F*>(p))(time); }
+        static void destroy(void* p) noexcept { reinterpret_cast<F*>(p)->~F(); }
+        static constexpr Ops ops{&invoke, &destroy};
     };
 
-    struct Comp {
-        bool operator()(const TimerScheduler& a, const TimerScheduler& b) const { return a.tm > b.tm; }
+    template <typename F>
+    struct HeapOps {
+        static void invoke(void* p, TTime time) { (**reinterpret_cast<F**>(p))(time); }
+        static void destroy(void* p) noexcept { delete *reinterpret_cast<F**>(p); }
+        static constexpr Ops ops{&invoke, &destroy};
     };
 
-    std::priority_queue<TimerScheduler, std::vector<TimerScheduler>, Comp> timers_;
-    frenzy::spin_mutex mutex_;
+    // links are index + 1, 0 is none. next also links the inbox and the free list
+    struct alignas(64) Timer {
+        template <typename F>
+        void emplace(F&& func) {
+            using D = typename std::decay<F>::type;
+            if constexpr (sizeof(D) <= sizeof(storage) && alignof(D) <= alignof(void*) &&
+                          std::is_nothrow_destructible<D>::value) {
+                new (&storage) D(std::forward<F>(func));
+                ops = &InlineOps<D>::ops;
+            } else {
+                *reinterpret_cast<D**>(&storage) = new D(std::forward<F>(func));
+                ops = &HeapOps<D>::ops;
+            }
+        }
+
+        void reset() noexcept {
+            if (ops != nullptr) ops->destroy(&storage);
+            ops = nullptr;
+        }
+
+        uint32_t prev{0};
+        std::atomic<uint32_t> next{0};
+        std::atomic<uint32_t> state{0};  // generation << 2 | Status
+        uint8_t level{Nowhere};
+        uint8_t slot{0};
+        uint16_t calendar{0};
+        TTime time{}, interval{}, end{};
+        typename std::aligned_storage<2 * sizeof(void*), alignof(void*)>::type storage;
+        const Ops* ops{nullptr};
+    };
+
+    static_assert(sizeof(TTime) > 8 || sizeof(Timer) == 64, "a timer should fill one cache line");
+
+    // a cancel or a reschedule from another thread, the owner applies it in drain()
+    struct Request {
+        uint32_t index;
+        uint32_t generation;
+        TTime time;
+        bool cancel;
+    };
+
+    static uint32_t stamp(uint32_t generation, Status status) { return generation << 2 | status; }
+
+    Timer& node(uint32_t index) const {
+        return chunks_[index >> ChunkBits].load(std::memory_order_acquire)[index & (ChunkSize - 1)];
+    }
+
+    bool owned() const { return owner_.load(std::memory_order_acquire) == std::this_thread::get_id(); }
+
+    // registrations, then cancels and reschedules from other threads
+    void drain() {
+        uint32_t pending = inbox_.exchange(0, std::memory_order_acquire);
+        while (pending != 0) {
+            uint32_t index = pending - 1;
+            Timer& t = node(index);
+            pending = t.next.load(std::memory_order_relaxed);
+            if ((t.state.load(std::memory_order_acquire) & 3) == Armed) {
+                insert(index, t, elapsed_);
+            } else {
+                release(index, t);
+            }
+        }
+        MpmcBoundedQueue<Request>* queue = requests_.load(std::memory_order_acquire);
+        Request r;
+        while (queue != nullptr && queue->try_pop(r)) {
+            if (r.cancel) {
+                unlink_cancelled(r.index, r.generation);
+            } else {
+                move(r.index, r.generation, r.time);
+            }
+        }
+    }
+
+    bool cancel(uint32_t index, uint32_t generation) {
+        Timer& t = node(index);
+        uint32_t armed = stamp(generation, Armed);
+        if (!t.state.compare_exchange_strong(armed, stamp(generation, Cancelled), std::memory_order_acq_rel)) {
+            return false;
+        }
+        if (owned()) {
+            unlink_cancelled(index, generation);
+        } else {  // only the owner touches the slots, it frees the node at its next advance()
+            request(Request{index, generation, TTime{}, true});
+        }
+        return true;
+    }
+
+    // owner only. a node in the inbox or running right now is freed when drain() or run() meets it
+    void unlink_cancelled(uint32_t index, uint32_t generation) {
+        Timer& t = node(index);
+        if (t.state.load(std::memory_order_acquire) != stamp(generation, Cancelled) || t.level == Nowhere) return;
+        unlink(t);
+        release(index, t);
+    }
+
+    bool reschedule(uint32_t index, uint32_t generation, TTime time) {
+        if (node(index).state.load(std::memory_order_acquire) != stamp(generation, Armed)) return false;
+        if (owned()) return move(index, generation, time);
+        request(Request{index, generation, time, false});
+        return true;
+    }
+
+    void request(const Request& r) {
+        MpmcBoundedQueue<Request>* queue = requests_.load(std::memory_order_acquire);
+        if (queue == nullptr) {  // the first one from another thread creates the queue, a racing loser drops its own
+            MpmcBoundedQueue<Request>* created = new MpmcBoundedQueue<Request>(RequestCapacity);
+            if (requests_.compare_exchange_strong(queue, created, std::memory_order_acq_rel)) {
+                queue = created;
+            } else {
+                delete created;
+            }
+        }
+        queue->push(r);
+    }
+
+    // owner only. a timer in the inbox or running right now picks up the new time when it is next inserted
+    bool move(uint32_t index, uint32_t generation, TTime time) {
+        Timer& t = node(index);
+        if (t.state.load(std::memory_order_acquire) != stamp(generation, Armed)) return false;
+        t.time = time;
+        if (t.level != Nowhere) {
+            unlink(t);
+            insert(index, t, elapsed_);
+        } else if (running_ == index + 1) {
+            rescheduled_ = true;
+        }
+        return true;
+    }
+
+    // not before minTick, a timer already due goes to the current slot
+    void insert(uint32_t index, Timer& t, uint64_t minTick) {
+        uint64_t tick = ticks(t.time);
+        if (tick < minTick) tick = minTick;
+        uint64_t masked = (elapsed_ ^ tick) | SlotMask;
+        int level = (63 - __builtin_clzll(masked)) / SlotBits;
+        uint64_t slot = (tick >> (level * SlotBits)) & SlotMask;
+        uint32_t& head = slots_[level][slot];
+        t.level = static_cast<uint8_t>(level);
+        t.slot = static_cast<uint8_t>(slot);
+        t.prev = 0;
+        t.next.store(head, std::memory_order_relaxed);
+        if (head != 0) node(head - 1).prev = index + 1;
+        head = index + 1;
+        occupied_[level] |= 1ULL << slot;
+    }
+
+    void unlink(Timer& t) {
+        uint32_t next = t.next.load(std::memory_order_relaxed);
+        uint32_t& head = t.level == Batch ? batch_ : slots_[t.level][t.slot];
+        if (t.prev == 0) {
+            head = next;
+        } else {
+            node(t.prev - 1).next.store(next, std::memory_order_relaxed);
+        }
+        if (next != 0) node(next - 1).prev = t.prev;
+        if (t.level != Batch && head == 0) occupied_[t.level] &= ~(1ULL << t.slot);
+        t.level = Nowhere;
+    }
+
+    // time rounded up to a tick, so a timer never runs early
+    uint64_t ticks(TTime time) const {
+        if (time <= origin_) return 0;
+        return static_cast<uint64_t>((time - origin_ + resolution_ - 1) / resolution_);
+    }
+
+    // the earliest busy slot, lower levels always hold earlier ticks than higher ones
+    bool next_slot(int& level, uint64_t& slot, uint64_t& deadline) const {
+        for (level = 0; level < Levels; ++level) {
+            uint64_t busy = occupied_[level];
+            if (busy == 0) continue;
+            int shift = level * SlotBits;
+            uint64_t pos = (elapsed_ >> shift) & SlotMask;
+            uint64_t rotated = pos == 0 ? busy : (busy >> pos) | (busy << (64 - pos));
+            slot = (pos + __builtin_ctzll(rotated)) & SlotMask;
+            uint64_t levelStart = shift + SlotBits >= 64 ? 0 : elapsed_ & ~((1ULL << (shift + SlotBits)) - 1);
+            deadline = levelStart + (slot << shift);
+            return true;
+        }
+        return false;
+    }
+
+    // runs or cascades the timers of one slot, callbacks may register, cancel and reschedule meanwhile
+    size_t expire(int level, uint64_t slot) {
+        batch_ = slots_[level][slot];
+        slots_[level][slot] = 0;
+        occupied_[level] &= ~(1ULL << slot);
+        for (uint32_t i = batch_; i != 0; i = node(i - 1).next.load(std::memory_order_relaxed)) {
+            node(i - 1).level = Batch;
+        }
+
+        size_t fired = 0;
+        while (batch_ != 0) {
+            uint32_t index = batch_ - 1;
+            Timer& t = node(index);
+            unlink(t);
+            uint32_t state = t.state.load(std::memory_order_acquire);
+            if ((state & 3) != Armed) {
+                release(index, t);
+            } else if (ticks(t.time) > elapsed_) {
+                insert(index, t, elapsed_);
+            } else {
+                fired += run(index, t, state);
+            }
+        }
+        return fired;
+    }
+
+    size_t run(uint32_t index, Timer& t, uint32_t armed) {
+        const TimerCalendar<TTime>* calendar = calendars_[t.calendar].load(std::memory_order_acquire);  // 0 is null
+        TTime time = t.time;
+        if (calendar != nullptr && calendar->blocked(time)) {  // skipped, a recurring timer resumes after it
+            if (t.interval == 0 || !next_after(t, calendar->next_open(time))) {
+                release(index, t);
+            } else {
+                insert(index, t, elapsed_ + 1);
+            }
+            return 0;
+        }
+        if (t.interval == 0) {
+            // stale before the call, so a cancel from the callback or another thread reports false
+            uint32_t done = stamp((armed >> 2) + 1, Free);
+            if (!t.state.compare_exchange_strong(armed, done, std::memory_order_acq_rel)) {
+                release(index, t);
+                return 0;
+            }
+            t.ops->invoke(&t.storage, time);
+            recycle(index, t);
+            return 1;
+        }
+        running_ = index + 1;
+        t.ops->invoke(&t.storage, time);
+        running_ = 0;
+        bool moved = rescheduled_;
+        rescheduled_ = false;
+        if (t.state.load(std::memory_order_acquire) != armed || !next_after(t, moved ? t.time : time + 1)) {
+            release(index, t);
+        } else {
+            insert(index, t, elapsed_ + 1);  // behind by more than a tick, catches up one run per tick
+        }
+        return 1;
+    }
+
+    // moves a recurring timer to its first occurrence at or after from, false past its end
+    static bool next_after(Timer& t, TTime from) {
+        if (from > t.time) t.time += ((from - t.time) + t.interval - 1) / t.interval * t.interval;
+        return t.end == 0 || t.time <= t.end;
+    }
+
+    uint32_t allocate() {
+        uint64_t head = free_.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t index1 = static_cast<uint32_t>(head);
+            if (index1 == 0) {
+                grow();
+                head = free_.load(std::memory_order_acquire);
+                continue;
+            }
+            uint64_t next = ((head >> 32) + 1) << 32 | node(index1 - 1).next.load(std::memory_order_relaxed);
+            if (free_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                return index1 - 1;
+            }
+        }
+    }
+
+    // a new generation, so handles of the old one stop matching, then back to the free list
+    void release(uint32_t index, Timer& t) {
+        t.state.store(stamp((t.state.load(std::memory_order_relaxed) >> 2) + 1, Free), std::memory_order_release);
+        recycle(index, t);
+    }
+
+    void recycle(uint32_t index, Timer& t) {
+        t.reset();
+        push_free(index, index);
+    }
+
+    void push_free(uint32_t first, uint32_t last) {
+        Timer& t = node(last);
+        uint64_t head = free_.load(std::memory_order_relaxed);
+        uint64_t next;
+        do {
+            t.next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            next = ((head >> 32) + 1) << 32 | (first + 1);
+        } while (!free_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void grow() {
+        std::lock_guard<std::mutex> lock(grow_mutex_);
+        if (static_cast<uint32_t>(free_.load(std::memory_order_acquire)) != 0) return;  // another thread grew it
+        if (chunk_count_ == MaxChunks) throw std::runtime_error("TimerWheel: too many live timers");
+        Timer* chunk = new Timer[ChunkSize];
+        uint32_t base = chunk_count_ << ChunkBits;
+        for (uint32_t i = 0; i + 1 < ChunkSize; ++i) chunk[i].next.store(base + i + 2, std::memory_order_relaxed);
+        chunks_[chunk_count_++].store(chunk, std::memory_order_release);
+        push_free(base, base + ChunkSize - 1);
+    }
+
+    const TTime resolution_;
+    TTime origin_{};
+    uint64_t elapsed_{0};  // ticks since origin_ the wheel has advanced to
+    uint32_t batch_{0};    // the slot expire() works on
+    uint32_t running_{0};  // index + 1 of the timer whose callback runs
+    bool rescheduled_{false};
+    std::atomic<std::thread::id> owner_{};
+    uint64_t occupied_[Levels]{};
+    uint32_t slots_[Levels][1 << SlotBits]{};
+
+    alignas(64) std::atomic<uint32_t> inbox_{0};  // registrations from other threads, a stack
+    alignas(64) std::atomic<uint64_t> free_{0};   // tag << 32 | index + 1 of the first free node
+    std::atomic<Timer*> chunks_[MaxChunks]{};
+    uint32_t chunk_count_{0};
+    std::atomic<TimerCalendar<TTime>*> calendars_[MaxCalendars]{};
+    uint32_t calendar_count_{1};
+    std::atomic<MpmcBoundedQueue<Request>*> requests_{nullptr};  // created by the first foreign cancel or reschedule
+    std::mutex grow_mutex_;
 };
 }  // namespace frenzy
 
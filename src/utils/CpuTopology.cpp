@@ -0,0 +1,146 @@
+#include "CpuTopology.h"
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <set>
+
+namespace frenzy {
+
+namespace {
+std::string read_line(const std::string &path_) {
+    std::ifstream in(path_);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+int read_int(const std::string &path_, int default_) {
+    std::string line = read_line(path_);
+    return line.empty() ? default_ : std::stoi(line);
+}
+}  // namespace
+
+std::vector<int> parse_cpu_list(const std::string &list_) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list_.size()) {
+        size_t end = list_.find(',', pos);
+        if (end == std::string::npos) end = list_.size();
+        std::string item = list_.substr(pos, end - pos);
+        size_t dash = item.find('-');
+        if (!item.empty() && item.find_first_not_of(" \n") != std::string::npos) {
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            for (int c = first; c <= last; ++c) cpus.push_back(c);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+CpuTopology::CpuTopology(const std::string &sysRoot_, bool affinityOnly_) {
+    std::string cpuRoot = sysRoot_ + "/cpu/";
+    std::vector<int> online = parse_cpu_list(read_line(cpuRoot + "online"));
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (affinityOnly_ && sched_getaffinity(0, sizeof(allowed), &allowed) != 0) affinityOnly_ = false;
+
+    // node of each cpu from node<N>/cpulist, everything is node 0 without the directory
+    std::vector<int> nodeOf;
+    std::set<int> seen;
+    if (DIR *dir = opendir((sysRoot_ + "/node").c_str())) {
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 || !isdigit(name[4])) continue;
+            int node = std::stoi(name.substr(4));
+            for (int cpu : parse_cpu_list(read_line(sysRoot_ + "/node/" + name + "/cpulist"))) {
+                if (cpu >= static_cast<int>(nodeOf.size())) nodeOf.resize(cpu + 1, 0);
+                nodeOf[cpu] = node;
+            }
+            seen.insert(node);
+        }
+        closedir(dir);
+    }
+
+    for (int cpu : online) {
+        if (affinityOnly_ && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed))) continue;
+        std::string topo = cpuRoot + "cpu" + std::to_string(cpu) + "/topology/";
+        int node = cpu < static_cast<int>(nodeOf.size()) ? nodeOf[cpu] : 0;
+        infos.push_back(CpuInfo{cpu, read_int(topo + "core_id", cpu), read_int(topo + "physical_package_id", 0), node});
+    }
+    nodes = seen.empty() ? 1 : *seen.rbegin() + 1;
+}
+
+const CpuTopology &CpuTopology::instance() {
+    static CpuTopology topology;
+    return topology;
+}
+
+int CpuTopology::node_of(int cpu_) const {
+    for (const auto &info : infos) {
+        if (info.cpu == cpu_) return info.node;
+    }
+    return -1;
+}
+
+std::vector<int> CpuTopology::node_cpus(int node_) const {
+    std::vector<int> cpus;
+    for (const auto &info : infos) {
+        if (info.node == node_) cpus.push_back(info.cpu);
+    }
+    return cpus;
+}
+
+std::vector<int> CpuTopology::placement(size_t n_, const std::vector<int> &exclude_) const {
+    std::vector<CpuInfo> usable;
+    for (const auto &info : infos) {
+        if (std::find(exclude_.begin(), exclude_.end(), info.cpu) == exclude_.end()) usable.push_back(info);
+    }
+    // rank of a cpu among the hyperthreads of its core, 0 for the first one
+    std::vector<std::pair<int, CpuInfo>> ranked;
+    for (const auto &info : usable) {
+        int rank = 0;
+        for (const auto &other : usable) {
+            if (other.package == info.package && other.core == info.core && other.cpu < info.cpu) ++rank;
+        }
+        ranked.emplace_back(rank, info);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b) {
+        if (a.first != b.first) return a.first < b.first;
+        if (a.second.node != b.second.node) return a.second.node < b.second.node;
+        return a.second.cpu < b.second.cpu;
+    });
+    std::vector<int> cpus;
+    if (n_ == 0) n_ = ranked.size();
+    for (size_t i = 0; i < n_ && !ranked.empty(); ++i) cpus.push_back(ranked[i % ranked.size()].second.cpu);
+    return cpus;
+}
+
+int current_cpu() { return sched_getcpu(); }
+
+int current_node() {
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+    return static_cast<int>(node);
+}
+
+bool pin_thread(pthread_t thread_, const std::vector<int> &cpus_) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus_) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(thread_, sizeof(set), &set) == 0;
+}
+
+bool prefer_node_memory(int node_) {
+    if (node_ < 0 || node_ >= 64) return false;
+    unsigned long mask = 1UL << node_;
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, 64) == 0;
+}
+}  // namespace frenzy
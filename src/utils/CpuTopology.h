@@ -0,0 +1,63 @@
+#ifndef CONCURRENT_CPU_TOPOLOGY_H
+#define CONCURRENT_CPU_TOPOLOGY_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace frenzy {
+
+struct CpuInfo {
+    int cpu;
+    int core;     // core_id, unique within a package
+    int package;  // socket
+    int node;     // numa node, 0 without numa
+};
+
+/**
+ * cpus, cores, sockets and numa nodes as /sys reports them, limited to the online cpus in the process affinity mask.
+ * instance() reads it once, the constructor takes another root for tests.
+ */
+class CpuTopology {
+public:
+    explicit CpuTopology(const std::string &sysRoot_ = "/sys/devices/system", bool affinityOnly_ = true);
+
+    static const CpuTopology &instance();
+
+    const std::vector<CpuInfo> &cpus() const { return infos; }
+
+    int node_count() const { return nodes; }
+
+    // -1 if unknown
+    int node_of(int cpu_) const;
+
+    std::vector<int> node_cpus(int node_) const;
+
+    /**
+     * cpus for pinning n workers: every physical core node by node, then their hyperthread siblings.
+     * cpus in exclude_, e.g. ones isolated for latency critical threads, are left out.
+     * n_ 0 is one per usable cpu, a larger n_ wraps around.
+     */
+    std::vector<int> placement(size_t n_, const std::vector<int> &exclude_ = {}) const;
+
+private:
+    std::vector<CpuInfo> infos;
+    int nodes{1};
+};
+
+// "0-3,8,10-11" as in /sys cpu lists and isolcpus
+std::vector<int> parse_cpu_list(const std::string &list_);
+
+// cpu and numa node the calling thread runs on now
+int current_cpu();
+int current_node();
+
+// false if the cpus are not allowed
+bool pin_thread(pthread_t thread_, const std::vector<int> &cpus_);
+inline bool pin_current_thread(int cpu_) { return pin_thread(pthread_self(), {cpu_}); }
+
+// pages first touched by the calling thread come from node_ when it has free memory, false without numa
+bool prefer_node_memory(int node_);
+}  // namespace frenzy
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CONCURRENT_FUTEX_H
+#define CONCURRENT_FUTEX_H
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+namespace frenzy {
+
+/**
+ * thin wrappers of futex(2), shared versions work across processes when the word lives in shared memory
+ */
+
+/**
+ * block while *word_ == expected_
+ * @param timeoutNs_ relative timeout in nanoseconds, negative means wait forever
+ * @return false on timeout
+ */
+inline bool futex_wait(std::atomic<uint32_t> *word_, uint32_t expected_, int64_t timeoutNs_ = -1,
+                       bool shared_ = true) {
+    struct timespec ts;
+    struct timespec *pts = nullptr;
+    if (timeoutNs_ >= 0) {
+        ts.tv_sec = timeoutNs_ / 1000000000L;
+        ts.tv_nsec = timeoutNs_ % 1000000000L;
+        pts = &ts;
+    }
+    int op = shared_ ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+    long ret = syscall(SYS_futex, reinterpret_cast<uint32_t *>(word_), op, expected_, pts, nullptr, 0);
+    return !(ret == -1 && errno == ETIMEDOUT);
+}
+
+/**
+ * @return number of waiters woken up
+ */
+inline int futex_wake(std::atomic<uint32_t> *word_, int count_ = INT_MAX, bool shared_ = true) {
+    int op = shared_ ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    return static_cast<int>(syscall(SYS_futex, reinterpret_cast<uint32_t *>(word_), op, count_, nullptr, nullptr, 0));
+}
+}  // namespace frenzy
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef CONCURRENT_TIMESTAMP_FORMATTER_H
+#define CONCURRENT_TIMESTAMP_FORMATTER_H
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include "utils/TscClock.h"
+
+namespace frenzy {
+
+/**
+ * "YYYY-MM-DD HH:MM:SS.ffffff" in local time for log lines.
+ * the date time prefix is rendered by localtime_r once per second and cached, only the fraction is
+ * converted per call, two digits at a time from a table. one instance per thread, it is not thread safe.
+ */
+class TimestampFormatter {
+public:
+    static constexpr size_t PrefixLength = 19;                 // YYYY-MM-DD HH:MM:SS
+    static constexpr size_t MaxLength = PrefixLength + 1 + 9;  // with nanoseconds
+
+    /**
+     * @param digits_ fraction digits, 3 milliseconds, 6 microseconds, 9 nanoseconds, 0 none
+     */
+    explicit TimestampFormatter(uint32_t digits_ = 6) : digits{digits_ > 9 ? 9 : digits_} {}
+
+    /**
+     * write the timestamp of realtimeNs_ (ns since epoch) into out_, which holds at least MaxLength chars
+     * @return length written, out_ is not null terminated
+     */
+    size_t format(int64_t realtimeNs_, char *out_) {
+        int64_t sec = realtimeNs_ / 1000000000L;
+        uint32_t frac = static_cast<uint32_t>(realtimeNs_ - sec * 1000000000L);
+        if (sec != cachedSec) render_prefix(sec);
+        memcpy(out_, prefix, PrefixLength);
+        if (digits == 0) return PrefixLength;
+
+        char digitsBuf[10];
+        write_fraction(frac, digitsBuf);
+        out_[PrefixLength] = '.';
+        memcpy(out_ + PrefixLength + 1, digitsBuf, digits);
+        return PrefixLength + 1 + digits;
+    }
+
+    size_t format(const timespec &ts_, char *out_) { return format(ts_.tv_sec * 1000000000L + ts_.tv_nsec, out_); }
+
+    std::string to_string(int64_t realtimeNs_) {
+        char buf[MaxLength];
+        return std::string(buf, format(realtimeNs_, buf));
+    }
+
+    /**
+     * tsc ticks from rdtsc, mapped to realtime by TscClock
+     */
+    size_t format_tsc(uint64_t tsc_, char *out_) { return format(TscClock::instance().to_ns(tsc_), out_); }
+
+    // realtime in ns without a syscall
+    static int64_t now_ns() { return TscClock::instance().now_ns(); }
+
+private:
+    void render_prefix(int64_t sec_) {
+        time_t t = static_cast<time_t>(sec_);
+        struct tm tm;
+        localtime_r(&t, &tm);
+        uint32_t year = static_cast<uint32_t>(tm.tm_year + 1900);
+        write2(prefix, year / 100);
+        write2(prefix + 2, year % 100);
+        prefix[4] = '-';
+        write2(prefix + 5, static_cast<uint32_t>(tm.tm_mon + 1));
+        prefix[7] = '-';
+        write2(prefix + 8, static_cast<uint32_t>(tm.tm_mday));
+        prefix[10] = ' ';
+        write2(prefix + 11, static_cast<uint32_t>(tm.tm_hour));
+        prefix[13] = ':';
+        write2(prefix + 14, static_cast<uint32_t>(tm.tm_min));
+        prefix[16] = ':';
+        write2(prefix + 17, static_cast<uint32_t>(tm.tm_sec));
+        cachedSec = sec_;
+    }
+
+    // all nine digits of the nanoseconds, the caller keeps the leading ones it needs
+    static void write_fraction(uint32_t ns_, char *out_) {
+        uint32_t hi = ns_ / 100000;  // first four digits
+        uint32_t lo = ns_ % 100000;  // last five digits
+        write2(out_, hi / 100);
+        write2(out_ + 2, hi % 100);
+        write2(out_ + 4, lo / 1000);
+        write2(out_ + 6, lo / 10 % 100);
+        out_[8] = static_cast<char>('0' + lo % 10);
+    }
+
+    static void write2(char *out_, uint32_t v_) { memcpy(out_, DigitPairs + v_ * 2, 2); }
+
+    static constexpr const char *DigitPairs =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    uint32_t digits;
+    int64_t cachedSec{INT64_MIN};
+    char prefix[PrefixLength];
+};
+}  // namespace frenzy
+
+#endif
@@ -104,6 +104,11 @@ namespace frenzy {
         const static TypeIndex type = TypeIndex::uint64_type;
     };
 
+    template<size_t N>
+    struct TypeIndexStruct<char[N]> {
+        const static TypeIndex type = TypeIndex::char_array_type;
+    };
+
     template<typename ValueType, typename AllocType>
     struct TypeIndexStruct<std::vector<ValueType, AllocType>> {
         const static TypeIndex type = TypeIndex::vector_type;
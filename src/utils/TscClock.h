@@ -0,0 +1,261 @@
+#ifndef CONCURRENT_TSC_CLOCK_H
+#define CONCURRENT_TSC_CLOCK_H
+
+#include <cpuid.h>
+#include <x86intrin.h>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include "lockfree/SeqLock.h"
+#include "media/SharedMemory.h"
+#include "utils/Singleton.h"
+
+namespace frenzy {
+
+/**
+ * tsc to CLOCK_REALTIME conversion, ns = ns0 + ((tsc - tsc0) * mult) >> shift
+ */
+struct TscParams {
+    uint64_t tsc0{0};
+    int64_t ns0{0};
+    uint64_t mult{0};
+    uint32_t shift{32};
+    uint32_t generation{0};  // bumped on every re-anchor
+    uint64_t reanchorTicks{0};
+};
+
+/**
+ * syscall free realtime nanoseconds from rdtsc.
+ * calibrated against CLOCK_REALTIME on first use, the anchor moves about once a second so the ratio follows
+ * NTP corrections. parameters are read through a SeqLock, readers never block.
+ * a calibrator process can publish its parameters in shared memory, every process attached to it shares one
+ * consistent clock, see zergtool/tools/tsc_calibrator.cpp.
+ * without an invariant tsc now_ns falls back to clock_gettime, tick durations stay approximate.
+ */
+class TscClock {
+public:
+    static constexpr uint32_t Magic = 0x75C0C10C;
+    static constexpr int64_t ReanchorNs = 1000L * 1000 * 1000;
+    static constexpr int64_t CalibrateNs = 10L * 1000 * 1000;  // shortest baseline a ratio is measured over
+    static constexpr const char *DefaultName = "frenzy_tsc_clock";
+
+    struct Shared {
+        uint32_t magic{Magic};
+        std::atomic<int32_t> publisherPid{0};
+        SeqLock<TscParams> params;
+    };
+
+    /**
+     * uses the clock published under DefaultName if its calibrator is alive, calibrates locally otherwise
+     */
+    TscClock() : invariant{has_invariant_tsc()} {
+        params.store(&localParams, std::memory_order_release);
+        if (!attach(DefaultName)) calibrate();
+        known_ticks_per_us().store(ns_to_ticks(1000), std::memory_order_relaxed);
+    }
+
+    static TscClock &instance() { return Singleton<TscClock>::instance(); }
+
+    static uint64_t ticks() { return __rdtsc(); }
+
+    int64_t now_ns() {
+        if (!invariant) return realtime_ns();
+        uint64_t tsc = __rdtsc();
+        TscParams p = source()->load();
+        if (tsc - p.tsc0 >= p.reanchorTicks) maybe_reanchor(tsc, p);
+        return convert(p, tsc);
+    }
+
+    // realtime of a tsc read earlier, e.g. stored in a log record
+    int64_t to_ns(uint64_t tsc_) const { return convert(source()->load(), tsc_); }
+
+    // duration of a tick delta
+    int64_t ticks_to_ns(uint64_t ticks_) const {
+        TscParams p = source()->load();
+        return static_cast<int64_t>((static_cast<unsigned __int128>(ticks_) * p.mult) >> p.shift);
+    }
+
+    uint64_t ns_to_ticks(int64_t ns_) const {
+        TscParams p = source()->load();
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(ns_) << p.shift) / p.mult);
+    }
+
+    /**
+     * rough tick count of a short timeout, never calibrates nor attaches a calibrator.
+     * ratio of the clock if one was built already, the nominal cpuid frequency otherwise.
+     */
+    static uint64_t approx_ns_to_ticks(uint64_t ns_) {
+        uint64_t perUs = known_ticks_per_us().load(std::memory_order_relaxed);
+        if (perUs == 0) perUs = nominal_ticks_per_us();
+        return ns_ * perUs / 1000;
+    }
+
+    double ticks_per_ns() const {
+        TscParams p = source()->load();
+        return static_cast<double>(1ULL << p.shift) / static_cast<double>(p.mult);
+    }
+
+    TscParams get_params() const { return source()->load(); }
+    bool is_invariant() const { return invariant; }
+
+    /**
+     * become the calibrator, create name_ in /dev/shm and keep it up to date from recalibrate(),
+     * which also renews the lease, so it must run more often than SharedMemory::DefaultLeaseNs
+     */
+    void publish(const std::string &name_) {
+        std::unique_ptr<SharedMemory> sm(new SharedMemory(
+            SharedMemory::create_or_takeover_shared_memory(name_, sizeof(Shared), SharedMemory::DefaultLeaseNs)));
+        Shared *s = new (sm->buffer) Shared;
+        s->params.store(source()->load());
+        s->publisherPid.store(getpid(), std::memory_order_release);
+        shmSpace = std::move(sm);
+        params.store(&s->params, std::memory_order_release);
+    }
+
+    /**
+     * read the parameters of a calibrator instead of calibrating locally
+     * @return false if name_ is not there or its calibrator is gone, the local clock is kept then
+     */
+    bool attach(const std::string &name_) {
+        std::unique_ptr<SharedMemory> sm;
+        try {
+            sm.reset(new SharedMemory(SharedMemory::attach_shared_memory(name_)));
+        } catch (const std::exception &) {
+            return false;
+        }
+        Shared *s = reinterpret_cast<Shared *>(sm->buffer);
+        if (sm->capacity() < sizeof(Shared) || s->magic != Magic || !sm->is_owner_alive()) return false;
+        shm = std::move(sm);
+        params.store(&s->params, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * re-anchor on CLOCK_REALTIME, calibrator calls it periodically, local clocks do it by themselves
+     */
+    void recalibrate() {
+        while (reanchoring.test_and_set(std::memory_order_acquire)) asm volatile("pause" ::: "memory");
+        reanchor();
+        reanchoring.clear(std::memory_order_release);
+        if (shmSpace) shmSpace->heartbeat();
+    }
+
+    static int64_t realtime_ns() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec * 1000000000L + ts.tv_nsec;
+    }
+
+    static bool has_invariant_tsc() {
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) return false;
+        return (edx & (1U << 8)) != 0;
+    }
+
+private:
+    static std::atomic<uint64_t> &known_ticks_per_us() {
+        static std::atomic<uint64_t> perUs{0};  // constant initialized, no guard
+        return perUs;
+    }
+
+    // tsc frequency from cpuid leaf 0x15, or the base frequency of leaf 0x16, 3GHz if neither is reported
+    static uint64_t nominal_ticks_per_us() {
+        static const uint64_t perUs = [] {
+            unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+            if (__get_cpuid_count(0x15, 0, &eax, &ebx, &ecx, &edx) != 0 && eax != 0 && ebx != 0 && ecx != 0) {
+                return static_cast<uint64_t>(ecx) * ebx / eax / 1000000;
+            }
+            if (__get_cpuid_count(0x16, 0, &eax, &ebx, &ecx, &edx) != 0 && (eax & 0xFFFF) != 0) {
+                return static_cast<uint64_t>(eax & 0xFFFF);  // MHz
+            }
+            return static_cast<uint64_t>(3000);
+        }();
+        return perUs;
+    }
+
+    static int64_t convert(const TscParams &p_, uint64_t tsc_) {
+        __int128 delta = static_cast<int64_t>(tsc_ - p_.tsc0);  // negative if read before the anchor moved
+        return p_.ns0 + static_cast<int64_t>((delta * static_cast<__int128>(p_.mult)) >> p_.shift);
+    }
+
+    // clock read bracketed by two rdtsc, midpoint taken, retried if preempted in between
+    static int64_t sample(uint64_t &tsc_) {
+        int64_t ns = 0;
+        uint64_t best = UINT64_MAX;
+        for (int i = 0; i < 5; ++i) {
+            uint64_t before = __rdtsc();
+            int64_t now = realtime_ns();
+            uint64_t after = __rdtsc();
+            if (after - before < best) {
+                best = after - before;
+                tsc_ = before + (after - before) / 2;
+                ns = now;
+            }
+        }
+        return ns;
+    }
+
+    // first estimate over a CalibrateNs spin, refined on every re-anchor over a longer baseline
+    void calibrate() {
+        uint64_t tsc1 = 0, tsc2 = 0;
+        int64_t ns1 = sample(tsc1);
+        int64_t ns2;
+        do {
+            ns2 = sample(tsc2);
+        } while (ns2 - ns1 < CalibrateNs);
+        TscParams p;
+        p.mult = mult_of(ns2 - ns1, tsc2 - tsc1, p.shift);
+        p.tsc0 = tsc2;
+        p.ns0 = ns2;
+        p.reanchorTicks = (static_cast<unsigned __int128>(ReanchorNs) << p.shift) / p.mult;
+        source()->store(p);
+    }
+
+    SeqLock<TscParams> *source() const { return params.load(std::memory_order_acquire); }
+
+    // local clocks re-anchor, attached ones fall back to a local calibration if the calibrator stops
+    void maybe_reanchor(uint64_t tsc_, const TscParams &p_) {
+        bool attached = shm != nullptr && source() != &localParams;
+        if (attached && tsc_ - p_.tsc0 < 3 * p_.reanchorTicks) return;
+        if (reanchoring.test_and_set(std::memory_order_acquire)) return;  // another thread is on it
+        if (attached) {
+            localParams.store(p_);  // the mapping stays, late readers of the old pointer are fine
+            params.store(&localParams, std::memory_order_release);
+        }
+        TscParams p = source()->load();
+        if (__rdtsc() - p.tsc0 >= p.reanchorTicks) reanchor();
+        reanchoring.clear(std::memory_order_release);
+    }
+
+    // single writer, guarded by reanchoring
+    void reanchor() {
+        TscParams old = source()->load();
+        uint64_t tsc = 0;
+        int64_t ns = sample(tsc);
+        int64_t extrapolated = convert(old, tsc);
+        TscParams p = old;
+        // a short baseline, e.g. back to back recalibrate() calls, would only add noise to the ratio
+        if (tsc > old.tsc0 && ns - old.ns0 >= CalibrateNs) p.mult = mult_of(ns - old.ns0, tsc - old.tsc0, p.shift);
+        p.tsc0 = tsc;
+        p.ns0 = ns > extrapolated ? ns : extrapolated;  // never step back, the new ratio absorbs the difference
+        p.reanchorTicks = (static_cast<unsigned __int128>(ReanchorNs) << p.shift) / p.mult;
+        ++p.generation;
+        source()->store(p);
+    }
+
+    static uint64_t mult_of(int64_t ns_, uint64_t ticks_, uint32_t shift_) {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(ns_) << shift_) / ticks_);
+    }
+
+    bool invariant;
+    SeqLock<TscParams> localParams;
+    std::atomic<SeqLock<TscParams> *> params{nullptr};  // localParams, or the segment of a calibrator
+    std::atomic_flag reanchoring = ATOMIC_FLAG_INIT;
+    std::unique_ptr<SharedMemory> shm;       // attached, read only while the calibrator is alive
+    std::unique_ptr<SharedMemory> shmSpace;  // published, this process is the calibrator
+};
+}  // namespace frenzy
+
+#endif
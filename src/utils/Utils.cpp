@@ -1,14 +1,12 @@
 #include "Utils.h"
+#include "TimestampFormatter.h"
 
 namespace frenzy {
 
 std::string timespec2string(const timespec& ts) {
-    struct tm tm;
-    localtime_r(&ts.tv_sec, &tm);
-    char buffer[32];
-    std::snprintf(buffer, sizeof buffer, "%4u-%02u-%02u %02u:%02u:%02u.%06u", tm.tm_year + 1900, tm.tm_mon + 1,
-                  tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<uint16_t>(ts.tv_nsec / 1000000));
-    return std::string(buffer);
+    thread_local TimestampFormatter formatter{6};
+    char buffer[TimestampFormatter::MaxLength];
+    return std::string(buffer, formatter.format(ts, buffer));
 }
 
 std::string time_string() {
@@ -1,3 +1,12 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utils/CpuTopology.h>
+#include <utils/TimestampFormatter.h>
+#include <utils/TscClock.h>
+#include <fstream>
+#include <thread>
 #include <utils/Utils.h>
 #include "catch.hpp"
 
@@ -11,3 +20,142 @@ TEST_CASE("utils functions", "[utils]") {
     REQUIRE(nextPowerOf2(16) == 16);
     REQUIRE(nextPowerOf2(17) == 32);
 }
+
+TEST_CASE("timestamp formatter", "[utils]") {
+    int64_t ns = 1700000000L * 1000000000L + 1234567L;
+    time_t t = 1700000000L;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    char expect[32];
+    strftime(expect, sizeof(expect), "%Y-%m-%d %H:%M:%S", &tm);
+
+    TimestampFormatter micro;
+    REQUIRE(micro.to_string(ns) == std::string(expect) + ".001234");
+    REQUIRE(micro.to_string(ns + 1000000000L - 1234567L) != micro.to_string(ns));  // next second re-renders
+    TimestampFormatter milli{3};
+    REQUIRE(milli.to_string(ns) == std::string(expect) + ".001");
+    TimestampFormatter nano{9};
+    REQUIRE(nano.to_string(ns) == std::string(expect) + ".001234567");
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t real = ts.tv_sec * 1000000000L + ts.tv_nsec;
+    int64_t tsc = micro.now_ns();
+    REQUIRE(std::abs(tsc - real) < 50 * 1000 * 1000);
+}
+
+TEST_CASE("cpu topology", "[utils]") {
+    REQUIRE(parse_cpu_list("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(parse_cpu_list("").empty());
+
+    // two sockets, two cores each with two hyperthreads, cpu n + 4 is the sibling of cpu n
+    std::string root = "/tmp/test_cpu_topology." + std::to_string(getpid());
+    auto write = [](const std::string& path, const std::string& text) { std::ofstream(path) << text << "\n"; };
+    mkdir(root.c_str(), 0755);
+    mkdir((root + "/cpu").c_str(), 0755);
+    mkdir((root + "/node").c_str(), 0755);
+    write(root + "/cpu/online", "0-7");
+    for (int cpu = 0; cpu < 8; ++cpu) {
+        std::string dir = root + "/cpu/cpu" + std::to_string(cpu);
+        mkdir(dir.c_str(), 0755);
+        mkdir((dir + "/topology").c_str(), 0755);
+        write(dir + "/topology/core_id", std::to_string(cpu % 2));
+        write(dir + "/topology/physical_package_id", std::to_string(cpu % 4 / 2));
+    }
+    for (int node = 0; node < 2; ++node) {
+        mkdir((root + "/node/node" + std::to_string(node)).c_str(), 0755);
+        write(root + "/node/node" + std::to_string(node) + "/cpulist", node == 0 ? "0-1,4-5" : "2-3,6-7");
+    }
+
+    CpuTopology topology(root, false);
+    REQUIRE(topology.cpus().size() == 8);
+    REQUIRE(topology.node_count() == 2);
+    REQUIRE(topology.node_of(6) == 1);
+    REQUIRE(topology.node_cpus(0) == std::vector<int>{0, 1, 4, 5});
+    REQUIRE(topology.placement(0) == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7});
+    REQUIRE(topology.placement(3, {1}) == std::vector<int>{0, 5, 2});  // 5 is alone on its core now
+    REQUIRE(system(("rm -rf " + root).c_str()) == 0);
+
+    REQUIRE(CpuTopology::instance().cpus().size() >= 1);
+    REQUIRE(CpuTopology::instance().node_of(current_cpu()) >= 0);
+}
+
+TEST_CASE("tsc clock publish and attach", "[utils]") {
+    if (!TscClock::has_invariant_tsc()) return;
+    std::string name = "test_tsc_clock." + std::to_string(getpid());
+    TscClock calibrator;
+    calibrator.publish(name);
+    TscClock reader;
+    REQUIRE(reader.attach(name));
+    REQUIRE(reader.get_params().mult == calibrator.get_params().mult);
+    REQUIRE(std::abs(reader.now_ns() - calibrator.now_ns()) < 1000 * 1000);
+
+    calibrator.recalibrate();  // readers follow every re-anchor of the calibrator
+    REQUIRE(reader.get_params().generation == calibrator.get_params().generation);
+
+    // a calibrator which crashed is not attached
+    std::string dead = name + ".dead";
+    pid_t child = fork();
+    if (child == 0) {
+        TscClock clock;
+        clock.publish(dead);
+        _exit(0);
+    }
+    waitpid(child, nullptr, 0);
+    TscClock orphan;
+    REQUIRE_FALSE(orphan.attach(dead));
+    shm_unlink(dead.c_str());
+    shm_unlink(name.c_str());
+}
+
+TEST_CASE("tsc clock stale calibrator fallback", "[utils]") {
+    if (!TscClock::has_invariant_tsc()) return;
+    std::string name = "test_tsc_stale." + std::to_string(getpid());
+    TscClock calibrator;
+    calibrator.publish(name);
+    TscClock reader;
+    REQUIRE(reader.attach(name));
+
+    // calibrator stops re-anchoring, its anchor ages past 3 re-anchor periods
+    SharedMemory shm = SharedMemory::attach_shared_memory(name);
+    auto shared = reinterpret_cast<TscClock::Shared*>(shm.buffer);
+    TscParams p = shared->params.load();
+    uint64_t age = 4 * p.reanchorTicks;
+    p.tsc0 -= age;
+    p.ns0 -= calibrator.ticks_to_ns(age);
+    shared->params.store(p);
+
+    int64_t real = TscClock::realtime_ns();
+    int64_t ns = reader.now_ns();  // falls back to a local clock seeded with the last parameters
+    REQUIRE(std::abs(ns - real) < 1000 * 1000);
+    uint32_t generation = reader.get_params().generation;
+    REQUIRE(generation == p.generation + 1);
+
+    p.mult = 1;  // whatever the segment says now, the reader is on its own
+    shared->params.store(p);
+    REQUIRE(reader.get_params().mult != 1);
+    REQUIRE(std::abs(reader.now_ns() - TscClock::realtime_ns()) < 1000 * 1000);
+    shm_unlink(name.c_str());
+}
+
+TEST_CASE("tsc clock reanchor", "[utils]") {
+    if (!TscClock::has_invariant_tsc()) return;
+    TscClock clock;
+    clock.attach("test_tsc_missing." + std::to_string(getpid()));  // stays local
+    TscParams first = clock.get_params();
+    int64_t last = clock.now_ns();
+    for (int i = 0; i < 5; ++i) {
+        clock.recalibrate();
+        int64_t ns = clock.now_ns();
+        REQUIRE(ns >= last);  // a re-anchor never steps back
+        last = ns;
+    }
+    REQUIRE(clock.get_params().generation == first.generation + 5);
+
+    // a local clock re-anchors by itself once a period passed
+    std::this_thread::sleep_for(std::chrono::nanoseconds(TscClock::ReanchorNs + 100 * 1000 * 1000));
+    clock.now_ns();
+    REQUIRE(clock.get_params().generation == first.generation + 6);
+    REQUIRE(std::abs(clock.now_ns() - TscClock::realtime_ns()) < 1000 * 1000);
+    REQUIRE(TscClock::approx_ns_to_ticks(1000 * 1000) > 0);
+}
@@ -0,0 +1,243 @@
+#include <container/CircularBuffer.h>
+#include <container/FlatView.h>
+#include <poll.h>
+#include <unistd.h>
+#include <thread>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+using SeqBuffer = CircularBuffer<HeapMemory, uint8_t, SequencedTraits<FlatStructTraits<uint64_t>>>;
+
+TEST_CASE("CircularBuffer sequenced read write", "[CircularBuffer]") {
+    HeapMemory space{4096};
+    SeqBuffer rb{std::move(space), true};
+
+    REQUIRE(rb.last_seq() == 0);
+    for (uint64_t i = 1; i <= 10; ++i) REQUIRE(rb.write(i * 100));
+    REQUIRE(rb.writer_seq() == 10);
+
+    uint64_t value = 0;
+    REQUIRE(rb.read(value));
+    REQUIRE(value == 100);
+    REQUIRE(rb.last_seq() == 1);
+
+    std::vector<uint64_t> values;
+    REQUIRE(rb.read(values, 100) == 9);
+    REQUIRE(values.back() == 1000);
+    REQUIRE(rb.last_seq() == 10);
+    REQUIRE_FALSE(rb.read(value));
+}
+
+TEST_CASE("CircularBuffer sequenced seek in ring", "[CircularBuffer]") {
+    HeapMemory space{4096};
+    SeqBuffer rb{std::move(space), true};
+    for (uint64_t i = 1; i <= 10; ++i) rb.write(i);
+
+    REQUIRE(rb.seek(6));
+    uint64_t value = 0;
+    REQUIRE(rb.read(value));
+    REQUIRE(value == 6);
+    REQUIRE(rb.last_seq() == 6);
+
+    REQUIRE(rb.seek(11));  // next one to be written
+    REQUIRE_FALSE(rb.read(value));
+    REQUIRE_FALSE(rb.seek(20));
+    REQUIRE_FALSE(rb.seek(3));  // consumed already and no journal
+}
+
+TEST_CASE("CircularBuffer sequenced gap and journal replay", "[CircularBuffer]") {
+    std::string path = "/tmp/frenzy_test_journal." + std::to_string(getpid());
+    unlink(path.c_str());
+
+    std::vector<uint8_t> memory(4096);
+    SeqBuffer writer{HeapMemory{memory.data(), 4096}, true};
+    writer.enable_journal(path, true);
+    for (uint64_t i = 1; i <= 5; ++i) writer.write(i);
+
+    // late reader attaches to the same ring, first 5 records are consumed before it comes
+    uint64_t value = 0;
+    for (int i = 0; i < 5; ++i) writer.read(value);
+    for (uint64_t i = 6; i <= 8; ++i) writer.write(i);
+
+    SeqBuffer reader{HeapMemory{memory.data(), 4096}};
+    reader.enable_journal(path, false);
+    uint64_t gapFrom = 0, gapTo = 0;
+    reader.on_gap([&](uint64_t from_, uint64_t to_) {
+        gapFrom = from_;
+        gapTo = to_;
+        REQUIRE(reader.seek(from_));
+    });
+
+    std::vector<uint64_t> values;
+    REQUIRE(reader.read(values, 100) == 8);
+    REQUIRE(gapFrom == 1);
+    REQUIRE(gapTo == 5);
+    for (uint64_t i = 0; i < 8; ++i) REQUIRE(values[i] == i + 1);
+    REQUIRE(reader.last_seq() == 8);
+    unlink(path.c_str());
+}
+
+TEST_CASE("CircularBuffer sequenced journal write failure", "[CircularBuffer]") {
+    HeapMemory space{4096};
+    SeqBuffer rb{std::move(space), true};
+    rb.write(uint64_t(1));
+    rb.enable_journal("/dev/full", true);  // every write fails with ENOSPC
+    REQUIRE_FALSE(rb.write(uint64_t(2)));
+    REQUIRE(rb.writer_seq() == 1);  // not committed, so no hole behind it
+    uint64_t value = 0;
+    REQUIRE(rb.read(value));
+    REQUIRE_FALSE(rb.read(value));
+}
+
+struct NamesView {
+    uint32_t id;
+    FlatString name;
+    FlatVector<int32_t> values;
+};
+
+struct Names {
+    uint32_t id;
+    std::string name;
+    std::vector<int32_t> values;
+};
+
+struct NamesSerializer {
+    using Builder = FlatBuilder<NamesView>;
+    static uint32_t size(const Names &n_) {
+        return Builder::fixed_size() + Builder::string_size(static_cast<uint32_t>(n_.name.size())) +
+               Builder::vector_size<int32_t>(static_cast<uint32_t>(n_.values.size()));
+    }
+    Buffer serialize(const Names &n_, uint8_t *space_) {
+        Builder builder{space_, size(n_)};
+        builder.root()->id = n_.id;
+        builder.set(builder.root()->name, n_.name);
+        builder.set(builder.root()->values, n_.values);
+        return {space_, builder.finish()};
+    }
+    static std::pair<const NamesView *, uint32_t> view(const uint8_t *buffer_, uint32_t length_) {
+        return flat_view<NamesView>(buffer_, length_);
+    }
+    static uint32_t recordSize() { return 0; }
+};
+
+TEST_CASE("CircularBuffer zero copy view", "[CircularBuffer]") {
+    HeapMemory space{4096};
+    CircularBuffer<HeapMemory, uint8_t, ZeroCopyTraits<Names, NamesSerializer>> rb{std::move(space), true};
+
+    REQUIRE(rb.write(Names{7, "hello", {1, 2, 3}}));
+    REQUIRE(rb.write(Names{8, "", {}}));
+
+    bool called = false;
+    REQUIRE(rb.read_view([&](const NamesView &v_) {
+        called = true;
+        REQUIRE(v_.id == 7);
+        REQUIRE(v_.name.view() == "hello");
+        REQUIRE(v_.values.size() == 3);
+        REQUIRE(v_.values[2] == 3);
+    }));
+    REQUIRE(called);
+    REQUIRE(rb.read_view([&](const NamesView &v_) {
+        REQUIRE(v_.id == 8);
+        REQUIRE(v_.name.empty());
+        REQUIRE(v_.values.empty());
+    }));
+    REQUIRE_FALSE(rb.read_view([](const NamesView &) {}));
+}
+
+// room for the root only, every record with a string overflows and finish() returns 0
+struct RootOnlySerializer : NamesSerializer {
+    Buffer serialize(const Names &n_, uint8_t *space_) {
+        Builder builder{space_, Builder::fixed_size()};
+        builder.root()->id = n_.id;
+        builder.set(builder.root()->name, n_.name);
+        return {space_, builder.finish()};
+    }
+};
+
+TEST_CASE("CircularBuffer zero copy serializer failure", "[CircularBuffer]") {
+    HeapMemory space{4096};
+    CircularBuffer<HeapMemory, uint8_t, ZeroCopyTraits<Names, RootOnlySerializer>> rb{std::move(space), true};
+    REQUIRE_FALSE(rb.write(Names{7, "hello", {}}));
+    REQUIRE_FALSE(rb.read_view([](const NamesView &) {}));  // nothing was committed
+
+    HeapMemory sequencedSpace{4096};
+    CircularBuffer<HeapMemory, uint8_t, SequencedTraits<ZeroCopyTraits<Names, RootOnlySerializer>>> sequenced{
+        std::move(sequencedSpace), true};
+    REQUIRE_FALSE(sequenced.write(Names{7, "hello", {}}));
+    REQUIRE_FALSE(sequenced.read_view([](const NamesView &) {}));
+}
+
+// a complete record whose size prefix claims more than was written, view() refuses it
+struct OversizedSerializer : NamesSerializer {
+    Buffer serialize(const Names &n_, uint8_t *space_) {
+        Buffer b = NamesSerializer{}.serialize(n_, space_);
+        uint32_t size = b.length + 1;
+        if (n_.id == 0) memcpy(space_, &size, sizeof(size));
+        return b;
+    }
+};
+
+TEST_CASE("CircularBuffer zero copy view of a bad record", "[CircularBuffer]") {
+    HeapMemory space{4096};
+    CircularBuffer<HeapMemory, uint8_t, SequencedTraits<ZeroCopyTraits<Names, OversizedSerializer>>> sequenced{
+        std::move(space), true};
+    REQUIRE(sequenced.write(Names{0, "bad", {}}));
+    REQUIRE(sequenced.write(Names{1, "good", {}}));
+    uint32_t id = 0;
+    REQUIRE_FALSE(sequenced.read_view([&](const NamesView &v_) { id = v_.id; }));  // consumed, not stuck
+    REQUIRE(sequenced.read_view([&](const NamesView &v_) { id = v_.id; }));
+    REQUIRE(id == 1);
+
+    HeapMemory plainSpace{4096};
+    CircularBuffer<HeapMemory, uint8_t, ZeroCopyTraits<Names, OversizedSerializer>> plain{std::move(plainSpace), true};
+    REQUIRE(plain.write(Names{0, "bad", {}}));
+    REQUIRE_FALSE(plain.read_view([](const NamesView &) {}));
+    REQUIRE(plain.write(Names{2, "good", {}}));
+    REQUIRE(plain.read_view([&](const NamesView &v_) { id = v_.id; }));
+    REQUIRE(id == 2);
+}
+
+TEST_CASE("CircularBuffer wait for data", "[CircularBuffer]") {
+    HeapMemory space{4096};
+    CircularBuffer<HeapMemory, uint8_t, FlatStructTraits<uint64_t>> rb{std::move(space), true};
+
+    REQUIRE_FALSE(rb.wait_for_data(1000 * 1000));
+    std::thread writer([&rb] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        rb.write(uint64_t{42});
+    });
+    REQUIRE(rb.wait_for_data(5L * 1000 * 1000 * 1000));
+    uint64_t value = 0;
+    REQUIRE(rb.read(value));
+    REQUIRE(value == 42);
+    writer.join();
+}
+
+TEST_CASE("CircularBuffer event fd", "[CircularBuffer]") {
+    HeapMemory space{4096};
+    CircularBuffer<HeapMemory, uint8_t, FlatStructTraits<uint64_t>> rb{std::move(space), true};
+    int fd = rb.event_fd();
+    REQUIRE(fd >= 0);
+    pollfd pfd{fd, POLLIN, 0};
+    uint64_t counter = 0;
+    if (poll(&pfd, 1, 0) == 1) REQUIRE(read(fd, &counter, sizeof(counter)) == sizeof(counter));  // startup signal
+
+    uint64_t value = 0;
+    for (uint64_t round = 1; round <= 3; ++round) {
+        std::thread writer([&rb, round] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            for (uint64_t i = 0; i < 10; ++i) rb.write(round * 100 + i);
+        });
+        REQUIRE(poll(&pfd, 1, 5000) == 1);
+        REQUIRE(read(fd, &counter, sizeof(counter)) == sizeof(counter));
+        writer.join();
+        for (uint64_t i = 0; i < 10; ++i) {
+            REQUIRE(rb.read(value));
+            REQUIRE(value == round * 100 + i);
+        }
+        REQUIRE_FALSE(rb.read(value));
+        // a burst the reader has not seen yet is signalled again even when it raced the eventfd read
+        if (poll(&pfd, 1, 0) == 1) REQUIRE(read(fd, &counter, sizeof(counter)) == sizeof(counter));
+    }
+}
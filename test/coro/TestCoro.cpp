@@ -0,0 +1,113 @@
+#include <coro/EventLoop.h>
+#include <coro/Executor.h>
+#include "catch.hpp"
+
+#ifdef FRENZY_HAS_COROUTINES
+
+#include <unistd.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace frenzy;
+
+namespace {
+coro::Task<int> square(int x) { co_return x * x; }
+
+coro::Task<int> sum_of_squares(int n) {
+    int sum = 0;
+    for (int i = 1; i <= n; ++i) sum += co_await square(i);
+    co_return sum;
+}
+
+coro::Task<void> fail() {
+    co_await square(1);
+    throw std::runtime_error("failed");
+}
+
+coro::Task<std::thread::id> hop(coro::Executor &executor) {
+    co_await executor.schedule();
+    co_return std::this_thread::get_id();
+}
+}  // namespace
+
+TEST_CASE("coro task and executor", "[coro]") {
+    REQUIRE(coro::sync_wait(sum_of_squares(1000)) == 333833500);
+    REQUIRE_THROWS_AS(coro::sync_wait(fail()), std::runtime_error);
+
+    TaskScheduler scheduler(2);
+    coro::Executor executor(scheduler);
+    REQUIRE(coro::sync_wait(hop(executor)) != std::this_thread::get_id());
+
+    SimpleThreadPool pool(1);
+    pool.start();
+    coro::Executor single(pool);
+    REQUIRE(coro::sync_wait(hop(single)) != std::this_thread::get_id());
+
+    std::atomic<int> done{0};
+    for (int i = 0; i < 1000; ++i) {
+        coro::spawn(executor, [](std::atomic<int> &d) -> coro::Task<void> {
+            d.fetch_add(co_await square(2) - 3);
+        }(done));
+    }
+    while (done.load() < 1000) std::this_thread::yield();
+}
+
+TEST_CASE("coro event loop", "[coro]") {
+    coro::EventLoop loop;
+    std::vector<int> seen;
+
+    // timers
+    int64_t start = coro::EventLoop::now();
+    bool slept = false;
+    coro::spawn(loop, [](coro::EventLoop &l, int64_t at, bool &s) -> coro::Task<void> {
+        int64_t due = co_await l.sleep_until(at);
+        s = due == at && coro::EventLoop::now() >= at;
+    }(loop, start + 2000000, slept));
+
+    // a lock free queue filled by another thread
+    MpmcBoundedQueue<int> queue(64);
+    coro::spawn(loop, [](coro::EventLoop &l, MpmcBoundedQueue<int> &q, std::vector<int> &out) -> coro::Task<void> {
+        for (int i = 0; i < 3; ++i) out.push_back(co_await l.pop(q));
+    }(loop, queue, seen));
+
+    // fd readiness
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    char received = 0;
+    coro::spawn(loop, [](coro::EventLoop &l, int fd, char &out) -> coro::Task<void> {
+        uint32_t events = co_await l.readable(fd);
+        if ((events & EPOLLIN) != 0 && read(fd, &out, 1) != 1) out = 0;
+    }(loop, fds[0], received));
+
+    std::atomic<ssize_t> written{0};
+    std::thread producer([&] {
+        for (int i = 1; i <= 3; ++i) queue.push(i * 10);
+        written.store(write(fds[1], "x", 1));
+    });
+    while (!slept || seen.size() < 3 || received == 0) loop.run_once(1);
+    producer.join();
+    REQUIRE(written.load() == 1);
+    REQUIRE(seen == std::vector<int>{10, 20, 30});
+    REQUIRE(received == 'x');
+    loop.forget(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+
+    // back and forth between a pool and the loop
+    TaskScheduler scheduler(2);
+    coro::Executor executor(scheduler);
+    std::atomic<bool> back{false};
+    std::thread::id loopThread = std::this_thread::get_id();
+    coro::spawn(loop, [](coro::EventLoop &l, coro::Executor &e, std::thread::id t, std::atomic<bool> &b)
+                          -> coro::Task<void> {
+        co_await e.schedule();
+        bool away = std::this_thread::get_id() != t;
+        co_await l.schedule();
+        b.store(away && std::this_thread::get_id() == t);
+    }(loop, executor, loopThread, back));
+    while (!back.load()) loop.run_once(1);
+}
+
+#endif
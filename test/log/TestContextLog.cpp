@@ -1,4 +1,7 @@
-#include <log/ContextSaver.h>
+#include <log/ContextSaver.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <memory>
 #include "catch.hpp"
 
 using namespace std;
@@ -123,4 +126,121 @@ TEST_CASE("schedule", "[context saver]") {
     REQUIRE(var4 == result4);
     REQUIRE(var5 == result5);
     REQUIRE(var6 == result6);
-}
\ No newline at end of file
+}
+TEST_CASE("frame ring", "[context saver]") {
+    int counter = 0;
+    string text;
+    ContextSaver saver(4 * 256, 256);
+    REQUIRE(saver.frameCount() == 4);
+    saver.schedule(counter).schedule(text);
+    for (counter = 1; counter <= 10; ++counter) {
+        text = "frame " + to_string(counter);
+        saver.save();
+    }
+    REQUIRE(saver.lastFrame() == 10);
+
+    for (size_t back = 0; back < 4; ++back) {
+        int result = 0;
+        string resultText;
+        REQUIRE(saver.select(back));
+        saver.load(result).load(resultText);
+        REQUIRE(result == 10 - static_cast<int>(back));
+        REQUIRE(resultText == "frame " + to_string(result));
+        REQUIRE(saver.frameNumber() == 10 - back);
+    }
+    REQUIRE(!saver.select(4));  // overwritten
+
+    text.assign(1000, 'x');
+    saver.save();
+    REQUIRE(saver.select());
+    REQUIRE(saver.frameTruncated());
+}
+
+TEST_CASE("attach after crash", "[context saver]") {
+    string name = "test_context_saver." + to_string(getpid());
+    double price = 0;
+    {
+        ContextSaver saver(name, 64 * 1024);
+        saver.schedule(price);
+        for (int i = 0; i < 100; ++i) {
+            price = i * 0.5;
+            saver.save();
+        }
+    }
+    std::unique_ptr<ContextSaver> reader = ContextSaver::attach(name);
+    REQUIRE(reader != nullptr);
+    double result = 0;
+    REQUIRE(reader->select(1));
+    reader->load(result);
+    REQUIRE(result == 49.0);
+    shm_unlink(name.c_str());
+}
+
+TEST_CASE("schema", "[context saver]") {
+    int orderId = 0;
+    double price = 0;
+    char symbol[8] = "AAPL";
+    long quantity = 0;
+    ContextSchema<int, double, char[8], long> schema(orderId, price, symbol, quantity);
+    static_assert(decltype(schema)::Bytes == 4 + 8 + 8 + 8, "packed without padding");
+
+    ContextSaver saver(16 * 256, 256);
+    for (int i = 1; i <= 20; ++i) {
+        orderId = i;
+        price = i * 0.25;
+        quantity = i * 100;
+        saver.save(schema);
+    }
+
+    int resultId = 0;
+    double resultPrice = 0;
+    char resultSymbol[8] = {};
+    long resultQuantity = 0;
+    ContextSchema<int, double, char[8], long> out(resultId, resultPrice, resultSymbol, resultQuantity);
+    REQUIRE(saver.select(2));
+    REQUIRE(saver.load(out));
+    REQUIRE(resultId == 18);
+    REQUIRE(resultPrice == 4.5);
+    REQUIRE(std::strcmp(resultSymbol, "AAPL") == 0);
+    REQUIRE(resultQuantity == 1800);
+
+    // decoded by the header alone
+    REQUIRE(saver.fieldCount() == 4);
+    REQUIRE(saver.field(3).offset == 20);
+    long field = 0;
+    REQUIRE(saver.select());
+    REQUIRE(saver.loadField(3, field));
+    REQUIRE(field == 2000);
+    REQUIRE(!saver.loadField(1, field));  // a double
+}
+
+TEST_CASE("frames of two schemas", "[context saver]") {
+    int a = 1, b = 2;
+    long c = 0;
+    ContextSchema<int, int> pair(a, b);
+    ContextSchema<long> single(c);
+    static_assert(decltype(pair)::Bytes == decltype(single)::Bytes, "same size, different layout");
+    static_assert(decltype(pair)::Id != decltype(single)::Id, "ids tell them apart");
+
+    ContextSaver saver(16 * 256, 256);
+    saver.save(pair);
+    c = 42;
+    saver.save(single);
+
+    int resultA = 0, resultB = 0;
+    long resultC = 0;
+    ContextSchema<int, int> pairOut(resultA, resultB);
+    ContextSchema<long> singleOut(resultC);
+    REQUIRE(saver.select(1));
+    REQUIRE(!saver.load(singleOut));
+    REQUIRE(!saver.loadField(0, resultC));  // the layout in the header is the one of single now
+    REQUIRE(saver.load(pairOut));
+    REQUIRE(resultA == 1);
+    REQUIRE(resultB == 2);
+
+    REQUIRE(saver.select(0));
+    REQUIRE(!saver.load(pairOut));
+    REQUIRE(saver.loadField(0, resultC));
+    REQUIRE(resultC == 42);
+    REQUIRE(saver.load(singleOut));
+}
@@ -0,0 +1,190 @@
+#include <log/FileSink.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+namespace {
+std::string makeDir(const std::string& tag) {
+    std::string dir = "/tmp/test_file_sink_" + tag + "." + std::to_string(getpid());
+    mkdir(dir.c_str(), 0755);
+    return dir;
+}
+
+// files of dir, sorted by name, the active file sorts before the rotated ones
+std::vector<std::string> listDir(const std::string& dir) {
+    std::vector<std::string> files;
+    DIR* d = opendir(dir.c_str());
+    while (struct dirent* entry = readdir(d)) {
+        if (entry->d_name[0] != '.') files.push_back(dir + "/" + entry->d_name);
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+void removeDir(const std::string& dir) {
+    for (const auto& file : listDir(dir)) unlink(file.c_str());
+    rmdir(dir.c_str());
+}
+
+// sleep into the first half of a second, so a 1s rotation boundary is not crossed by accident
+void startOfSecond() {
+    struct timespec ts;
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        clock_gettime(CLOCK_REALTIME, &ts);
+    } while (ts.tv_nsec > 500 * 1000 * 1000);
+}
+
+std::string line(int i) { return "line " + std::to_string(i) + " " + std::string(90, 'x') + "\n"; }
+}  // namespace
+
+TEST_CASE("FileSink buffers until flush", "[FileSink]") {
+    std::string dir = makeDir("flush");
+    FileSinkOptions options;
+    options.flushIntervalMs = 60 * 1000;
+    {
+        FileSink sink(dir + "/log", options);
+        std::ostream os(&sink);
+        os << line(0) << std::flush;  // rate limited, still buffered
+        REQUIRE(readFile(dir + "/log").empty());
+        sink.flush();
+        REQUIRE(readFile(dir + "/log") == line(0));
+        os << line(1);
+    }
+    REQUIRE(readFile(dir + "/log") == line(0) + line(1));  // closing writes the tail
+    removeDir(dir);
+}
+
+TEST_CASE("FileSink size rotation", "[FileSink]") {
+    std::string dir = makeDir("size");
+    FileSinkOptions options;
+    options.rotateBytes = 4096;
+    std::string all;
+    {
+        FileSink sink(dir + "/log", options);
+        for (int i = 0; i < 200; ++i) {
+            sink.write(line(i).data(), line(i).size());
+            all += line(i);
+        }
+    }
+    std::vector<std::string> files = listDir(dir);
+    REQUIRE(files.size() >= 4);
+    std::string joined;
+    for (size_t i = 1; i < files.size(); ++i) {
+        std::string content = readFile(files[i]);
+        REQUIRE(content.size() <= options.rotateBytes);
+        REQUIRE(content.back() == '\n');  // cut at a line end
+        joined += content;
+    }
+    joined += readFile(files[0]);  // active file holds the newest lines
+    REQUIRE(joined == all);
+    removeDir(dir);
+}
+
+TEST_CASE("FileSink time rotation", "[FileSink]") {
+    std::string dir = makeDir("time");
+    FileSinkOptions options;
+    options.rotateSeconds = 1;
+    startOfSecond();
+    {
+        FileSink sink(dir + "/log", options);
+        sink.write(line(0).data(), line(0).size());
+        sink.flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        sink.flush();  // rotates on the first flush after the boundary
+        sink.write(line(1).data(), line(1).size());
+    }
+    std::vector<std::string> files = listDir(dir);
+    REQUIRE(files.size() == 2);
+    REQUIRE(readFile(files[0]) == line(1));
+    REQUIRE(readFile(files[1]) == line(0));
+    removeDir(dir);
+}
+
+#ifdef FRENZY_HAS_ZSTD
+TEST_CASE("FileSink zstd output", "[FileSink]") {
+    std::string dir = makeDir("zstd");
+    FileSinkOptions options;
+    options.compression = SinkCompression::Zstd;
+    std::string all;
+    {
+        FileSink sink(dir + "/log", options);
+        for (int i = 0; i < 1000; ++i) {
+            sink.write(line(i).data(), line(i).size());
+            all += line(i);
+            if (i % 100 == 0) sink.flush();
+        }
+    }
+    std::string packed = readFile(dir + "/log.zst");
+    REQUIRE(packed.size() < all.size());
+
+    ZSTD_DCtx* dctx = ZSTD_createDCtx();
+    std::string text;
+    std::vector<char> out(ZSTD_DStreamOutSize());
+    ZSTD_inBuffer in{packed.data(), packed.size(), 0};
+    while (true) {
+        ZSTD_outBuffer o{out.data(), out.size(), 0};
+        size_t ret = ZSTD_decompressStream(dctx, &o, &in);
+        REQUIRE_FALSE(ZSTD_isError(ret));
+        text.append(out.data(), o.pos);
+        if (in.pos == in.size && o.pos < o.size) break;  // all input taken and nothing left to flush
+    }
+    ZSTD_freeDCtx(dctx);
+    REQUIRE(text == all);
+    removeDir(dir);
+}
+#endif
+
+#ifdef FRENZY_HAS_LZ4
+TEST_CASE("FileSink lz4 output", "[FileSink]") {
+    std::string dir = makeDir("lz4");
+    FileSinkOptions options;
+    options.compression = SinkCompression::Lz4;
+    std::string all;
+    {
+        FileSink sink(dir + "/log", options);
+        for (int i = 0; i < 1000; ++i) {
+            sink.write(line(i).data(), line(i).size());
+            all += line(i);
+            if (i % 100 == 0) sink.flush();
+        }
+    }
+    std::string packed = readFile(dir + "/log.lz4");
+    REQUIRE(packed.size() < all.size());
+
+    LZ4F_dctx* dctx = nullptr;
+    REQUIRE_FALSE(LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)));
+    std::string text;
+    std::vector<char> out(64 * 1024);
+    size_t pos = 0;
+    size_t outSize = 0;
+    while (pos < packed.size() || outSize == out.size()) {
+        outSize = out.size();
+        size_t inSize = packed.size() - pos;
+        size_t ret = LZ4F_decompress(dctx, out.data(), &outSize, packed.data() + pos, &inSize, nullptr);
+        REQUIRE_FALSE(LZ4F_isError(ret));
+        text.append(out.data(), outSize);
+        pos += inSize;
+    }
+    LZ4F_freeDecompressionContext(dctx);
+    REQUIRE(text == all);
+    removeDir(dir);
+}
+#endif
@@ -0,0 +1,89 @@
+#include <log/ShmLog.h>
+#include <log/ShmLogDrainer.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+namespace {
+// "<i>:<filler>:<i>", the filler length and letter depend on i, so a torn record does not parse back
+std::string recordText(int i) {
+    std::string filler(50 + i % 1500, static_cast<char>('a' + i % 26));
+    return std::to_string(i) + ":" + filler + ":" + std::to_string(i);
+}
+
+bool intact(const std::string& line) {
+    size_t begin = line.find("]") + 1;
+    size_t first = line.find(':', begin);
+    if (begin == 0 || first == std::string::npos) return false;
+    int i = std::stoi(line.substr(begin, first - begin));
+    return line.compare(begin, std::string::npos, recordText(i)) == 0;
+}
+}  // namespace
+
+TEST_CASE("ShmLog drop oldest laps a slow drainer", "[ShmLog]") {
+    std::string name = "test_shm_log_lap." + std::to_string(getpid());
+    ShmLog log;
+    log.setDumpThread(false);
+    REQUIRE(log.initShm(name, 1 << 18, 2, SOP_DROP_OLDEST));
+    log.open("", SLP_INFO, false, false);
+
+    std::ostringstream out;
+    ShmLogDrainer drainer{log.pShm, &out};
+    std::atomic<bool> done{false};
+    std::thread slow([&] {
+        while (!done.load(std::memory_order_acquire)) {
+            drainer.drain(INT64_MAX);
+            usleep(200);
+        }
+        drainer.drainAll();
+    });
+    const int count = 20000;
+    for (int i = 0; i < count; ++i) log.log(SLP_INFO, __FILE__, __LINE__, "%s", recordText(i).c_str());
+    done.store(true, std::memory_order_release);
+    slow.join();
+
+    std::istringstream in(out.str());
+    std::string line;
+    int records = 0;
+    int torn = 0;
+    while (std::getline(in, line)) {
+        if (line.find("ShmLog lost") != std::string::npos) continue;
+        ++records;
+        if (!intact(line)) ++torn;
+    }
+    REQUIRE(log.pMeta->lostBytes.load() > 0);
+    REQUIRE(records > 0);
+    REQUIRE(records < count);
+    REQUIRE(torn == 0);
+    shm_unlink(name.c_str());
+}
+
+TEST_CASE("ShmLog drainer drops a record being overwritten", "[ShmLog]") {
+    std::string name = "test_shm_log_torn." + std::to_string(getpid());
+    ShmLog log;
+    log.setDumpThread(false);
+    REQUIRE(log.initShm(name, 1 << 18, 2, SOP_DROP_OLDEST));
+    log.open("", SLP_INFO, false, false);
+    for (int i = 0; i < 10; ++i) log.log(SLP_INFO, __FILE__, __LINE__, "%s", recordText(i).c_str());
+
+    // a writer lapping the drainer reserved the bytes of the first record and is halfway through its copy
+    ShmLogRegion* region = log.pRegions + 1;
+    REQUIRE(region->writePos.load() > 0);
+    uint8_t* ring = log.pData + log.pMeta->regionBytes;
+    memset(ring + sizeof(ShmRecordHeader), '#', 16);
+    region->reservePos.store(region->readPos.load() + log.pMeta->regionBytes + ShmRecordAlignment);
+
+    std::ostringstream out;
+    ShmLogDrainer drainer{log.pShm, &out};
+    REQUIRE(drainer.drain(INT64_MAX) == 9);
+    REQUIRE(out.str().find('#') == std::string::npos);
+    REQUIRE(out.str().find("ShmLog lost") != std::string::npos);
+    shm_unlink(name.c_str());
+}
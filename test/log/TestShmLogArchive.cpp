@@ -0,0 +1,97 @@
+#include <log/ShmLogArchive.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+namespace {
+ShmRecordHeader textHeader(int64_t tsNs, ShmLogPriority priority, const std::string& text) {
+    ShmRecordHeader header{};
+    header.tsNs = tsNs;
+    header.size = static_cast<uint32_t>(sizeof(ShmRecordHeader) + text.size() + 1);
+    header.priority = priority;
+    header.kind = SRK_TEXT;
+    return header;
+}
+}  // namespace
+
+TEST_CASE("archive index skips blocks", "[ShmLogArchive]") {
+    std::string path = "/tmp/test_shm_log_archive." + std::to_string(getpid()) + ".slb";
+    const int64_t start = 1700000000L * 1000000000L;
+    const int count = 20000;
+    {
+        ShmLogArchiveWriter writer(path);
+        for (int i = 0; i < count; ++i) {
+            std::string text = "line " + std::to_string(i) + std::string(100, '.');
+            ShmLogPriority priority = i % 100 == 0 ? SLP_ERROR : SLP_INFO;
+            writer.append(textHeader(start + i * 1000L, priority, text), text.c_str(), 100 + i % 4, nullptr);
+        }
+    }
+
+    ShmLogArchiveReader reader(path);
+    REQUIRE(reader.blockCount() > 10);
+    REQUIRE(reader.firstNs() == start);
+    REQUIRE(reader.lastNs() == start + (count - 1) * 1000L);
+
+    ShmArchiveQuery q;
+    q.fromNs = start + 5000 * 1000L;
+    q.toNs = start + 5009 * 1000L;
+    int matched = 0;
+    size_t scanned = reader.query(q, [&](const ShmArchiveRecord& r, const char* payload) {
+        REQUIRE(reader.render(r, payload).find("line " + std::to_string(5000 + matched)) != std::string::npos);
+        ++matched;
+        return true;
+    });
+    REQUIRE(matched == 10);
+    REQUIRE(scanned <= 2);
+
+    q = ShmArchiveQuery{};
+    q.minPriority = SLP_ERROR;
+    q.tid = 100;
+    matched = 0;
+    reader.query(q, [&](const ShmArchiveRecord& r, const char*) {
+        REQUIRE((r.priority == SLP_ERROR && r.tid == 100));
+        return ++matched < 1000;
+    });
+    REQUIRE(matched == count / 100);
+    remove(path.c_str());
+}
+
+TEST_CASE("archive of deferred records", "[ShmLogArchive]") {
+    std::string name = "test_shm_log_archive." + std::to_string(getpid());
+    std::string path = "/tmp/" + name + ".slb";
+    std::string text = "/tmp/" + name + ".log";
+    {
+        ShmLog log;
+        REQUIRE(log.setArchive(path));
+        log.initShm(name, 1 << 20);
+        log.open(text, SLP_INFO, false);
+        static ShmLogSite site{"value %d of %s", __FILE__, __LINE__};
+        for (int i = 0; i < 3; ++i) log.logDeferred(SLP_WARNING, site, i, "archive");
+        log.log(SLP_INFO, __FILE__, __LINE__, "plain text");
+    }
+
+    ShmLogArchiveReader reader(path);
+    std::vector<uint16_t> sites = reader.findSites("TestShmLogArchive.cpp");
+    REQUIRE(sites.size() == 1);
+    ShmArchiveQuery q;
+    q.sites = sites;
+    std::vector<std::string> lines;
+    reader.query(q, [&](const ShmArchiveRecord& r, const char* payload) {
+        lines.push_back(reader.render(r, payload));
+        return true;
+    });
+    REQUIRE(lines.size() == 3);
+    REQUIRE(lines[2].find("[warning]value 2 of archive") != std::string::npos);
+
+    q = ShmArchiveQuery{};
+    int all = 0;
+    reader.query(q, [&](const ShmArchiveRecord&, const char*) { return ++all > 0; });
+    REQUIRE(all == 4);
+    shm_unlink(name.c_str());
+    remove(path.c_str());
+    remove(text.c_str());
+}
@@ -0,0 +1,111 @@
+#include <container/CircularBuffer.h>
+#include <media/SharedMemory.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <thread>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+TEST_CASE("SharedMemory lease", "[SharedMemory]") {
+    std::string name = "frenzy_test_lease." + std::to_string(getpid());
+    SharedMemory owner = SharedMemory::create_or_takeover_shared_memory(name, 4096, 50L * 1000 * 1000);
+    REQUIRE_FALSE(owner.isTakeover);
+
+    SharedMemory reader = SharedMemory::attach_shared_memory(name);
+    REQUIRE(reader.is_owner_alive());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE_FALSE(reader.is_owner_alive());  // lease expired
+    owner.heartbeat();
+    REQUIRE(reader.is_owner_alive());
+
+    REQUIRE_THROWS(SharedMemory::create_or_takeover_shared_memory(name, 4096));
+}
+
+TEST_CASE("SharedMemory takeover and reap", "[SharedMemory]") {
+    std::string name = "frenzy_test_takeover." + std::to_string(getpid());
+    using RingType = CircularBuffer<SharedMemory, uint8_t, FlatStructTraits<uint64_t>>;
+
+    pid_t child = fork();
+    if (child == 0) {  // writer crashes without cleanup
+        SharedMemory shm = SharedMemory::create_or_takeover_shared_memory(name, 4096, SharedMemory::DefaultLeaseNs);
+        RingType rb{std::move(shm), true};
+        for (uint64_t i = 1; i <= 3; ++i) rb.write(i);
+        _exit(0);
+    }
+    waitpid(child, nullptr, 0);
+
+    auto stale = SharedMemory::list_stale_shared_memory();
+    REQUIRE(std::find(stale.begin(), stale.end(), name) != stale.end());
+
+    // restarted writer resumes at the write position in the ring meta
+    SharedMemory shm = SharedMemory::create_or_takeover_shared_memory(name, 4096);
+    REQUIRE(shm.isTakeover);
+    RingType writer{std::move(shm), false};
+    writer.write(uint64_t{4});
+
+    RingType reader{SharedMemory::attach_shared_memory(name)};
+    std::vector<uint64_t> values;
+    REQUIRE(reader.read(values, 10) == 4);
+    REQUIRE(values.back() == 4);
+
+    stale = SharedMemory::list_stale_shared_memory();
+    REQUIRE(std::find(stale.begin(), stale.end(), name) == stale.end());
+}
+
+TEST_CASE("SharedMemory without lease", "[SharedMemory]") {
+    std::string name = "frenzy_test_nolease." + std::to_string(getpid());
+    {
+        SharedMemory owner = SharedMemory::create_or_takeover_shared_memory(name, 4096);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        SharedMemory reader = SharedMemory::attach_shared_memory(name);
+        REQUIRE(reader.is_owner_alive());  // never heartbeats, still owned while the pid lives
+        REQUIRE_THROWS(SharedMemory::create_or_takeover_shared_memory(name, 4096));
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        SharedMemory shm = SharedMemory::create_or_takeover_shared_memory(name, 4096);
+        _exit(0);
+    }
+    waitpid(child, nullptr, 0);
+    auto stale = SharedMemory::list_stale_shared_memory();
+    REQUIRE(std::find(stale.begin(), stale.end(), name) == stale.end());  // not reaped
+    SharedMemory shm = SharedMemory::create_or_takeover_shared_memory(name, 4096);
+    REQUIRE(shm.isTakeover);  // but a dead pid is taken over
+}
+
+TEST_CASE("SharedMemory racing takeover", "[SharedMemory]") {
+    std::string name = "frenzy_test_race." + std::to_string(getpid());
+    pid_t child = fork();
+    if (child == 0) {
+        SharedMemory shm = SharedMemory::create_or_takeover_shared_memory(name, 4096);
+        _exit(0);
+    }
+    waitpid(child, nullptr, 0);
+
+    // restarters stay alive a while, only one of them may take the segment over
+    std::vector<pid_t> restarters;
+    for (int i = 0; i < 4; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bool won = false;
+            try {
+                SharedMemory shm = SharedMemory::create_or_takeover_shared_memory(name, 4096);
+                won = shm.isTakeover;
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            } catch (...) {
+            }
+            _exit(won ? 0 : 1);
+        }
+        restarters.push_back(pid);
+    }
+    int winners = 0;
+    for (pid_t pid : restarters) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) ++winners;
+    }
+    REQUIRE(winners == 1);
+    shm_unlink(name.c_str());
+}
@@ -0,0 +1,65 @@
+#include <lockfree/SeqLock.h>
+#include <media/ShmArena.h>
+#include <sys/wait.h>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+struct Quote {
+    double bid;
+    double ask;
+};
+
+TEST_CASE("ShmArena named regions", "[ShmArena]") {
+    std::string name = "frenzy_test_arena." + std::to_string(getpid());
+    ShmArena creator = ShmArena::create(name, 1024 * 1024, 64);
+    ShmArena attacher = ShmArena::attach(name);
+
+    auto *q = creator.find_or_create<SeqLock<Quote>>("quote.IF");
+    q->store(Quote{1.0, 2.0});
+    auto *q2 = attacher.find_or_create<SeqLock<Quote>>("quote.IF");
+    REQUIRE(q2->load().ask == 2.0);
+    REQUIRE(reinterpret_cast<uintptr_t>(q2) % alignof(SeqLock<Quote>) == 0);
+
+    int64_t *positions = creator.find_or_create_array<int64_t>("positions", 200);
+    positions[199] = 42;
+    REQUIRE(attacher.find_or_create_array<int64_t>("positions", 200)[199] == 42);
+    REQUIRE_THROWS(attacher.find_or_create_array<int64_t>("positions", 100));
+
+    auto writer = creator.find_or_create_circular_buffer<uint8_t, FlatStructTraits<uint64_t>>("ring.IF", 4096);
+    auto reader = attacher.find_or_create_circular_buffer<uint8_t, FlatStructTraits<uint64_t>>("ring.IF", 4096);
+    REQUIRE(writer.write(uint64_t{7}));
+    uint64_t value = 0;
+    REQUIRE(reader.read(value));
+    REQUIRE(value == 7);
+
+    REQUIRE(attacher.find("missing") == nullptr);
+    REQUIRE(attacher.names().size() == 3);
+    REQUIRE_THROWS(creator.find_or_create_array<char>("too.big", 2 * 1024 * 1024));
+}
+
+// same size and alignment as Quote, its constructor kills the process half way
+struct DyingQuote {
+    DyingQuote() { _exit(0); }
+    double bid;
+    double ask;
+};
+
+TEST_CASE("ShmArena creator dies during construction", "[ShmArena]") {
+    std::string name = "frenzy_test_arena_dead." + std::to_string(getpid());
+    ShmArena arena = ShmArena::create(name, 1024 * 1024, 64);
+
+    pid_t child = fork();
+    if (child == 0) {
+        ShmArena::attach(name).find_or_create<DyingQuote>("quote.IF");
+        _exit(1);
+    }
+    waitpid(child, nullptr, 0);
+
+    REQUIRE(arena.entry_count() == 1);
+    REQUIRE_THROWS(arena.find("quote.IF"));
+    Quote *q = arena.find_or_create<Quote>("quote.IF", Quote{1.0, 2.0});
+    REQUIRE(q->ask == 2.0);
+    REQUIRE(arena.find("quote.IF") == q);
+    REQUIRE(arena.find_or_create<double>("after") != nullptr);  // the lock is free again
+}
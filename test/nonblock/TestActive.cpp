@@ -0,0 +1,62 @@
+#include <nonblock/Active.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+namespace {
+template <typename Mailbox>
+void check_mailbox() {
+    std::vector<int> order;  // worker only
+    std::atomic<long> sum{0};
+    {
+        BasicActive<Mailbox> active(ActiveOptions{-1, 16, 256});
+        for (int i = 0; i < 1000; ++i) active.submit([&order, i] { order.push_back(i); });
+        active.submit([] { throw std::runtime_error("task failed, worker goes on"); });
+        std::vector<std::thread> producers;
+        for (int p = 0; p < 4; ++p) {
+            producers.emplace_back([&active, &sum] {
+                for (int i = 1; i <= 10000; ++i) active.submit([&sum, i] { sum.fetch_add(i); });
+            });
+        }
+        for (auto& p : producers) p.join();
+        active.stop();  // everything submitted before has run
+        REQUIRE(sum.load() == 4L * 10000 * 10001 / 2);
+        REQUIRE_THROWS_AS(active.submit([] {}), std::runtime_error);
+    }
+    REQUIRE(order.size() == 1000);
+    for (int i = 0; i < 1000; ++i) REQUIRE(order[i] == i);
+}
+}  // namespace
+
+TEST_CASE("active mailboxes", "[nonblock]") {
+    check_mailbox<MpscMailbox>();
+    check_mailbox<BoundedMailbox>();
+    check_mailbox<LockedMailbox>();
+}
+
+TEST_CASE("active back pressure and pinning", "[nonblock]") {
+    std::atomic<bool> started{false}, release{false};
+    std::atomic<int> ran{0};
+    int cpu = CpuTopology::instance().cpus().front().cpu;  // cpu 0 may be outside the affinity mask
+    BasicActive<BoundedMailbox> active(ActiveOptions{cpu, 64, 4});
+    active.submit([&] {
+        started.store(true);
+        while (!release.load()) std::this_thread::yield();
+        ran.fetch_add(current_cpu() == cpu ? 1 : 1000);
+    });
+    while (!started.load()) std::this_thread::yield();
+    while (true) {  // the worker holds the blocking task, the ring fills up
+        Task task([&ran] { ran.fetch_add(1); });
+        if (!active.try_submit(task)) {
+            REQUIRE(task);  // kept on failure
+            break;
+        }
+    }
+    release.store(true);
+    active.stop();
+    REQUIRE(ran.load() == 5);
+}
@@ -0,0 +1,41 @@
+#include <thread/SimpleThreadPool.h>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+TEST_CASE("simple thread pool futures", "[thread]") {
+    SimpleThreadPool pool(3);
+    pool.start();
+    std::vector<Future<std::string>> results;
+    for (int i = 0; i < 10000; ++i) results.push_back(pool.enqueue([](int x) { return std::to_string(x); }, i));
+    for (int i = 0; i < 10000; ++i) REQUIRE(results[i].get() == std::to_string(i));
+    REQUIRE_FALSE(results[0].valid());
+
+    std::atomic<int> posted{0};
+    for (int i = 0; i < 100; ++i) pool.post([&posted] { posted.fetch_add(1); });
+    pool.enqueue([] {}).get();  // fifo queue, although a posted task may still be running
+    auto failed = pool.enqueue([]() -> int { throw std::runtime_error("task failed"); });
+    REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+    while (posted.load() < 100) std::this_thread::yield();
+}
+
+TEST_CASE("broken promise", "[thread]") {
+    Future<int> future;
+    {
+        Promise<int> promise;
+        future = promise.get_future();
+        REQUIRE_FALSE(future.ready());
+    }
+    REQUIRE(future.ready());
+    REQUIRE_THROWS_AS(future.get(), std::future_error);
+
+    Promise<void> promise;
+    Future<void> done = promise.get_future();
+    std::thread setter([&promise] { promise.set_value(); });
+    done.get();
+    setter.join();
+}
@@ -0,0 +1,34 @@
+#include <thread/Task.h>
+#include <memory>
+#include <string>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+TEST_CASE("task small buffer", "[thread]") {
+    int calls = 0;
+    auto increment = [&calls] { ++calls; };
+    REQUIRE(Task::fits_inline<decltype(increment)>());
+    Task small{increment};
+    small();
+    REQUIRE(calls == 1);
+
+    std::string big(100, 'x');
+    char pad[64] = {};
+    Task large{[&calls, big, pad] { calls += static_cast<int>(big.size()) + pad[0]; }};
+    large();
+    REQUIRE(calls == 101);
+
+    Task moved{std::move(large)};
+    REQUIRE(!large);
+    moved();
+    REQUIRE(calls == 201);
+
+    auto owned = std::make_unique<int>(7);  // move only capture
+    Task unique{[p = std::move(owned), &calls] { calls += *p; }};
+    small = std::move(unique);
+    small();
+    REQUIRE(calls == 208);
+    small.reset();
+    REQUIRE(!small);
+}
@@ -0,0 +1,61 @@
+#include <thread/TaskGroup.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+TEST_CASE("task group wait and exception", "[thread]") {
+    TaskScheduler scheduler(4);
+    std::atomic<int> done{0};
+    TaskGroup group(scheduler);
+    for (int i = 0; i < 1000; ++i) group.run([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+    group.wait();
+    REQUIRE(done.load() == 1000);
+
+    group.run([] { throw std::runtime_error("task failed"); });
+    group.run([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+    REQUIRE_THROWS_AS(group.wait(), std::runtime_error);
+    REQUIRE(done.load() == 1001);
+    group.wait();  // the error is reported once
+}
+
+TEST_CASE("parallel for covers every index once", "[thread]") {
+    TaskScheduler scheduler(4);
+    const size_t n = 100003;
+    std::vector<std::atomic<int>> hits(n);
+    parallel_for(0, n, 0, [&](size_t i) { hits[i].fetch_add(1, std::memory_order_relaxed); }, scheduler);
+    for (size_t i = 0; i < n; ++i) REQUIRE(hits[i].load() == 1);
+
+    // nested inside tasks, the waits help instead of blocking the four workers
+    std::atomic<size_t> cells{0};
+    parallel_for(0, 64, 1, [&](size_t) {
+        parallel_for(0, 1000, 10, [&](size_t lo, size_t hi) { cells.fetch_add(hi - lo); }, scheduler);
+    }, scheduler);
+    REQUIRE(cells.load() == 64 * 1000);
+}
+
+TEST_CASE("parallel reduce keeps order", "[thread]") {
+    TaskScheduler scheduler(4);
+    const size_t n = 1000000;
+    auto sum = parallel_reduce(size_t{0}, n, 1000, size_t{0},
+        [](size_t lo, size_t hi) {
+            size_t s = 0;
+            for (size_t i = lo; i < hi; ++i) s += i;
+            return s;
+        },
+        [](size_t a, size_t b) { return a + b; }, scheduler);
+    REQUIRE(sum == n * (n - 1) / 2);
+
+    // string concatenation is associative but not commutative
+    auto text = parallel_reduce(0, 200, 3, std::string{},
+        [](size_t lo, size_t hi) {
+            std::string s;
+            for (size_t i = lo; i < hi; ++i) s += static_cast<char>('a' + i % 26);
+            return s;
+        },
+        [](const std::string &a, const std::string &b) { return a + b; }, scheduler);
+    REQUIRE(text.size() == 200);
+    for (size_t i = 0; i < 200; ++i) REQUIRE(text[i] == static_cast<char>('a' + i % 26));
+}
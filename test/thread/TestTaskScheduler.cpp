@@ -0,0 +1,133 @@
+#include <lockfree/WorkStealingDeque.h>
+#include <thread/TaskScheduler.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+TEST_CASE("work stealing deque", "[thread]") {
+    WorkStealingDeque<long> deque(2);
+    const long count = 100000;
+    std::atomic<long> stolen{0};
+    std::atomic<long> sum{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; ++t) {
+        thieves.emplace_back([&] {
+            long v = 0;
+            while (!done.load(std::memory_order_acquire) || !deque.empty()) {
+                if (deque.steal(v)) {
+                    sum.fetch_add(v, std::memory_order_relaxed);
+                    stolen.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    long popped = 0;
+    long v = 0;
+    for (long i = 1; i <= count; ++i) {
+        deque.push(i);  // grows from 2
+        if (i % 3 == 0 && deque.pop(v)) {
+            sum.fetch_add(v, std::memory_order_relaxed);
+            ++popped;
+        }
+    }
+    while (deque.pop(v)) {
+        sum.fetch_add(v, std::memory_order_relaxed);
+        ++popped;
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &t : thieves) t.join();
+    REQUIRE(popped + stolen.load() == count);
+    REQUIRE(sum.load() == count * (count + 1) / 2);
+}
+
+TEST_CASE("task scheduler futures", "[thread]") {
+    TaskScheduler scheduler(4);
+    std::vector<Future<int>> results;
+    for (int i = 0; i < 1000; ++i) results.push_back(scheduler.enqueue([](int x) { return x * 2; }, i));
+    for (int i = 0; i < 1000; ++i) REQUIRE(results[i].get() == i * 2);
+
+    auto failed = scheduler.enqueue([] { throw std::runtime_error("task failed"); });
+    REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+    REQUIRE(scheduler.worker_index() == -1);
+}
+
+TEST_CASE("task scheduler nested spawn", "[thread]") {
+    std::atomic<long> leaves{0};
+    {
+        std::function<void(int)> spawn;  // outlives the scheduler, tasks may still be running it after the last leaf
+        TaskScheduler scheduler(4);
+        // binary tree of tasks spawned from workers, runs on their deques and gets stolen
+        spawn = [&](int depth) {
+            if (depth == 0) {
+                leaves.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            scheduler.submit([&spawn, depth] { spawn(depth - 1); });
+            scheduler.submit([&spawn, depth] { spawn(depth - 1); });
+        };
+        scheduler.submit([&spawn] { spawn(14); });
+        while (leaves.load() < (1 << 14)) std::this_thread::yield();
+    }
+    REQUIRE(leaves.load() == (1 << 14));
+}
+
+TEST_CASE("task scheduler drains on destruction", "[thread]") {
+    std::atomic<int> done{0};
+    {
+        TaskScheduler scheduler(2);
+        for (int i = 0; i < 10000; ++i) {
+            scheduler.submit([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+    }
+    REQUIRE(done.load() == 10000);
+}
+
+TEST_CASE("task scheduler external submits racing destruction", "[thread]") {
+    for (int round = 0; round < 20; ++round) {
+        std::atomic<int> accepted{0};
+        std::atomic<int> done{0};
+        // storage outlives the scheduler, a submitter may call once more after the destructor returned
+        alignas(TaskScheduler) unsigned char storage[sizeof(TaskScheduler)];
+        TaskScheduler *scheduler = new (storage) TaskScheduler(2);
+        std::vector<std::thread> submitters;
+        for (int t = 0; t < 3; ++t) {
+            submitters.emplace_back([&] {
+                while (true) {
+                    try {
+                        scheduler->submit([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+                    } catch (const std::runtime_error &) {
+                        return;
+                    }
+                    accepted.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        while (accepted.load() < 1000) std::this_thread::yield();
+        scheduler->~TaskScheduler();
+        for (auto &t : submitters) t.join();
+        REQUIRE(done.load() == accepted.load());  // every submit that returned has run
+    }
+}
+
+TEST_CASE("task scheduler pinned workers", "[thread]") {
+    TaskSchedulerOptions options;
+    options.threads = 2;
+    options.pin = true;
+    TaskScheduler scheduler(options);
+    REQUIRE(scheduler.worker_cpu(0) >= 0);
+    REQUIRE(scheduler.node_count() >= 1);
+    for (int node = 0; node < scheduler.node_count(); ++node) {
+        std::atomic<int> cpu{-1};
+        std::atomic<bool> done{false};
+        scheduler.submit([&] {
+            cpu = current_cpu();
+            done = true;
+        }, node);
+        while (!done.load()) std::this_thread::yield();
+        REQUIRE((cpu.load() == scheduler.worker_cpu(0) || cpu.load() == scheduler.worker_cpu(1)));
+    }
+}
@@ -0,0 +1,185 @@
+#include <thread/TimerWheel.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+
+using namespace frenzy;
+
+TEST_CASE("timer wheel order and cascading", "[thread]") {
+    TimerWheel<> wheel;
+    wheel.advance(1000);
+    std::vector<int64_t> fired;
+    // spread over several levels, registered out of order
+    std::vector<int64_t> times{1000 + (1L << 40), 1005, 1000 + 4096 * 3 + 7, 1000 + 64, 1001, 1000 + 262144 + 1};
+    for (int64_t t : times) wheel.register_timer([&fired](int64_t tm) { fired.push_back(tm); }, t);
+    REQUIRE(wheel.advance(1000) == 0);
+    REQUIRE(wheel.advance(1005) == 2);
+    REQUIRE(fired == std::vector<int64_t>{1001, 1005});
+    REQUIRE(wheel.advance(1000 + 262144) == 2);
+    REQUIRE(wheel.advance(1000 + 262144 + 1) == 1);
+    REQUIRE(wheel.advance(1000 + (1L << 40) - 1) == 0);
+    REQUIRE(wheel.advance(1000 + (1L << 40)) == 1);
+    REQUIRE(fired == std::vector<int64_t>{1001, 1005, 1064, 1000 + 4096 * 3 + 7, 1000 + 262144 + 1, 1000 + (1L << 40)});
+
+    TimerWheel<> coarse(10);  // never early, rounded up to the next tick
+    int ran = 0;
+    coarse.advance(0);
+    coarse.register_timer([&ran](int64_t) { ++ran; }, 15);
+    REQUIRE(coarse.advance(19) == 0);
+    REQUIRE(coarse.advance(20) == 1);
+}
+
+TEST_CASE("timer wheel recurring and cancel", "[thread]") {
+    TimerWheel<> wheel;
+    wheel.advance(0);
+    std::vector<int64_t> fired;
+    // every 10 from 100 to 200, 130 to 160 blacked out, as register_timer expanded it before
+    wheel.register_timer([&fired](int64_t tm) { fired.push_back(tm); }, 100, 10, 200, 130, 160);
+    for (int64_t now = 0; now <= 300; now += 5) wheel.advance(now);
+    REQUIRE(fired == std::vector<int64_t>{100, 110, 120, 170, 180, 190, 200});
+
+    int ran = 0;
+    auto once = wheel.register_timer([&ran](int64_t) { ++ran; }, 400);
+    auto forever = wheel.register_timer([&ran](int64_t) { ++ran; }, 400, 1, 0, TimerWheel<>::CalendarId{});
+    REQUIRE(once.active());
+    REQUIRE(once.cancel());
+    REQUIRE_FALSE(once.cancel());
+    REQUIRE(wheel.advance(409) == 10);
+    REQUIRE(forever.cancel());
+    REQUIRE(wheel.advance(1000) == 0);
+    REQUIRE(ran == 10);
+
+    // cancels itself from the callback
+    TimerWheel<>::Handle self;
+    auto cancelSelf = [&self, &ran](int64_t) { self.cancel(), ++ran; };
+    self = wheel.register_timer(cancelSelf, 1001, 1, 0, TimerWheel<>::CalendarId{});
+    wheel.advance(2000);
+    REQUIRE(ran == 11);
+    REQUIRE_FALSE(self.active());
+
+    // an interval without end_time is a one shot, as the heap based wheel had it
+    auto compat = wheel.register_timer([&ran](int64_t) { ++ran; }, 2001, 1);
+    REQUIRE(wheel.advance(3000) == 1);
+    REQUIRE(ran == 12);
+    REQUIRE_FALSE(compat.active());
+}
+
+TEST_CASE("timer wheel registration from other threads", "[thread]") {
+    TimerWheel<> wheel;
+    wheel.advance(0);
+    std::atomic<int> fired{0};
+    std::atomic<int> cancelled{0};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < 5000; ++i) {
+                int64_t time = i % 2 == 0 ? 1L << 50 : 1 + i + p;  // the cancelled ones can not run first
+                auto handle = wheel.register_timer([&fired](int64_t) { fired.fetch_add(1); }, time);
+                if (i % 2 == 0 && handle.cancel()) cancelled.fetch_add(1);
+            }
+        });
+    }
+    int64_t now = 0;
+    while (fired.load() < 10000) wheel.advance(now += 100);
+    for (auto& p : producers) p.join();
+    wheel.advance(1L << 51);
+    REQUIRE(cancelled.load() == 10000);
+    REQUIRE(fired.load() == 10000);
+}
+
+TEST_CASE("timer wheel frees timers cancelled from other threads", "[thread]") {
+    TimerWheel<> wheel;
+    wheel.advance(0);
+    auto token = std::make_shared<int>(0);  // every pending callable holds a copy until its node is freed
+    for (int round = 0; round < 3; ++round) {
+        std::vector<TimerWheel<>::Handle> handles;
+        for (int i = 0; i < 5000; ++i) handles.push_back(wheel.register_timer([token](int64_t) {}, 1L << 40));
+        REQUIRE(token.use_count() == 5001);
+        std::atomic<bool> done{false};
+        std::thread canceller([&handles, &done] {
+            for (auto& h : handles) h.cancel();
+            done.store(true);
+        });
+        int64_t now = round * 1000;
+        while (!done.load()) REQUIRE(wheel.advance(++now) == 0);  // the queue holds 1024, the owner keeps draining
+        canceller.join();
+        wheel.advance(++now);
+        REQUIRE(token.use_count() == 1);  // unlinked and recycled, not left in the slots until 2^40
+        for (auto& h : handles) REQUIRE_FALSE(h.active());
+    }
+}
+
+TEST_CASE("timer wheel reschedule", "[thread]") {
+    TimerWheel<> wheel;
+    wheel.advance(0);
+    std::vector<int64_t> fired;
+    auto record = [&fired](int64_t tm) { fired.push_back(tm); };
+    auto later = wheel.register_timer(record, 100);
+    auto sooner = wheel.register_timer(record, 1L << 30);
+    auto every = wheel.register_timer(record, 50, 50, 0, TimerWheel<>::CalendarId{});
+    REQUIRE(later.reschedule(300));
+    REQUIRE(sooner.reschedule(20));
+    REQUIRE(wheel.advance(100) == 3);
+    REQUIRE(fired == std::vector<int64_t>{20, 50, 100});
+    REQUIRE(every.reschedule(175));  // goes on every 50 from there
+    REQUIRE(wheel.advance(300) == 4);
+    REQUIRE(fired == std::vector<int64_t>{20, 50, 100, 175, 225, 275, 300});
+    REQUIRE_FALSE(later.reschedule(400));  // ran already
+    REQUIRE(every.cancel());
+    REQUIRE_FALSE(every.reschedule(400));
+
+    // from another thread it takes effect at the next advance
+    auto handle = wheel.register_timer(record, 1L << 40);
+    std::thread([&handle] { REQUIRE(handle.reschedule(500)); }).join();
+    REQUIRE(wheel.advance(500) == 1);
+    REQUIRE(fired.back() == 500);
+}
+
+TEST_CASE("timer wheel calendar", "[thread]") {
+    TimerWheel<> wheel;
+    wheel.advance(0);
+    // every 10, nothing from 40 to 59 of every 100 and nothing at all from 500 to 699
+    auto closed = wheel.add_calendar(TimerCalendar<>().black_out_every(100, 40, 59).black_out(500, 699));
+    REQUIRE(closed.id == wheel.add_calendar(TimerCalendar<>().black_out_every(100, 40, 59).black_out(500, 699)).id);
+    std::vector<int64_t> fired;
+    wheel.register_timer([&fired](int64_t tm) { fired.push_back(tm); }, 0, 10, 800, closed);
+    for (int64_t now = 0; now <= 1000; now += 7) wheel.advance(now);
+    std::vector<int64_t> expected;
+    for (int64_t t = 0; t <= 800; t += 10) {
+        if (t % 100 < 40 || t % 100 > 59) {
+            if (t < 500 || t > 699) expected.push_back(t);
+        }
+    }
+    REQUIRE(fired == expected);
+
+    TimerCalendar<> calendar;
+    calendar.black_out_every(100, 40, 59).black_out(500, 699);
+    REQUIRE(calendar.blocked(-60));
+    REQUIRE_FALSE(calendar.blocked(-61));
+    REQUIRE(calendar.next_open(445) == 460);
+    REQUIRE(calendar.next_open(540) == 700);
+}
+
+TEST_CASE("timer wheel compatibility overload", "[thread]") {
+    TimerWheel<> wheel;
+    wheel.advance(0);
+    std::vector<int64_t> fired;
+    auto record = [&fired](int64_t tm) { fired.push_back(tm); };
+    wheel.register_timer(record, 50, 0, 0, 40, 60);        // a one shot ignores the window
+    wheel.register_timer(record, 100, 10, 140, 120, 120);  // a single point window
+    for (int64_t now = 0; now <= 200; now += 5) wheel.advance(now);
+    REQUIRE(fired == std::vector<int64_t>{50, 100, 110, 130, 140});
+
+    std::atomic<bool> threw{false};
+    std::thread other([&] {
+        try {
+            wheel.advance(300);
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+    });
+    other.join();
+    REQUIRE(threw.load());
+}
@@ -2,13 +2,15 @@
 #include <zerg_fst.h>
 #include <zerg_template.h>
 #include <zerg_time.h>
+#include <thread/TaskGroup.h>
+#include <memory>
 #include <regex>
-#include <omp.h>
 
 using namespace ztool;
 
 struct DailyY {
     void work() {
+        if (threads > 0) m_pool.reset(new frenzy::TaskScheduler(threads));
         read_y();
         auto xs = ztool::path_wildcard(ztool::path_join(m_x_dir, "*.fst"));
         std::vector<std::pair<std::string, std::string>> todos;
@@ -53,7 +55,8 @@ struct DailyY {
     size_t m_x_len{0};
     size_t m_date_len{0};
     int m_start_date{-1}, m_end_date{-1};
-    int threads{0};
+    int threads{0};  // 0 shares the process wide TaskScheduler
+    std::unique_ptr<frenzy::TaskScheduler> m_pool;
     std::vector<int> m_result_date, m_result_tick, m_y_idx, m_x_idx;
     std::vector<double> m_result_pcor, m_result_pcor_pos, m_result_rcor, m_result_rcor_pos;
 
@@ -218,8 +221,8 @@ void DailyY::work_single(const string& date_str, const string& path) {
     std::vector<double> result_pcor(total_len, NAN), result_pcor_pos(total_len, NAN);
     std::vector<double> result_rcor(total_len, NAN), result_rcor_pos(total_len, NAN);
 
-#pragma omp parallel for num_threads(threads == 0 ? omp_get_max_threads():threads)
-    for (size_t k = 0; k < key_len; ++k) {
+    frenzy::TaskScheduler& pool = m_pool ? *m_pool : frenzy::TaskScheduler::instance();
+    frenzy::parallel_for(0, key_len, 1, [&](size_t k) {
         size_t key_ = keys[k];
         auto itr1 = m_y_tick_date_pos.find(key_); // must exist
         auto range = itr1->second;
@@ -228,7 +231,7 @@ void DailyY::work_single(const string& date_str, const string& path) {
         auto itr2 = x_key2row_pos.find(key_);
         if (itr2 == x_key2row_pos.end()) {
             printf("WARN! no key %zu in x file %s\n", key_, path.c_str());
-            continue;
+            return;
         }
         const std::vector<size_t>& x_row_poses = itr2->second;
 
@@ -265,7 +268,7 @@ void DailyY::work_single(const string& date_str, const string& path) {
                 result_rcor_pos[k * cor_len + i * pXs.size() + j] = rcor_pos;
             }
         }
-    }
+    }, pool);
 
     m_result_date.insert(m_result_date.end(), result_date.begin(), result_date.end());
     m_result_tick.insert(m_result_tick.end(), result_tick.begin(), result_tick.end());
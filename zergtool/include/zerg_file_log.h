@@ -1,8 +1,11 @@
 #ifndef ZERGFILELOG_H
 #define ZERGFILELOG_H
 
-#include <sys/time.h>
+#include <log/FileSink.h>
+#include <utils/TimestampFormatter.h>
+#include <algorithm>
 #include <cstdarg>
+#include <memory>
 #include <string>
 
 namespace ztool {
@@ -13,71 +16,79 @@ struct ZergFileLog {
 
     ~ZergFileLog() { Close(); }
 
-    void SetLogFile(const std::string &filename) {
-        if (m_fp != nullptr) fclose(m_fp);
-        m_fp = fopen(filename.c_str(), "w+");
-        if (m_fp == nullptr) {
-            fprintf(stderr, "cannot open %s for writing\n", filename.c_str());
+    /**
+     * every line reaches the file on Write, as before. SetFlushEveryWrite(false) block buffers them, lines then
+     * reach the file when the buffer fills, on Flush, or on the first Write after options.flushIntervalMs.
+     * nothing flushes a quiet log in the background, call Flush before going idle.
+     */
+    void SetLogFile(const std::string &filename, frenzy::FileSinkOptions options = frenzy::FileSinkOptions{}) {
+        Close();
+        options.append = false;
+        try {
+            m_sink.reset(new frenzy::FileSink(filename, options));
+        } catch (const std::exception &e) {
+            fprintf(stderr, "cannot open %s for writing, %s\n", filename.c_str(), e.what());
             return;
         }
         m_bLogInited = true;
     }
 
     void Write(const char *format, ...) {
-        if (!m_bLogInited || m_fp == nullptr) {
+        if (!m_bLogInited) {
             return;
         }
         va_list args;
         va_start(args, format);
-        vsprintf(content, format, args);
+        int n = vsnprintf(content, sizeof(content), format, args);
         va_end(args);
+        if (n < 0) return;
+        n = std::min(n, static_cast<int>(sizeof(content)) - 1);
 
         if (m_bShowTime) {
-            struct timeval raw_time {};
-            gettimeofday(&raw_time, nullptr);
-            struct tm *time_info;
-            char buffer[80];
-            time_info = localtime(&raw_time.tv_sec);
-            strftime(buffer, 80, "%Y-%m-%d %H:%M:%S", time_info);
-            if (m_bAutoEndLine)
-                fprintf(m_fp, "[%s.%03ld] %s\n", buffer, (raw_time.tv_usec % 1000000) / 1000, content);
-            else
-                fprintf(m_fp, "[%s.%03ld] %s", buffer, (raw_time.tv_usec % 1000000) / 1000, content);
+            char buffer[frenzy::TimestampFormatter::MaxLength + 3];
+            buffer[0] = '[';
+            size_t len = 1 + m_timestamp.format(m_timestamp.now_ns(), buffer + 1);
+            buffer[len++] = ']';
+            buffer[len++] = ' ';
+            m_sink->write(buffer, len);
+        }
+        m_sink->write(content, static_cast<size_t>(n));
+        if (m_bAutoEndLine) m_sink->write("\n", 1);
+
+        if (m_bFlushEveryWrite) {
+            m_sink->flush();
         } else {
-            if (m_bAutoEndLine)
-                fprintf(m_fp, "%s\n", content);
-            else
-                fprintf(m_fp, "%s", content);
+            m_sink->flush_if_due();
         }
-        fflush(m_fp);
     }
 
-    void PureWrite(const char *content_) { fputs(content_, m_fp); }
+    void PureWrite(const char *content_) {
+        if (m_bLogInited) m_sink->write(content_, strlen(content_));
+    }
 
-    void WriteNewLine() { fputs("\n", m_fp); }
+    void WriteNewLine() { PureWrite("\n"); }
 
     void Flush() {
-        if (m_fp != nullptr) fflush(m_fp);
+        if (m_bLogInited) m_sink->flush();
     }
 
     /// show time or not
     void SetShowTimeStamp(bool show) { m_bShowTime = show; }
     void SetAutoEndLine(bool end_line) { m_bAutoEndLine = end_line; }
+    void SetFlushEveryWrite(bool flush) { m_bFlushEveryWrite = flush; }
 
     void Close() {
-        if (m_fp != nullptr) {
-            Flush();
-            fclose(m_fp);
-        }
-        m_fp = nullptr;
+        m_sink.reset();
         m_bLogInited = false;
     }
 
     char content[2048];
-    FILE *m_fp{nullptr};
+    std::unique_ptr<frenzy::FileSink> m_sink;
+    frenzy::TimestampFormatter m_timestamp{3};
     bool m_bLogInited{false};
     bool m_bShowTime{true};
     bool m_bAutoEndLine{true};
+    bool m_bFlushEveryWrite{true};
 };
 }  // namespace ztool
 
@@ -1,8 +1,8 @@
 #ifndef _ZERG_STOPWATCH_H_
 #define _ZERG_STOPWATCH_H_
 
-#include <sys/time.h>
-#include <ctime>
+#include <utils/TscClock.h>
+#include <cstdint>
 #include <exception>
 
 namespace ztool {
@@ -13,21 +13,20 @@ public:
     virtual ~StopWatch() = default;
 
     void Start() { start(); }
-    void start() { clock_gettime(CLOCK_REALTIME, &start_ts); }
+    void start() { start_tsc = frenzy::TscClock::ticks(); }
 
     void Stop() { stop(); }
-    void stop() { clock_gettime(CLOCK_REALTIME, &end_ts); }
+    void stop() { end_tsc = frenzy::TscClock::ticks(); }
 
     // return time duration between start and end
     long print() {
-        elapse = (end_ts.tv_sec - start_ts.tv_sec) * 1000 * 1000 * 1000;
-        elapse += end_ts.tv_nsec - start_ts.tv_nsec;
+        elapse = frenzy::TscClock::instance().ticks_to_ns(end_tsc - start_tsc);
         return elapse;
     }
 
 private:
-    timespec start_ts, end_ts;  // store every time point data
-    long elapse;                // store time elapsed during start and stop
+    uint64_t start_tsc{0}, end_tsc{0};  // tsc ticks, converted to ns in print
+    long elapse;                        // store time elapsed during start and stop
 };
 
 }  // namespace ztool
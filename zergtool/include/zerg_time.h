@@ -9,6 +9,7 @@
 #include <fstream>
 #include <iomanip>
 #include <vector>
+#include "utils/TscClock.h"
 #include "zerg_exception.h"
 #include "zerg_string.h"
 
@@ -277,11 +278,8 @@ inline uint64_t nanoSinceEpochU() {
 }
 
 inline uint64_t ntime() { return nanoSinceEpochU(); }
-inline long utime() {
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
-    return tv.tv_sec * 1000000 + tv.tv_usec;
-}
+// realtime in microseconds from frenzy::TscClock, no syscall
+inline long utime() { return frenzy::TscClock::instance().now_ns() / 1000; }
 
 // YYYYMMDD format
 inline uint32_t nano2date(uint64_t nano) {
@@ -0,0 +1,213 @@
+#include <dirent.h>
+#include <log/FileSink.h>
+#include <log/ShmLogArchive.h>
+#include <log/ShmLogDrainer.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <map>
+#include <memory>
+
+using namespace std;
+using namespace frenzy;
+
+string shm_dir = "/dev/shm";
+string prefix = "shm_log.";
+string out_dir = "/tmp";
+bool unlink_done{false};
+bool once{false};
+bool keep_archive{false};
+FileSinkOptions sink_options;
+std::atomic<bool> running{true};
+
+void help() {
+    std::cout << "Program options:" << std::endl;
+    std::cout << "  -h                                    list help" << std::endl;
+    std::cout << "  -d                                    shm directory, default /dev/shm" << std::endl;
+    std::cout << "  -p                                    segment name prefix, default shm_log." << std::endl;
+    std::cout << "  -o                                    output directory if producer set no file, default /tmp"
+              << std::endl;
+    std::cout << "  -u                                    unlink segment after producer exits and it is drained"
+              << std::endl;
+    std::cout << "  -1                                    drain what is there and exit" << std::endl;
+    std::cout << "  -r                                    rotate output after this many MB, default off" << std::endl;
+    std::cout << "  -t                                    rotate output every n seconds, 86400 daily" << std::endl;
+    std::cout << "  -c                                    compress output, zstd or lz4" << std::endl;
+    std::cout << "  -b                                    also keep binary records in <output>.slb, see shmlogq"
+              << std::endl;
+    std::cout << "example:" << std::endl;
+    std::cout << "shmlogd -u" << std::endl;
+}
+
+// one ShmLog segment, drained only after this process holds the drainer role
+struct Segment {
+    std::unique_ptr<ShmLogDrainer> drainer;
+    std::unique_ptr<FileSink> sink;
+    std::unique_ptr<std::ostream> ofs;
+    std::unique_ptr<ShmLogArchiveWriter> archive;
+    bool claimed{false};
+};
+
+std::map<string, Segment> segments;
+
+vector<string> list_segments() {
+    vector<string> names;
+    DIR* dir = opendir(shm_dir.c_str());
+    if (dir == nullptr) return names;
+    while (struct dirent* ent = readdir(dir)) {
+        string name = ent->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0) names.push_back(name);
+    }
+    closedir(dir);
+    return names;
+}
+
+// claim a segment and open its output, producer's filePath is used if set
+bool try_claim(const string& name, Segment& seg) {
+    ShmLogMeta* meta = seg.drainer->getMeta();
+    bool producerAlive = seg.drainer->isProducerAlive();
+    string path = meta->filePath;
+    if (path.empty() && producerAlive) return false;  // producer has not called open() yet
+    if (!seg.drainer->claim()) return false;
+
+    if (path == "std stream") {
+        seg.drainer->setOutput(&std::cout);
+    } else {
+        if (path.empty()) path = out_dir + "/" + name + ".log";
+        try {
+            seg.sink.reset(new FileSink(path, sink_options));
+            seg.ofs.reset(new std::ostream(seg.sink.get()));
+            seg.drainer->setOutput(seg.ofs.get());
+        } catch (const std::exception& e) {
+            cerr << "open outfile:" << path << " failed, " << e.what() << ", drain " << name << " to stdout" << endl;
+            seg.drainer->setOutput(&std::cout);
+        }
+    }
+    if (keep_archive) {
+        string archivePath = (path == "std stream" ? out_dir + "/" + name : path) + ".slb";
+        ShmArchiveOptions options;
+        options.rotateBytes = sink_options.rotateBytes;
+        try {
+            seg.archive.reset(new ShmLogArchiveWriter(archivePath, options));
+            seg.drainer->setArchive(seg.archive.get());
+        } catch (const std::exception& e) {
+            cerr << "open archive:" << archivePath << " failed, " << e.what() << endl;
+        }
+    }
+    cout << "shmlogd drains " << name << " to " << path << (producerAlive ? "" : ", producer is gone") << endl;
+    seg.claimed = true;
+    return true;
+}
+
+void scan() {
+    for (const string& name : list_segments()) {
+        if (segments.count(name) != 0) continue;
+        std::unique_ptr<ShmLogDrainer> drainer = ShmLogDrainer::attach(name);
+        if (drainer == nullptr) continue;  // not a shm log, or not formatted yet
+        segments[name].drainer = std::move(drainer);
+    }
+    for (auto& it : segments) {
+        if (!it.second.claimed) try_claim(it.first, it.second);
+    }
+}
+
+// drain every claimed segment once, remove the finished ones
+int drain_all() {
+    int count = 0;
+    for (auto it = segments.begin(); it != segments.end();) {
+        Segment& seg = it->second;
+        if (!seg.claimed) {
+            ++it;
+            continue;
+        }
+        bool producerAlive = seg.drainer->isProducerAlive();
+        // once the producer is gone nothing is in flight, so no merge delay is needed for the tail
+        if (producerAlive && running) {
+            count += seg.drainer->drain(ShmLogDrainer::realtimeNs() - ShmLogDrainer::MergeDelayNs);
+        } else {
+            count += seg.drainer->drainAll();
+        }
+        if ((!producerAlive || !running || once) && seg.drainer->empty()) {
+            if (seg.ofs) seg.ofs->flush();
+            seg.archive.reset();
+            cout << "shmlogd done with " << it->first << endl;
+            if (unlink_done && !producerAlive) shm_unlink(it->first.c_str());
+            seg.drainer->getMeta()->drainerPid.store(0, std::memory_order_release);
+            it = segments.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    return count;
+}
+
+void on_signal(int) { running = false; }
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "hd:p:o:u1r:t:c:b")) != -1) {
+        switch (opt) {
+            case 'd':
+                shm_dir = std::string(optarg);
+                break;
+            case 'p':
+                prefix = std::string(optarg);
+                break;
+            case 'o':
+                out_dir = std::string(optarg);
+                break;
+            case 'u':
+                unlink_done = true;
+                break;
+            case '1':
+                once = true;
+                break;
+            case 'b':
+                keep_archive = true;
+                break;
+            case 'r':
+                sink_options.rotateBytes = std::stoull(optarg) * 1024 * 1024;
+                break;
+            case 't':
+                sink_options.rotateSeconds = static_cast<uint32_t>(std::stoul(optarg));
+                break;
+            case 'c':
+                if (string(optarg) == "zstd") {
+                    sink_options.compression = SinkCompression::Zstd;
+                } else if (string(optarg) == "lz4") {
+                    sink_options.compression = SinkCompression::Lz4;
+                } else {
+                    help();
+                    return 1;
+                }
+                break;
+            case 'h':
+            default:
+                help();
+                return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    int64_t lastScan = 0;
+    while (true) {
+        int64_t now = ShmLogDrainer::realtimeNs();
+        if (now - lastScan > 1000L * 1000 * 1000 || once) {
+            scan();
+            lastScan = now;
+        }
+        if (drain_all() == 0) {
+            if (!running || once) break;
+            for (auto& it : segments) {
+                if (it.second.ofs) it.second.ofs->flush();
+                if (it.second.archive) it.second.archive->flush();
+            }
+            std::cout.flush();
+            usleep(1000);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <log/ShmLogArchive.h>
+#include <unistd.h>
+#include <climits>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+using namespace std;
+using namespace frenzy;
+
+ShmArchiveQuery query;
+string site_file;
+int site_line{0};
+uint64_t limit{UINT64_MAX};
+bool count_only{false};
+bool stats{false};
+
+void help() {
+    std::cout << "Program options:" << std::endl;
+    std::cout << "  -h                                    list help" << std::endl;
+    std::cout << "  -f                                    from time, \"YYYY-MM-DD HH:MM:SS[.ffffff]\" local or ns epoch"
+              << std::endl;
+    std::cout << "  -t                                    to time, inclusive, same format as -f" << std::endl;
+    std::cout << "  -p                                    lowest priority, debug info warning error critical"
+              << std::endl;
+    std::cout << "  -T                                    writer thread id" << std::endl;
+    std::cout << "  -s                                    call site, file[:line], file matches by suffix. deferred"
+              << std::endl;
+    std::cout << "                                        records only, SHM_LOG_DEFERRED_FORMAT" << std::endl;
+    std::cout << "  -n                                    print at most n lines" << std::endl;
+    std::cout << "  -c                                    print the number of matching lines only" << std::endl;
+    std::cout << "  -i                                    print blocks read per file to stderr" << std::endl;
+    std::cout << "example:" << std::endl;
+    std::cout << "shmlogq -f \"2024-05-01 10:00:00\" -t \"2024-05-01 10:00:05\" -p warning /tmp/shm_log.*.slb"
+              << std::endl;
+}
+
+// local time with optional fraction, or ns since epoch
+int64_t parse_time(const string& s) {
+    if (s.find_first_not_of("0123456789") == string::npos) return std::stoll(s);
+    struct tm tm {};
+    const char* rest = strptime(s.c_str(), "%Y-%m-%d %H:%M:%S", &tm);
+    if (rest == nullptr) {
+        cerr << "bad time " << s << endl;
+        exit(1);
+    }
+    tm.tm_isdst = -1;
+    int64_t ns = static_cast<int64_t>(mktime(&tm)) * 1000000000L;
+    if (*rest == '.') {
+        int64_t scale = 100000000L;
+        for (++rest; *rest >= '0' && *rest <= '9' && scale > 0; ++rest, scale /= 10) ns += (*rest - '0') * scale;
+    }
+    return ns;
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "hf:t:p:T:s:n:ci")) != -1) {
+        switch (opt) {
+            case 'f':
+                query.fromNs = parse_time(optarg);
+                break;
+            case 't':
+                query.toNs = parse_time(optarg);
+                break;
+            case 'p':
+                query.minPriority = ShmLog::getPriorityByStr(optarg);
+                break;
+            case 'T':
+                query.tid = std::stoi(optarg);
+                break;
+            case 's': {
+                site_file = optarg;
+                size_t colon = site_file.rfind(':');
+                if (colon != string::npos) {
+                    site_line = std::stoi(site_file.substr(colon + 1));
+                    site_file.resize(colon);
+                }
+                break;
+            }
+            case 'n':
+                limit = std::stoull(optarg);
+                break;
+            case 'c':
+                count_only = true;
+                break;
+            case 'i':
+                stats = true;
+                break;
+            case 'h':
+            default:
+                help();
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        help();
+        return 1;
+    }
+
+    uint64_t matched = 0;
+    for (int i = optind; i < argc && matched < limit; ++i) {
+        try {
+            ShmLogArchiveReader reader(argv[i]);
+            if (!site_file.empty()) {
+                query.sites = reader.findSites(site_file, site_line);
+                if (query.sites.empty()) continue;  // site never logged into this file
+            }
+            size_t scanned = reader.query(query, [&](const ShmArchiveRecord& record, const char* payload) {
+                if (!count_only) std::cout << reader.render(record, payload) << '\n';
+                return ++matched < limit;
+            });
+            if (stats) {
+                cerr << argv[i] << ": read " << scanned << " of " << reader.blockCount() << " blocks" << endl;
+            }
+        } catch (const std::exception& e) {
+            cerr << e.what() << endl;
+        }
+    }
+    if (count_only) std::cout << matched << std::endl;
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utils/TscClock.h>
+#include <atomic>
+#include <iostream>
+
+using namespace std;
+using namespace frenzy;
+
+string name = TscClock::DefaultName;
+uint32_t interval_ms = 1000;
+// attached clocks drop a calibrator silent for 3 re-anchor periods, and its lease lasts SharedMemory::DefaultLeaseNs
+constexpr uint32_t MaxIntervalMs = 2000;
+bool verbose{false};
+std::atomic<bool> running{true};
+
+void help() {
+    std::cout << "Program options:" << std::endl;
+    std::cout << "  -h                                    list help" << std::endl;
+    std::cout << "  -n                                    shm name, default frenzy_tsc_clock" << std::endl;
+    std::cout << "  -i                                    re-anchor interval in ms, default 1000, at most 2000"
+              << std::endl;
+    std::cout << "  -v                                    print parameters and drift on every re-anchor" << std::endl;
+    std::cout << "example:" << std::endl;
+    std::cout << "tsc_calibrator -v" << std::endl;
+}
+
+void on_signal(int) { running = false; }
+
+/**
+ * publishes tsc to realtime parameters, every TscClock in other processes attaches to them on first use
+ */
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "hn:i:v")) != -1) {
+        switch (opt) {
+            case 'n':
+                name = std::string(optarg);
+                break;
+            case 'i':
+                interval_ms = static_cast<uint32_t>(std::stoul(optarg));
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 'h':
+            default:
+                help();
+                return 1;
+        }
+    }
+
+    if (interval_ms == 0 || interval_ms > MaxIntervalMs) {
+        cerr << "re-anchor interval " << interval_ms << "ms out of range 1-" << MaxIntervalMs
+             << "ms, readers would give up on the calibrator" << endl;
+        return 1;
+    }
+    static_assert(MaxIntervalMs * 1000000UL < SharedMemory::DefaultLeaseNs, "lease expires between re-anchors");
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    TscClock& clock = TscClock::instance();
+    if (!clock.is_invariant()) cerr << "tsc is not invariant on this cpu, readers fall back to clock_gettime" << endl;
+    try {
+        clock.publish(name);
+    } catch (const std::exception& e) {
+        cerr << "publish " << name << " failed, " << e.what() << endl;
+        return 1;
+    }
+    cout << "tsc_calibrator publishes " << name << ", " << clock.ticks_per_ns() << " ticks per ns" << endl;
+
+    while (running) {
+        usleep(interval_ms * 1000);
+        int64_t before = clock.now_ns();
+        int64_t real = TscClock::realtime_ns();
+        clock.recalibrate();
+        if (verbose) {
+            TscParams p = clock.get_params();
+            cout << "generation " << p.generation << ", mult " << p.mult << ", drift " << before - real << " ns"
+                 << endl;
+        }
+    }
+    shm_unlink(name.c_str());  // readers keep their mapping and go on with a local calibration
+    return 0;
+}